@@ -48,7 +48,6 @@ if __name__ == "__main__":
         main = NewEditorMainWindow(fname, QFileInfo(filename).absolutePath(), None)
         ret = main.codegenAct()
         app.deleteLater()
-        os.remove("tmp.py")
         if not ret:
             sys.exit("Failed to generate C code")
     else:
@@ -0,0 +1,136 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#include <algloop.h>
+#include <matop.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+int pysim_algloop_init(struct pysim_algloop *l, const char *name, int n,
+                       int maxIter, double tol, pysim_algloop_fcn fcn,
+                       void *arg)
+{
+  memset(l, 0, sizeof(*l));
+  l->name = name;
+  l->n = n;
+  l->maxIter = maxIter;
+  l->tol = tol;
+  l->fcn = fcn;
+  l->arg = arg;
+
+  l->work = calloc(3 * n + n * n, sizeof(double));
+  l->piv = calloc(n, sizeof(int));
+  if (l->work == NULL || l->piv == NULL) {
+    free(l->work);
+    free(l->piv);
+    l->work = NULL;
+    l->piv = NULL;
+    return -1;
+  }
+
+  l->z = l->work;
+  l->gz = l->z + n;
+  l->r = l->gz + n;
+  l->J = l->r + n;
+  return 0;
+}
+
+/* r = gz - z, returns the largest scaled component */
+
+static double residual(struct pysim_algloop *l, const double *z, double *r)
+{
+  double res = 0.0;
+  int i;
+
+  l->fcn(z, l->gz, l->arg);
+  for (i = 0; i < l->n; i++) {
+    r[i] = l->gz[i] - z[i];
+    res = fmax(res, fabs(r[i]) / (fabs(z[i]) + 1.0));
+  }
+  return res;
+}
+
+int pysim_algloop_solve(struct pysim_algloop *l)
+{
+  int n = l->n;
+  double *z = l->z;
+  double *r = l->r;
+  double *J = l->J;
+  double zj, dz, res;
+  int i, j, iter;
+
+  if (l->work == NULL)
+    return -1;
+
+  res = residual(l, z, r);
+  for (iter = 0; iter < l->maxIter && res > l->tol; iter++) {
+
+    /* Jacobian of gz - z, column by column */
+
+    for (j = 0; j < n; j++) {
+      zj = z[j];
+      dz = 1e-7 * (fabs(zj) + 1.0);
+      z[j] = zj + dz;
+      l->fcn(z, l->gz, l->arg);
+      z[j] = zj;
+      for (i = 0; i < n; i++)
+        J[i * n + j] = (l->gz[i] - z[i] - r[i]) / dz - (i == j);
+    }
+
+    /* Newton step, a fixed point step if the Jacobian is singular */
+
+    if (matlu(J, n, l->piv) == 0) {
+      for (i = 0; i < n; i++)
+        r[i] = -r[i];
+      matlusolve(J, n, l->piv, r);
+    }
+    for (i = 0; i < n; i++)
+      z[i] += r[i];
+
+    res = residual(l, z, r);
+  }
+
+  l->solves++;
+  l->iterations += iter;
+  if (iter > l->maxUsed)
+    l->maxUsed = iter;
+  l->residual = res;
+  if (res > l->tol) {
+    l->failures++;
+    return -1;
+  }
+  return iter;
+}
+
+void pysim_algloop_report(const struct pysim_algloop *l)
+{
+  fprintf(stderr, "Algebraic loop %s: %lu solves, %.2f iterations per solve, "
+          "max %d, %lu not converged, last residual %g\n", l->name, l->solves,
+          l->solves ? (double) l->iterations / l->solves : 0.0, l->maxUsed,
+          l->failures, l->residual);
+}
+
+void pysim_algloop_end(struct pysim_algloop *l)
+{
+  free(l->work);
+  free(l->piv);
+  l->work = NULL;
+  l->piv = NULL;
+}
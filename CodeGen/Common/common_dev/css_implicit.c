@@ -0,0 +1,232 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+/* Continuous state space block with an implicit integration step.
+ *
+ * Same parameters as css. The update uses the L-stable two stage
+ * SDIRK method (Alexander), both stages solve with the same matrix
+ * I - h*gamma*A. The LU factors of this matrix are computed at init and
+ * again only when A or the step h changes, the step itself costs two
+ * triangular solves and two products with the nonzeros of A.
+ *
+ * Only the block's own A is implicit, the inputs are held over the
+ * step. Blocks coupled through the rest of the diagram are not solved
+ * as one system, see genCode.
+ *
+ * A singular iteration matrix stops the model at init. A parameter
+ * change making it singular later is reported and ignored, the block
+ * keeps stepping with the previous A.
+ */
+
+#include <pyblock.h>
+#include <matop.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void css(int flag, python_block *block);
+
+#define GAMMA  0.29289321881345248    /* 1 - 1/sqrt(2) */
+
+struct css_implicit {
+  double h;                 /* Step of the last factorization */
+  double *A;                /* A at the time of the last factorization */
+  double hf;                /* Step of the factors in use */
+  double *lu;               /* LU factors of I - h*gamma*A */
+  double *lu_new;           /* Factors being computed */
+  int *piv;
+  int *piv_new;
+  int nnz;                  /* Nonzeros of the factored A, by rows */
+  int *row;
+  int *col;
+  double *val;
+  double *bu;               /* B*u */
+  double *k1;               /* Stages */
+  double *k2;
+  double *xs;               /* State of the second stage */
+};
+
+/* Factors I - h*gamma*A, the previous factors stay in use if it fails */
+
+static int factor(struct css_implicit *w, const double *a, int nx, double h)
+{
+  double *lu = w->lu_new;
+  int *piv;
+  int i, j;
+
+  memcpy(w->A, a, nx * nx * sizeof(double));
+  w->h = h;
+
+  for (i = 0; i < nx * nx; i++)
+    lu[i] = -h * GAMMA * a[i];
+  for (i = 0; i < nx; i++)
+    lu[i * nx + i] += 1.0;
+
+  if (matlu(lu, nx, w->piv_new) != 0)
+    return -1;
+
+  w->hf = h;
+  w->lu_new = w->lu;
+  w->lu = lu;
+  piv = w->piv_new;
+  w->piv_new = w->piv;
+  w->piv = piv;
+
+  w->nnz = 0;
+  for (i = 0; i < nx; i++) {
+    w->row[i] = w->nnz;
+    for (j = 0; j < nx; j++) {
+      if (a[i * nx + j] != 0.0) {
+        w->col[w->nnz] = j;
+        w->val[w->nnz] = a[i * nx + j];
+        w->nnz++;
+      }
+    }
+  }
+  w->row[nx] = w->nnz;
+
+  return 0;
+}
+
+/* f = A*x + bu */
+
+static void deriv(const struct css_implicit *w, int nx, const double *x,
+                  const double *bu, double *f)
+{
+  int i, k;
+
+  for (i = 0; i < nx; i++) {
+    double acc = bu[i];
+    for (k = w->row[i]; k < w->row[i + 1]; k++)
+      acc += w->val[k] * x[w->col[k]];
+    f[i] = acc;
+  }
+}
+
+static void init(python_block *block)
+{
+  struct css_implicit *w;
+  double *realPar = block->realPar;
+  int *intPar = block->intPar;
+  int nx = intPar[0];
+
+  w = calloc(1, sizeof(*w));
+  if (w == NULL) {
+    fprintf(stderr, "css_implicit: out of memory\n");
+    exit(1);
+  }
+  w->A = calloc(4 * nx * nx + 4 * nx, sizeof(double));
+  w->piv = calloc(2 * nx + (nx + 1) + nx * nx, sizeof(int));
+  if (w->A == NULL || w->piv == NULL) {
+    fprintf(stderr, "css_implicit: out of memory\n");
+    exit(1);
+  }
+  w->lu = w->A + nx * nx;
+  w->lu_new = w->lu + nx * nx;
+  w->val = w->lu_new + nx * nx;
+  w->bu = w->val + nx * nx;
+  w->k1 = w->bu + nx;
+  w->k2 = w->k1 + nx;
+  w->xs = w->k2 + nx;
+  w->piv_new = w->piv + nx;
+  w->row = w->piv_new + nx;
+  w->col = w->row + nx + 1;
+
+  if (factor(w, &realPar[intPar[3]], nx, realPar[0]) != 0) {
+    fprintf(stderr, "css_implicit: singular iteration matrix I - h*gamma*A\n");
+    exit(1);
+  }
+
+  block->ptrPar = w;
+}
+
+static void update(python_block *block)
+{
+  struct css_implicit *w = block->ptrPar;
+  double *realPar = block->realPar;
+  int *intPar = block->intPar;
+  int nx = intPar[0];
+  int ni = intPar[1];
+  double h = realPar[0];
+  double *a = &realPar[intPar[3]];
+  double *b = &realPar[intPar[4]];
+  double *X = &realPar[intPar[7]];
+  double *bu = w->bu;
+  double *k1 = w->k1;
+  double *k2 = w->k2;
+  double *xs = w->xs;
+  double *u;
+  int i, j;
+
+  if (h != w->h || memcmp(a, w->A, nx * nx * sizeof(double)) != 0) {
+    if (factor(w, a, nx, h) != 0)
+      fprintf(stderr, "css_implicit: singular iteration matrix, change of A ignored\n");
+    h = w->hf;
+  }
+
+  for (i = 0; i < nx; i++) {
+    bu[i] = 0.0;
+    for (j = 0; j < ni; j++) {
+      u = (double *) block->u[j];
+      bu[i] += b[i * ni + j] * u[0];
+    }
+  }
+
+  /* (I - h*gamma*A) k1 = A*x + B*u */
+
+  deriv(w, nx, X, bu, k1);
+  matlusolve(w->lu, nx, w->piv, k1);
+
+  /* (I - h*gamma*A) k2 = A*(x + h*(1-gamma)*k1) + B*u */
+
+  for (i = 0; i < nx; i++)
+    xs[i] = X[i] + h * (1.0 - GAMMA) * k1[i];
+  deriv(w, nx, xs, bu, k2);
+  matlusolve(w->lu, nx, w->piv, k2);
+
+  for (i = 0; i < nx; i++)
+    X[i] += h * ((1.0 - GAMMA) * k1[i] + GAMMA * k2[i]);
+}
+
+static void end(python_block *block)
+{
+  struct css_implicit *w = block->ptrPar;
+
+  if (w != NULL) {
+    free(w->A);
+    free(w->piv);
+    free(w);
+    block->ptrPar = NULL;
+  }
+}
+
+void css_implicit(int flag, python_block *block)
+{
+  if (flag == CG_OUT) {
+    css(CG_OUT, block);
+  }
+  else if (flag == CG_STUPD) {
+    update(block);
+  }
+  else if (flag == CG_END) {
+    end(block);
+  }
+  else if (flag == CG_INIT) {
+    init(block);
+  }
+}
@@ -17,6 +17,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
 */
 
 #include <stdio.h>
+#include <math.h>
 #include <pyblock.h>
 
 int matmult(double *a, int na, int ma, double *b, int nb, int mb, double* c)
@@ -51,6 +52,59 @@ int matsum(double *a, int na, int ma, double *b, int nb, int mb, double* c)
   return 0;
 }
 
+/* LU factorization with partial pivoting in place, row k was swapped
+   with row piv[k] */
+
+int matlu(double *a, int n, int *piv)
+{
+  int i, j, k, p;
+  double tmp, l;
+
+  for(k=0;k<n;k++){
+    p = k;
+    for(i=k+1;i<n;i++)
+      if (fabs(a[i*n+k]) > fabs(a[p*n+k])) p = i;
+    piv[k] = p;
+    if (a[p*n+k] == 0.0) return -1;
+    if (p != k){
+      for(j=0;j<n;j++){
+	tmp = a[k*n+j];
+	a[k*n+j] = a[p*n+j];
+	a[p*n+j] = tmp;
+      }
+    }
+    for(i=k+1;i<n;i++){
+      l = a[i*n+k]/a[k*n+k];
+      a[i*n+k] = l;
+      if (l != 0.0)
+	for(j=k+1;j<n;j++) a[i*n+j] -= l*a[k*n+j];
+    }
+  }
+  return 0;
+}
+
+/* Solve a*x = b with the factors of matlu, x holds b on entry */
+
+void matlusolve(const double *lu, int n, const int *piv, double *x)
+{
+  int i, j;
+  double tmp;
+
+  for(i=0;i<n;i++){
+    if (piv[i] != i){
+      tmp = x[i];
+      x[i] = x[piv[i]];
+      x[piv[i]] = tmp;
+    }
+  }
+  for(i=1;i<n;i++)
+    for(j=0;j<i;j++) x[i] -= lu[i*n+j]*x[j];
+  for(i=n-1;i>=0;i--){
+    for(j=i+1;j<n;j++) x[i] -= lu[i*n+j]*x[j];
+    x[i] /= lu[i*n+i];
+  }
+}
+
 int integralFunc(double t, const double y[], double f[], void *params)
 {
   python_block * block = ( python_block *) params;
@@ -0,0 +1,82 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+/* Enable and trigger ports of conditionally executed subsystems.
+ *
+ * The blocks have no outputs. They store the decision in intPar[0] and
+ * the generated code calls the other blocks of the subsystem only when
+ * it is set.
+ */
+
+#include <pyblock.h>
+
+#define TRIGGER_RISING   1
+#define TRIGGER_FALLING  2
+#define TRIGGER_EITHER   3
+
+/****************************************************************************
+ * Name: enable_port
+ *
+ * Description:
+ *   The subsystem runs while the input is positive.
+ *
+ ****************************************************************************/
+
+void enable_port(int flag, python_block *block)
+{
+  double *u = block->u[0];
+
+  if (flag == CG_OUT || flag == CG_INIT)
+    {
+      block->intPar[0] = u[0] > 0.0;
+    }
+}
+
+/****************************************************************************
+ * Name: trigger_port
+ *
+ * Description:
+ *   The subsystem runs once in the samples where the input crosses zero
+ *   in the direction given by intPar[1]. realPar[0] keeps the input of
+ *   the previous sample.
+ *
+ ****************************************************************************/
+
+void trigger_port(int flag, python_block *block)
+{
+  double *u = block->u[0];
+  double prev = block->realPar[0];
+  int edge = block->intPar[1];
+  int fired = 0;
+
+  if (flag == CG_INIT)
+    {
+      block->intPar[0] = 0;
+      block->realPar[0] = u[0];
+    }
+  else if (flag == CG_OUT)
+    {
+      if ((edge & TRIGGER_RISING) && prev <= 0.0 && u[0] > 0.0)
+        fired = 1;
+      if ((edge & TRIGGER_FALLING) && prev > 0.0 && u[0] <= 0.0)
+        fired = 1;
+
+      block->intPar[0] = fired;
+      block->realPar[0] = u[0];
+    }
+}
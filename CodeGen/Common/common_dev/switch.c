@@ -24,35 +24,38 @@ static void init(python_block *block)
 {
 }
 
+/* Selected input, 0 for input 1 and 1 for input 2. Also used by the
+ * generated code to evaluate only the branch feeding the selected input.
+ */
+
+int switcher_select(python_block *block)
+{
+  double *u3 = block->u[2];
+
+  if (block->intPar[1] == 2)
+    return 1;
+
+  switch(block->intPar[0]){
+  case 0:
+    return u3[0] < block->realPar[0];
+  case 1:
+    return u3[0] >= block->realPar[0];
+  }
+  return 0;
+}
+
 static void inout(python_block *block)
 {
   double *y = block->y[0];
 
   double *u1 = block->u[0];
   double *u2 = block->u[1];
-  double *u3 = block->u[2];
 
-  if (block->intPar[1] == 2)
+  if (switcher_select(block)){
     y[0] = u2[0];
-  else{
-    switch(block->intPar[0]){
-    case 0:
-      if(u3[0] < block->realPar[0]){
-	y[0] = u2[0];
-	if (block->intPar[1]) block->intPar[1]=2;
-      }
-      else y[0] = u1[0];
-      break;
-
-    case 1:
-      if(u3[0] >= block->realPar[0]){
-	y[0] = u2[0];
-	if (block->intPar[1]) block->intPar[1]=2;
-      }
-      else y[0] = u1[0];
-      break;
-    }
+    if (block->intPar[1]) block->intPar[1]=2;
   }
+  else y[0] = u1[0];
 }
 
 static void end(python_block *block)
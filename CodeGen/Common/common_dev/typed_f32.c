@@ -0,0 +1,237 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+/* Single precision variants of the core blocks, see pysim_num.h */
+
+#include <pyblock.h>
+#include <pysim_num.h>
+#include <math.h>
+
+/* c[na x mb] = a[na x ma] * b[ma x mb] */
+
+static void matmult_f32(const float *a, int na, int ma, const float *b, int mb,
+                        float *c)
+{
+  int i, j, k;
+
+  for (i = 0; i < na; i++) {
+    for (j = 0; j < mb; j++) {
+      float acc = 0.0f;
+      for (k = 0; k < ma; k++)
+        acc += a[i * ma + k] * b[k * mb + j];
+      c[i * mb + j] = acc;
+    }
+  }
+}
+
+/* Conversions between double and float nodes */
+
+void cnv_d2f(int flag, python_block *block)
+{
+  double *u = block->u[0];
+  float *y = block->y[0];
+
+  if (flag == CG_OUT || flag == CG_INIT)
+    y[0] = (float) u[0];
+}
+
+void cnv_f2d(int flag, python_block *block)
+{
+  float *u = block->u[0];
+  double *y = block->y[0];
+
+  if (flag == CG_OUT || flag == CG_INIT)
+    y[0] = u[0];
+}
+
+/* Gain */
+
+void mxmult_f32(int flag, python_block *block)
+{
+  float *gain = block->ptrPar;
+  int nin = block->nin;
+  int nout = block->nout;
+  float tmpU[nin];
+  float tmpY[nout];
+  float *p;
+  int i;
+
+  if (flag != CG_OUT && flag != CG_INIT)
+    return;
+
+  for (i = 0; i < nin; i++) {
+    p = block->u[i];
+    tmpU[i] = p[0];
+  }
+  matmult_f32(gain, nout, nin, tmpU, 1, tmpY);
+  for (i = 0; i < nout; i++) {
+    p = block->y[i];
+    p[0] = tmpY[i];
+  }
+}
+
+void sum_f32(int flag, python_block *block)
+{
+  float *realPar = block->ptrPar;
+  float *y = block->y[0];
+  float *u;
+  float acc = 0.0f;
+  int i;
+
+  if (flag != CG_OUT && flag != CG_INIT)
+    return;
+
+  for (i = 0; i < block->nin; i++) {
+    u = block->u[i];
+    acc += realPar[i] * u[0];
+  }
+  y[0] = acc;
+}
+
+void saturation_f32(int flag, python_block *block)
+{
+  float *realPar = block->ptrPar;
+  float *y = block->y[0];
+  float *u = block->u[0];
+  float out;
+
+  if (flag != CG_OUT && flag != CG_INIT)
+    return;
+
+  out = u[0];
+  if (out > realPar[0]) out = realPar[0];
+  if (out < realPar[1]) out = realPar[1];
+  y[0] = out;
+}
+
+/* Polynomial, coefficients from the highest order */
+
+void lut_f32(int flag, python_block *block)
+{
+  float *realPar = block->ptrPar;
+  float *y = block->y[0];
+  float *u = block->u[0];
+  float acc;
+  int i;
+
+  if (flag != CG_OUT)
+    return;
+
+  acc = realPar[0];
+  for (i = 1; i < block->intPar[0]; i++)
+    acc = acc * u[0] + realPar[i];
+  y[0] = acc;
+}
+
+void trigo_f32(int flag, python_block *block)
+{
+  float *y = block->y[0];
+  float *u = block->u[0];
+
+  if (flag != CG_OUT && flag != CG_INIT)
+    return;
+
+  switch (block->intPar[0]) {
+  case 1:
+    y[0] = sinf(u[0]);
+    break;
+  case 2:
+    y[0] = cosf(u[0]);
+    break;
+  case 3:
+    y[0] = tanf(u[0]);
+    break;
+  default:
+    y[0] = u[0];
+    break;
+  }
+}
+
+/* Same algorithm as discretePID, states in realPar[5] and realPar[6] */
+
+void discretePID_f32(int flag, python_block *block)
+{
+  float *realPar = block->ptrPar;
+  float *u = block->u[0];
+  float *y = block->y[0];
+  float error, action;
+  float integral_sum;
+
+  if (flag != CG_OUT)
+    return;
+
+  error = u[0];
+  integral_sum = realPar[6];
+  if (realPar[1] == 0.0f)
+    integral_sum = 0.0f;
+  else
+    integral_sum += error * realPar[1];
+
+  action = realPar[0] * error + integral_sum + realPar[2] * (error - realPar[5]);
+
+  if (action > realPar[4]) {
+    integral_sum -= action - realPar[4];
+    action = realPar[4];
+  } else if (action < realPar[3]) {
+    integral_sum -= action - realPar[3];
+    action = realPar[3];
+  }
+
+  realPar[5] = error;
+  realPar[6] = integral_sum;
+  y[0] = action;
+}
+
+/* Discrete state space, layout of the parameters as in dss */
+
+void dss_f32(int flag, python_block *block)
+{
+  float *realPar = block->ptrPar;
+  int *intPar = block->intPar;
+  int nx = intPar[0];
+  int ni = intPar[1];
+  int no = intPar[2];
+  float *X = &realPar[intPar[7]];
+  float tmpU[ni];
+  float tmpA[nx > no ? nx : no];
+  float tmpB[nx > no ? nx : no];
+  float *p;
+  int i;
+
+  if (flag != CG_OUT && flag != CG_STUPD)
+    return;
+
+  for (i = 0; i < ni; i++) {
+    p = block->u[i];
+    tmpU[i] = p[0];
+  }
+
+  if (flag == CG_OUT) {
+    matmult_f32(&realPar[intPar[5]], no, nx, X, 1, tmpA);
+    matmult_f32(&realPar[intPar[6]], no, ni, tmpU, 1, tmpB);
+    for (i = 0; i < no; i++) {
+      p = block->y[i];
+      p[0] = tmpA[i] + tmpB[i];
+    }
+  } else {
+    matmult_f32(&realPar[intPar[3]], nx, nx, X, 1, tmpA);
+    matmult_f32(&realPar[intPar[4]], nx, ni, tmpU, 1, tmpB);
+    for (i = 0; i < nx; i++)
+      X[i] = tmpA[i] + tmpB[i];
+  }
+}
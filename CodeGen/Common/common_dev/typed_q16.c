@@ -0,0 +1,270 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+/* Q16.16 fixed point variants of the core blocks, see pysim_num.h.
+ * Results saturate instead of wrapping around.
+ */
+
+#include <pyblock.h>
+#include <pysim_num.h>
+
+#define Q16_PI       205887     /* pi */
+#define Q16_HALF_PI  102944     /* pi / 2 */
+#define Q16_TWO_PI   411775     /* 2 pi */
+
+/* Sine, Taylor series up to x^9 on <-pi/2, pi/2>, error below 5e-5 */
+
+pysim_q16 q16_sin(pysim_q16 x)
+{
+  int64_t x2, acc;
+
+  x %= Q16_TWO_PI;
+  if (x > Q16_PI)
+    x -= Q16_TWO_PI;
+  else if (x < -Q16_PI)
+    x += Q16_TWO_PI;
+
+  if (x > Q16_HALF_PI)
+    x = Q16_PI - x;
+  else if (x < -Q16_HALF_PI)
+    x = -Q16_PI - x;
+
+  /* Horner scheme in Q2.30 */
+
+  x2 = ((int64_t) x * x) >> 2;
+  acc = 2959;                           /* 1/9! */
+  acc = -213043 + ((x2 * acc) >> 30);   /* 1/7! */
+  acc = 8947849 + ((x2 * acc) >> 30);   /* 1/5! */
+  acc = -178956971 + ((x2 * acc) >> 30);
+  acc = (1 << 30) + ((x2 * acc) >> 30);
+  return q16_sat((x * acc + (1 << 29)) >> 30);
+}
+
+pysim_q16 q16_cos(pysim_q16 x)
+{
+  /* Shift by pi/2 without overflowing near the top of the range */
+
+  return q16_sin((x % Q16_TWO_PI) + Q16_HALF_PI);
+}
+
+static pysim_q16 get_u(python_block *block, int i)
+{
+  pysim_q16 *u = block->u[i];
+  return u[0];
+}
+
+static void set_y(python_block *block, int i, pysim_q16 v)
+{
+  pysim_q16 *y = block->y[i];
+  y[0] = v;
+}
+
+/* c[na] = a[na x ma] * b[ma] */
+
+static void matvec_q16(const pysim_q16 *a, int na, int ma, const pysim_q16 *b,
+                       pysim_q16 *c)
+{
+  int i, k;
+
+  for (i = 0; i < na; i++) {
+    int64_t acc = 0;
+    for (k = 0; k < ma; k++)
+      acc += (int64_t) a[i * ma + k] * b[k];
+    c[i] = q16_sat((acc + (1 << (PYSIM_Q16_FRAC - 1))) >> PYSIM_Q16_FRAC);
+  }
+}
+
+/* Conversions between double and fixed point nodes */
+
+void cnv_d2q(int flag, python_block *block)
+{
+  double *u = block->u[0];
+
+  if (flag == CG_OUT || flag == CG_INIT)
+    set_y(block, 0, q16_from_double(u[0]));
+}
+
+void cnv_q2d(int flag, python_block *block)
+{
+  double *y = block->y[0];
+
+  if (flag == CG_OUT || flag == CG_INIT)
+    y[0] = q16_to_double(get_u(block, 0));
+}
+
+/* Gain */
+
+void mxmult_q16(int flag, python_block *block)
+{
+  pysim_q16 *gain = block->ptrPar;
+  int nin = block->nin;
+  int nout = block->nout;
+  pysim_q16 tmpU[nin];
+  pysim_q16 tmpY[nout];
+  int i;
+
+  if (flag != CG_OUT && flag != CG_INIT)
+    return;
+
+  for (i = 0; i < nin; i++)
+    tmpU[i] = get_u(block, i);
+  matvec_q16(gain, nout, nin, tmpU, tmpY);
+  for (i = 0; i < nout; i++)
+    set_y(block, i, tmpY[i]);
+}
+
+void sum_q16(int flag, python_block *block)
+{
+  pysim_q16 *realPar = block->ptrPar;
+  int64_t acc = 0;
+  int i;
+
+  if (flag != CG_OUT && flag != CG_INIT)
+    return;
+
+  for (i = 0; i < block->nin; i++)
+    acc += q16_mul_wide(realPar[i], get_u(block, i));
+  set_y(block, 0, q16_sat(acc));
+}
+
+void saturation_q16(int flag, python_block *block)
+{
+  pysim_q16 *realPar = block->ptrPar;
+  pysim_q16 out;
+
+  if (flag != CG_OUT && flag != CG_INIT)
+    return;
+
+  out = get_u(block, 0);
+  if (out > realPar[0]) out = realPar[0];
+  if (out < realPar[1]) out = realPar[1];
+  set_y(block, 0, out);
+}
+
+/* Polynomial, coefficients from the highest order */
+
+void lut_q16(int flag, python_block *block)
+{
+  pysim_q16 *realPar = block->ptrPar;
+  pysim_q16 u, acc;
+  int i;
+
+  if (flag != CG_OUT)
+    return;
+
+  u = get_u(block, 0);
+  acc = realPar[0];
+  for (i = 1; i < block->intPar[0]; i++)
+    acc = q16_add(q16_mul(acc, u), realPar[i]);
+  set_y(block, 0, acc);
+}
+
+void trigo_q16(int flag, python_block *block)
+{
+  pysim_q16 u, y;
+
+  if (flag != CG_OUT && flag != CG_INIT)
+    return;
+
+  u = get_u(block, 0);
+  switch (block->intPar[0]) {
+  case 1:
+    y = q16_sin(u);
+    break;
+  case 2:
+    y = q16_cos(u);
+    break;
+  case 3:
+    y = q16_div(q16_sin(u), q16_cos(u));
+    break;
+  default:
+    y = u;
+    break;
+  }
+  set_y(block, 0, y);
+}
+
+/* Same algorithm as discretePID, states in realPar[5] and realPar[6] */
+
+void discretePID_q16(int flag, python_block *block)
+{
+  pysim_q16 *realPar = block->ptrPar;
+  pysim_q16 error, action, integral_sum;
+  int64_t acc;
+
+  if (flag != CG_OUT)
+    return;
+
+  error = get_u(block, 0);
+  integral_sum = realPar[6];
+  if (realPar[1] == 0)
+    integral_sum = 0;
+  else
+    integral_sum = q16_add(integral_sum, q16_mul(error, realPar[1]));
+
+  acc = q16_mul_wide(realPar[0], error) + integral_sum +
+        q16_mul_wide(realPar[2], q16_sub(error, realPar[5]));
+
+  if (acc > realPar[4]) {
+    integral_sum = q16_sat(integral_sum - (acc - realPar[4]));
+    action = realPar[4];
+  } else if (acc < realPar[3]) {
+    integral_sum = q16_sat(integral_sum - (acc - realPar[3]));
+    action = realPar[3];
+  } else {
+    action = (pysim_q16) acc;
+  }
+
+  realPar[5] = error;
+  realPar[6] = integral_sum;
+  set_y(block, 0, action);
+}
+
+/* Discrete state space, layout of the parameters as in dss */
+
+void dss_q16(int flag, python_block *block)
+{
+  pysim_q16 *realPar = block->ptrPar;
+  int *intPar = block->intPar;
+  int nx = intPar[0];
+  int ni = intPar[1];
+  int no = intPar[2];
+  pysim_q16 *X = &realPar[intPar[7]];
+  pysim_q16 tmpU[ni];
+  pysim_q16 tmpA[nx > no ? nx : no];
+  pysim_q16 tmpB[nx > no ? nx : no];
+  int i;
+
+  if (flag != CG_OUT && flag != CG_STUPD)
+    return;
+
+  for (i = 0; i < ni; i++)
+    tmpU[i] = get_u(block, i);
+
+  if (flag == CG_OUT) {
+    matvec_q16(&realPar[intPar[5]], no, nx, X, tmpA);
+    matvec_q16(&realPar[intPar[6]], no, ni, tmpU, tmpB);
+    for (i = 0; i < no; i++)
+      set_y(block, i, q16_add(tmpA[i], tmpB[i]));
+  } else {
+    matvec_q16(&realPar[intPar[3]], nx, nx, X, tmpA);
+    matvec_q16(&realPar[intPar[4]], nx, ni, tmpU, tmpB);
+    for (i = 0; i < nx; i++)
+      X[i] = q16_add(tmpA[i], tmpB[i]);
+  }
+}
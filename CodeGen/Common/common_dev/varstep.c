@@ -0,0 +1,229 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#include <varstep.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Dormand-Prince 5(4) tableau */
+
+static const double c2 = 1.0/5, c3 = 3.0/10, c4 = 4.0/5, c5 = 8.0/9;
+
+static const double a21 = 1.0/5;
+static const double a31 = 3.0/40, a32 = 9.0/40;
+static const double a41 = 44.0/45, a42 = -56.0/15, a43 = 32.0/9;
+static const double a51 = 19372.0/6561, a52 = -25360.0/2187,
+                    a53 = 64448.0/6561, a54 = -212.0/729;
+static const double a61 = 9017.0/3168, a62 = -355.0/33, a63 = 46732.0/5247,
+                    a64 = 49.0/176, a65 = -5103.0/18656;
+static const double b1 = 35.0/384, b3 = 500.0/1113, b4 = 125.0/192,
+                    b5 = -2187.0/6784, b6 = 11.0/84;
+
+/* Difference between the 5th and the 4th order solution */
+
+static const double e1 = 71.0/57600, e3 = -71.0/16695, e4 = 71.0/1920,
+                    e5 = -17253.0/339200, e6 = 22.0/525, e7 = -1.0/40;
+
+#define SWAP(a, b) do { double *tmp = (a); (a) = (b); (b) = tmp; } while (0)
+
+/* One step of size h from (t, x) with k[0] = f(t, x). Writes the new
+ * states to xout, their derivatives to k7 and the zero crossing functions
+ * to g. Returns the scaled RMS norm of the local error.
+ */
+
+static double dp_step(struct pysim_vstep *s, double t, double h,
+                      double *xout, double *k7, double *g)
+{
+  double **k = s->k;
+  double *x = s->x;
+  double *xe = s->xe;
+  double err = 0.0;
+  int n = s->n;
+  int i;
+
+  for (i = 0; i < n; i++)
+    xe[i] = x[i] + h * a21 * k[0][i];
+  s->fcn(t + c2 * h, xe, k[1], NULL, s->arg);
+
+  for (i = 0; i < n; i++)
+    xe[i] = x[i] + h * (a31 * k[0][i] + a32 * k[1][i]);
+  s->fcn(t + c3 * h, xe, k[2], NULL, s->arg);
+
+  for (i = 0; i < n; i++)
+    xe[i] = x[i] + h * (a41 * k[0][i] + a42 * k[1][i] + a43 * k[2][i]);
+  s->fcn(t + c4 * h, xe, k[3], NULL, s->arg);
+
+  for (i = 0; i < n; i++)
+    xe[i] = x[i] + h * (a51 * k[0][i] + a52 * k[1][i] + a53 * k[2][i] +
+                        a54 * k[3][i]);
+  s->fcn(t + c5 * h, xe, k[4], NULL, s->arg);
+
+  for (i = 0; i < n; i++)
+    xe[i] = x[i] + h * (a61 * k[0][i] + a62 * k[1][i] + a63 * k[2][i] +
+                        a64 * k[3][i] + a65 * k[4][i]);
+  s->fcn(t + h, xe, k[5], NULL, s->arg);
+
+  for (i = 0; i < n; i++)
+    xout[i] = x[i] + h * (b1 * k[0][i] + b3 * k[2][i] + b4 * k[3][i] +
+                          b5 * k[4][i] + b6 * k[5][i]);
+  s->fcn(t + h, xout, k7, g, s->arg);
+  s->fevals += 6;
+
+  for (i = 0; i < n; i++) {
+    double e = h * (e1 * k[0][i] + e3 * k[2][i] + e4 * k[3][i] +
+                    e5 * k[4][i] + e6 * k[5][i] + e7 * k7[i]);
+    double sc = s->epsAbs + s->epsRel * fmax(fabs(x[i]), fabs(xout[i]));
+    err += (e / sc) * (e / sc);
+  }
+  return sqrt(err / n);
+}
+
+static int crossed(const struct pysim_vstep *s, const double *g0,
+                   const double *g1)
+{
+  int i;
+
+  for (i = 0; i < s->nzc; i++) {
+    if ((g0[i] < 0.0 && g1[i] > 0.0) || (g0[i] > 0.0 && g1[i] < 0.0))
+      return 1;
+  }
+  return 0;
+}
+
+int pysim_vstep_init(struct pysim_vstep *s, int n, int nzc, double epsAbs,
+                     double epsRel, double hmax, pysim_vstep_fcn fcn,
+                     void *arg)
+{
+  double *p;
+  int i;
+
+  memset(s, 0, sizeof(*s));
+  s->n = n;
+  s->nzc = nzc;
+  s->fcn = fcn;
+  s->arg = arg;
+  s->epsAbs = epsAbs;
+  s->epsRel = epsRel;
+  s->hmax = hmax;
+  s->h = 0.1 * hmax;
+  s->evtol = 1e-9 * hmax;
+
+  s->work = calloc(12 * n + 3 * nzc + 1, sizeof(double));
+  if (s->work == NULL)
+    return -1;
+
+  p = s->work;
+  s->x = p; p += n;
+  for (i = 0; i < 7; i++) {
+    s->k[i] = p; p += n;
+  }
+  s->xn = p; p += n;
+  s->xe = p; p += n;
+  s->xhi = p; p += n;
+  s->khi = p; p += n;
+  s->g0 = p; p += nzc;
+  s->g1 = p; p += nzc;
+  s->ghi = p;
+  return 0;
+}
+
+int pysim_vstep_advance(struct pysim_vstep *s, double t0, double t1)
+{
+  double t = t0;
+  double h = s->h;
+  double err, fac, hstep, lo, hi, mid;
+  int last;
+
+  if (s->n == 0)
+    return 0;
+
+  /* Inputs from the discrete blocks change at the sample hit */
+
+  s->fcn(t, s->x, s->k[0], s->g0, s->arg);
+  s->fevals++;
+
+  while (t < t1) {
+    last = h >= t1 - t;
+    hstep = last ? t1 - t : h;
+    if (hstep < 1e-14 * fmax(1.0, fabs(t))) {
+      fprintf(stderr, "Variable step solver: step size too small at t=%g\n", t);
+      return -1;
+    }
+
+    err = dp_step(s, t, hstep, s->xn, s->k[6], s->g1);
+    if (err > 1.0) {
+      s->rejected++;
+      h = hstep * fmax(0.2, 0.9 * pow(err, -0.25));
+      continue;
+    }
+
+    fac = err > 0.0 ? fmin(5.0, fmax(0.2, 0.9 * pow(err, -0.2))) : 5.0;
+    s->steps++;
+
+    if (s->nzc != 0 && crossed(s, s->g0, s->g1)) {
+
+      /* Shrink the step to end just behind the first crossing */
+
+      lo = 0.0;
+      hi = hstep;
+      memcpy(s->xhi, s->xn, s->n * sizeof(double));
+      memcpy(s->khi, s->k[6], s->n * sizeof(double));
+      while (hi - lo > s->evtol) {
+        mid = 0.5 * (lo + hi);
+        dp_step(s, t, mid, s->xn, s->k[6], s->g1);
+        if (crossed(s, s->g0, s->g1)) {
+          hi = mid;
+          SWAP(s->xhi, s->xn);
+          SWAP(s->khi, s->k[6]);
+        } else {
+          lo = mid;
+        }
+      }
+      s->events++;
+
+      t = (last && hi == hstep) ? t1 : t + hi;
+      SWAP(s->x, s->xhi);
+
+      /* The model may switch right after the crossing, start afresh */
+
+      s->fcn(t, s->x, s->k[0], s->g0, s->arg);
+      s->fevals++;
+      continue;
+    }
+
+    t = last ? t1 : t + hstep;
+    SWAP(s->x, s->xn);
+    SWAP(s->k[0], s->k[6]);
+    SWAP(s->g0, s->g1);
+
+    /* A step clipped at the sample hit does not limit the next one */
+
+    h = fmin(fmax(hstep * fac, last ? h : 0.0), s->hmax);
+  }
+
+  s->h = h;
+  return 0;
+}
+
+void pysim_vstep_end(struct pysim_vstep *s)
+{
+  free(s->work);
+  s->work = NULL;
+}
@@ -0,0 +1,63 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#ifndef ALGLOOP_H
+#define ALGLOOP_H
+
+/* Solver for the algebraic loops of a model.
+ *
+ * The generator cuts each loop at a few signals, the model function gets
+ * guesses z for them, evaluates the blocks of the loop and returns the
+ * values gz the blocks compute for the same signals. The solver looks for
+ * gz = z with Newton iterations on a finite difference Jacobian, started
+ * from the solution of the previous sample. The number of iterations per
+ * sample is limited, the last iterate is used when the limit is reached.
+ */
+
+typedef void (*pysim_algloop_fcn)(const double *z, double *gz, void *arg);
+
+struct pysim_algloop {
+  const char *name;
+  int n;                    /* Number of cut signals */
+  int maxIter;              /* Max. Newton iterations per sample */
+  double tol;               /* Max. residual, relative to |z| + 1 */
+  pysim_algloop_fcn fcn;
+  void *arg;
+
+  double *z;                /* Cut signals, kept between the samples */
+  double *work;             /* All other arrays, one allocation */
+  double *gz, *r, *J;
+  int *piv;
+
+  /* Statistics */
+
+  unsigned long solves;
+  unsigned long iterations;
+  unsigned long failures;   /* Solves stopped by maxIter */
+  int maxUsed;              /* Max. iterations of one solve */
+  double residual;          /* Residual of the last solve */
+};
+
+int pysim_algloop_init(struct pysim_algloop *l, const char *name, int n,
+                       int maxIter, double tol, pysim_algloop_fcn fcn,
+                       void *arg);
+int pysim_algloop_solve(struct pysim_algloop *l);
+void pysim_algloop_report(const struct pysim_algloop *l);
+void pysim_algloop_end(struct pysim_algloop *l);
+
+#endif /* ALGLOOP_H */
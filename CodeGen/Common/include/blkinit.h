@@ -0,0 +1,73 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#ifndef BLKINIT_H
+#define BLKINIT_H
+
+#include <pyblock.h>
+
+/* Start of the blocks of a model.
+ *
+ * The generated init function gives the CG_INIT calls of all blocks as a
+ * table. The blocks marked parallel (slow I/O touching only their own
+ * data, e.g. viewers and socket connections) run on worker threads, the
+ * others run in the table order in the calling thread at the same time.
+ *
+ * A block which gets ready later, e.g. when a connection is accepted,
+ * calls pysim_init_pending() in its CG_INIT and pysim_init_ready() from
+ * any thread when it is. The platform main waits for them with
+ * pysim_init_wait() before it starts the loop.
+ *
+ * Only the unix socket blocks report their readiness. The other device
+ * blocks (TCP, UDP, serial, ...) connect without telling, a model with
+ * any of them or without reporting blocks keeps the fixed settle time
+ * of the main, see pysim_init_settle(). FMU, TCP and comedi blocks are
+ * out of scope of the parallel start, they share static data between
+ * the instances or call gethostbyname.
+ */
+
+#define PYSIM_INIT_WORKERS  8
+
+/* Connection of a block */
+
+#define PYSIM_INIT_LOCAL    0     /* No connection */
+#define PYSIM_INIT_REPORTS  1     /* Reports its readiness */
+#define PYSIM_INIT_SETTLE   2     /* Connects without reporting */
+
+struct pysim_init_job {
+  void (*fcn)(int flag, python_block *block);
+  python_block *block;
+  const char *name;
+  int parallel;
+  int connect;              /* PYSIM_INIT_xxx */
+
+  /* Set by pysim_init_run */
+
+  double init;              /* s in CG_INIT */
+  double ready;             /* s from the start to the readiness */
+  int pending;
+};
+
+void pysim_init_run(struct pysim_init_job *jobs, int n);
+void pysim_init_pending(python_block *block);
+void pysim_init_ready(python_block *block);
+int pysim_init_wait(double timeout);
+int pysim_init_settle(void);
+void pysim_init_report(void);
+
+#endif
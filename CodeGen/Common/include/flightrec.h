@@ -0,0 +1,83 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#ifndef FLIGHTREC_H
+#define FLIGHTREC_H
+
+/* Flight recorder of the model data.
+ *
+ * The generated code describes the memory regions holding the model
+ * data (the node block and the parameters of the blocks with states)
+ * and the signals found in them as <model>_rec, only in builds with
+ * PYSIM_RT_TOOLS (the Linux templates). After each step the platform
+ * copies the regions into a preallocated ring of frames with
+ * pysim_rec_sample(). A recorder failing to allocate its ring stays off.
+ *
+ * A trigger freezes the ring after some more samples and a low priority
+ * thread writes it to a file, read by supsictrl/flightrec.py. The file
+ * has a text header, ended by a "data" line, followed by the frames.
+ *
+ * A hot swap (hotswap.h) prepares a second ring for the new version of
+ * the model while it loads, the RT thread switches the rings with the
+ * versions, the ring of the version ended is released.
+ */
+
+/* Memory copied each sample */
+
+struct pysim_rec_region {
+  void *ptr;
+  unsigned size;
+};
+
+/* Signal in a region, type 'd' double, 'f' float, 'q' pysim_q16 */
+
+struct pysim_rec_signal {
+  const char *name;
+  unsigned short region;
+  unsigned offset;
+  char type;
+  unsigned short n;
+};
+
+struct pysim_rec_model {
+  const char *name;
+  const struct pysim_rec_region *regions;
+  int nregions;
+  const struct pysim_rec_signal *signals;
+  int nsignals;
+};
+
+/* Trigger reasons */
+
+#define PYSIM_REC_OVERRUN   1
+#define PYSIM_REC_RANGE     2
+#define PYSIM_REC_COMMAND   3
+#define PYSIM_REC_SIGNAL    4
+#define PYSIM_REC_WATCHDOG  5
+
+int pysim_rec_open(const struct pysim_rec_model *model, double tsamp,
+                   double seconds, const char *dir);
+int pysim_rec_range(const char *spec);
+int pysim_rec_prepare(const struct pysim_rec_model *model);
+void pysim_rec_switch(void);
+void pysim_rec_release(void);
+void pysim_rec_sample(double t);
+void pysim_rec_trigger(int reason);
+void pysim_rec_close(void);
+
+#endif
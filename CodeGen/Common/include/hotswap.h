@@ -0,0 +1,90 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#ifndef HOTSWAP_H
+#define HOTSWAP_H
+
+#include <pyblock.h>
+#include <flightrec.h>
+
+/* Hot swap of the model of a running LinuxRT executable.
+ *
+ * The generated code describes the model as <model>_swap: its functions
+ * and its blocks, with the number of states each block keeps at the end
+ * of its realPar. A new version of the model, built as a shared module
+ * (make module), is loaded and initialized by a low priority thread while
+ * the running one goes on. The block code is not in the module, it is the
+ * one of the executable.
+ *
+ * - The device blocks found in both versions with the same name, function
+ *   and parameters are taken over by the new version, CG_INIT and CG_END
+ *   are skipped for them (<model>_swap_hook), so the devices are not
+ *   opened twice.
+ * - The states of the blocks with the same name, function and number of
+ *   states are copied by the RT thread between two samples, then the new
+ *   version runs the next sample.
+ * - For bumpless transfer the inputs of the device blocks get the
+ *   difference between the last outputs of the old version and the first
+ *   ones of the new version, ramped down to zero. The device blocks read
+ *   a copy of their inputs during the ramp, the nodes are not changed.
+ * - The flight recorder records the running version, the ring of the new
+ *   one is allocated while it loads (pysim_rec_prepare).
+ * - An overrun of the new version in the first samples switches back to
+ *   the old version the same way, else the old one is ended.
+ *
+ * Static executables cannot load a module, their main is built with
+ * PYSIM_NO_SWAP and runs the first version only.
+ */
+
+struct pysim_swap_block {
+  const char *name;
+  const char *fcn;
+  python_block *block;
+  unsigned short nstate;          /* States at the end of realPar */
+  unsigned char device;
+  unsigned long parcrc;           /* CRC-32 of the parameters */
+};
+
+struct pysim_swap_model {
+  const char *name;
+  const struct pysim_swap_block *blocks;
+  int nblocks;
+  void (*init)(void);
+  void (*isr)(double t);
+  void (*end)(void);
+  double (*get_tsamp)(void);
+  int *degraded;
+  int (**hook)(int flag, python_block *block);
+  const struct pysim_rec_model *rec;
+};
+
+/* Results of pysim_swap_sample */
+
+#define PYSIM_SWAP_NONE      0
+#define PYSIM_SWAP_SWITCHED  1    /* The new version runs from this sample */
+#define PYSIM_SWAP_ROLLBACK  2    /* Back to the old version */
+
+void pysim_swap_setup(const struct pysim_swap_model *model, const char *fname,
+                      double blend, double probation);
+int pysim_swap_request(void);
+const struct pysim_swap_model *pysim_swap_model(void);
+int pysim_swap_sample(int overrun);
+void pysim_swap_settle(void);
+void pysim_swap_close(void);
+
+#endif
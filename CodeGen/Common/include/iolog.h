@@ -0,0 +1,55 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#ifndef IOLOG_H
+#define IOLOG_H
+
+#include <pyblock.h>
+
+/* Record and replay of the device blocks.
+ *
+ * The generated code lists the device blocks of the model as
+ * <model>_io. In record mode the LinuxRT main logs the time and the
+ * outputs of these blocks after each step, the file is written by a low
+ * priority thread.
+ *
+ * A model compiled with PYSIM_REPLAY calls pysim_io_replay_blk instead of
+ * the device functions (so it links without the device libraries) and
+ * the sim main runs it on the times of the log, the device blocks giving
+ * the logged outputs.
+ */
+
+struct pysim_io_model {
+  const char *name;
+  python_block *const *blocks;
+  const char *const *names;
+  const int *nout;
+  int nblocks;
+};
+
+int pysim_io_record_open(const struct pysim_io_model *model, double tsamp,
+                         const char *fname);
+void pysim_io_record(double t);
+void pysim_io_record_close(void);
+
+int pysim_io_replay_open(const struct pysim_io_model *model, const char *fname);
+int pysim_io_replay_next(double *t);
+void pysim_io_replay_close(void);
+void pysim_io_replay_blk(int flag, python_block *block);
+
+#endif
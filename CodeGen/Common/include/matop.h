@@ -1,4 +1,6 @@
 int matmult(double *a, int na, int ma, double *b, int nb, int mb, double* c);
 int matsum(double *a, int na, int ma, double *b, int nb, int mb, double* c);
+int matlu(double *a, int n, int *piv);
+void matlusolve(const double *lu, int n, const int *piv, double *x);
 int integralFunc(double t, const double y[], double f[], void *params);
 int cssFunc(double t, const double y[], double f[], void *params);
@@ -32,6 +32,8 @@ typedef struct {
 
 /* Forward declaration */
 struct pysim_platform_model_ctx;
+struct shv_stream;
+struct shv_pysim_tree;
 
 /* Model's instance.
  * Currently, only those fields needed to be processed by SHV are defined.
@@ -43,11 +45,30 @@ struct pysim_model_ctx {
     void (*resumectrl)(struct pysim_platform_model_ctx *pt_arg);   /* The resume function */
     int  (*getctrlstate)(struct pysim_platform_model_ctx *pt_arg); /* The getctrlstate function */
     int  (*comprio)(struct pysim_platform_model_ctx *pt_arg);      /* The com priority function */
+    void (*recdump)(struct pysim_platform_model_ctx *pt_arg);      /* Flight recorder dump, optional */
   } pt_ops;
 };
 
 /* SHV related structures */
 
+/* Double-buffered copy of block's real parameters, without the states.
+ * Inside a transaction the communication layer writes only to the shadow
+ * set. A commit copies the modified values to the staged set and the RT
+ * thread swaps them into realPar at the next sample boundary, keeping
+ * the previous values in the backup set for a rollback.
+ */
+
+typedef struct {
+  double *shadow;           /* Values written by the communication layer */
+  double *staged;           /* Committed values waiting for the sample boundary */
+  double *backup;           /* Last-known-good values */
+  unsigned char *flags;     /* PYSIM_PARSET_xxx flags of each value */
+  int count;                /* Number of parameters at the start of realPar */
+} python_block_parset;
+
+#define PYSIM_PARSET_STAGED   1   /* Value waits to be applied */
+#define PYSIM_PARSET_APPLIED  2   /* Value changed by the last commit */
+
 typedef struct {
   const char * block_name;  /* Name of the block */
   int block_idx;            /* Index in python_block structure */
@@ -60,6 +81,12 @@ typedef struct {
   const python_block * block_structure;     /* Pointer to python_block structure */
   int blocks_count;                         /* Number of blocks */
   struct pysim_model_ctx *model_ctx;        /* Model's context */
+  python_block_parset * parsets;            /* Parameter sets, indexed as block_structure */
+  _Atomic int parset_pending;               /* Staged sets wait for the sample boundary */
+  int parset_open;                          /* Parameter nodes work on the shadow sets */
+  struct shv_stream *stream;                /* Signal streaming, NULL if not available */
+  int lazy_blocks;                          /* Max. blocks with built subtrees, 0 builds all */
+  struct shv_pysim_tree *tree;              /* Runtime state of the dynamic SHV tree */
 } python_block_name_map;
 
 #endif /* PYBLOCK_H */
@@ -0,0 +1,101 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#ifndef PYSIM_NUM_H
+#define PYSIM_NUM_H
+
+#include <stdint.h>
+
+/* Numeric types of the typed blocks.
+ *
+ * Models are generated with double signals by default. For targets
+ * with a single precision FPU or without an FPU the code generator can
+ * switch the core blocks to their _f32 or _q16 variants. Nodes driven by
+ * a typed block hold a float or a pysim_q16 value, the generator inserts
+ * cnv_xxx blocks on the boundaries to the double blocks.
+ *
+ * Typed blocks find a copy of realPar converted to their type in ptrPar,
+ * their states are kept there as well.
+ */
+
+/* Signed fixed point with 16 fractional bits, range <-32768, 32768) */
+
+typedef int32_t pysim_q16;
+
+#define PYSIM_Q16_FRAC   16
+#define PYSIM_Q16_ONE    ((pysim_q16)1 << PYSIM_Q16_FRAC)
+#define PYSIM_Q16_MAX    INT32_MAX
+#define PYSIM_Q16_MIN    INT32_MIN
+
+static inline pysim_q16 q16_sat(int64_t v)
+{
+  if (v > PYSIM_Q16_MAX)
+    return PYSIM_Q16_MAX;
+  if (v < PYSIM_Q16_MIN)
+    return PYSIM_Q16_MIN;
+  return (pysim_q16) v;
+}
+
+static inline pysim_q16 q16_from_double(double v)
+{
+  v *= PYSIM_Q16_ONE;
+  if (v >= (double) PYSIM_Q16_MAX)
+    return PYSIM_Q16_MAX;
+  if (v <= (double) PYSIM_Q16_MIN)
+    return PYSIM_Q16_MIN;
+  return (pysim_q16) (v < 0 ? v - 0.5 : v + 0.5);
+}
+
+static inline double q16_to_double(pysim_q16 v)
+{
+  return (double) v / PYSIM_Q16_ONE;
+}
+
+static inline pysim_q16 q16_add(pysim_q16 a, pysim_q16 b)
+{
+  return q16_sat((int64_t) a + b);
+}
+
+static inline pysim_q16 q16_sub(pysim_q16 a, pysim_q16 b)
+{
+  return q16_sat((int64_t) a - b);
+}
+
+/* Products are rounded to nearest */
+
+static inline int64_t q16_mul_wide(pysim_q16 a, pysim_q16 b)
+{
+  return ((int64_t) a * b + (1 << (PYSIM_Q16_FRAC - 1))) >> PYSIM_Q16_FRAC;
+}
+
+static inline pysim_q16 q16_mul(pysim_q16 a, pysim_q16 b)
+{
+  return q16_sat(q16_mul_wide(a, b));
+}
+
+static inline pysim_q16 q16_div(pysim_q16 a, pysim_q16 b)
+{
+  if (b == 0)
+    return a >= 0 ? PYSIM_Q16_MAX : PYSIM_Q16_MIN;
+  return q16_sat(((int64_t) a << PYSIM_Q16_FRAC) / b);
+}
+
+pysim_q16 q16_sin(pysim_q16 x);
+pysim_q16 q16_cos(pysim_q16 x);
+
+#endif /* PYSIM_NUM_H */
@@ -0,0 +1,33 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#ifndef THREADCLASS_H
+#define THREADCLASS_H
+
+/* Scheduling class of the calling thread, defined by each main.
+ *
+ * A thread started by a block or a platform service passes the name of
+ * its class ("com", "io", "monitor", ...). The Linux RT main applies the
+ * policy, priority and CPUs given for the class by --rt-env, the other
+ * mains keep the thread as created. Returns 0 when the settings are
+ * applied.
+ */
+
+int set_thread_class(const char *name);
+
+#endif
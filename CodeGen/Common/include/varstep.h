@@ -0,0 +1,70 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#ifndef VARSTEP_H
+#define VARSTEP_H
+
+/* Variable step solver for the continuous states of a model.
+ *
+ * Dormand-Prince 5(4) with error control over the whole state vector.
+ * pysim_vstep_advance() integrates from one sample hit to the next one,
+ * the step size is kept between the calls. The zero crossing functions
+ * returned by the model are checked after each accepted step, a sign
+ * change is located by bisection and the step ends just behind it, so
+ * discontinuities are never stepped over.
+ */
+
+/* Computes the derivatives dx and the zero crossing functions g of the
+ * model at t and x, dx or g may be NULL.
+ */
+
+typedef void (*pysim_vstep_fcn)(double t, const double *x, double *dx,
+                                double *g, void *arg);
+
+struct pysim_vstep {
+  int n;                    /* Number of states */
+  int nzc;                  /* Number of zero crossing functions */
+  pysim_vstep_fcn fcn;
+  void *arg;
+  double epsAbs;
+  double epsRel;
+  double hmax;              /* Max. step, the sampling time */
+  double h;                 /* Proposed size of the next step */
+  double evtol;             /* Width of the located event interval */
+
+  double *x;                /* States */
+  double *work;             /* All other arrays, one allocation */
+  double *k[7];
+  double *xn, *xe, *xhi, *khi;
+  double *g0, *g1, *ghi;
+
+  /* Statistics */
+
+  unsigned long steps;
+  unsigned long rejected;
+  unsigned long events;
+  unsigned long fevals;
+};
+
+int pysim_vstep_init(struct pysim_vstep *s, int n, int nzc, double epsAbs,
+                     double epsRel, double hmax, pysim_vstep_fcn fcn,
+                     void *arg);
+int pysim_vstep_advance(struct pysim_vstep *s, double t0, double t1);
+void pysim_vstep_end(struct pysim_vstep *s);
+
+#endif /* VARSTEP_H */
@@ -29,6 +29,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <string.h>
+#include <threadclass.h>
 
 #include "TCPdqf.h"
 
@@ -53,6 +54,7 @@ static void * TCP_data_read(void * p)
 
   int rxbuff_in_read = 0;
 
+  set_thread_class("com");
   while (!txrxst->rx_terminate && !txrxst->rx_terminated)
     {
       double *buff = txrxst->rxbuff[rxbuff_in_read];
@@ -97,6 +99,8 @@ static void * TCP_data_send(void * p)
   int ret;
   int terminate = 0;
   int empty = 0;
+
+  set_thread_class("com");
   while (!terminate || !empty)
     {
       void *d;
@@ -25,6 +25,7 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <threadclass.h>
 
 static void * getData(void * p)
 {
@@ -35,6 +36,8 @@ static void * getData(void * p)
   double *y;
   double data[block->nout];
 
+  set_thread_class("io");
+
   maxlen = block->nout*sizeof(double);
 
   while(1){
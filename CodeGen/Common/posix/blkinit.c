@@ -0,0 +1,223 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#include <blkinit.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+
+/* Jobs of the last start, the blocks are found by their python_block */
+
+static struct pysim_init_job *init_jobs;
+static int init_num;
+static int init_next;             /* Next parallel job to take */
+static int init_pending;
+static int init_settle = 1;       /* Not all connecting blocks report */
+static struct timespec init_t0;
+static double init_total;         /* s of pysim_init_run */
+static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t init_cond;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+/* The deadline of pysim_init_wait is on the monotonic clock */
+
+static void init_cond_clock(void)
+{
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&init_cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+static double elapsed(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (t.tv_sec - init_t0.tv_sec) + 1e-9 * (t.tv_nsec - init_t0.tv_nsec);
+}
+
+static struct pysim_init_job *find_job(python_block *block)
+{
+  int i;
+
+  for (i = 0; i < init_num; i++) {
+    if (init_jobs[i].block == block)
+      return &init_jobs[i];
+  }
+  return NULL;
+}
+
+/* A job without function is a block taken over by a hot swap */
+
+static void run_job(struct pysim_init_job *job)
+{
+  double t = elapsed();
+
+  if (job->fcn == NULL)
+    return;
+  job->fcn(CG_INIT, job->block);
+  job->init = elapsed() - t;
+}
+
+static void *worker(void *arg)
+{
+  int i;
+
+  (void) arg;
+  for (;;) {
+    pthread_mutex_lock(&init_mutex);
+    while (init_next < init_num && !init_jobs[init_next].parallel)
+      init_next++;
+    i = init_next++;
+    pthread_mutex_unlock(&init_mutex);
+    if (i >= init_num)
+      break;
+    run_job(&init_jobs[i]);
+  }
+  return NULL;
+}
+
+void pysim_init_run(struct pysim_init_job *jobs, int n)
+{
+  pthread_t thrd[PYSIM_INIT_WORKERS];
+  int i, npar = 0, nthrd = 0, nrep = 0, nsettle = 0;
+
+  pthread_once(&init_once, init_cond_clock);
+  clock_gettime(CLOCK_MONOTONIC, &init_t0);
+
+  pthread_mutex_lock(&init_mutex);
+  init_jobs = jobs;
+  init_num = n;
+  init_next = 0;
+  init_pending = 0;
+  for (i = 0; i < n; i++) {
+    jobs[i].init = 0.0;
+    jobs[i].ready = 0.0;
+    jobs[i].pending = 0;
+    npar += jobs[i].parallel != 0;
+    nrep += jobs[i].connect == PYSIM_INIT_REPORTS;
+    nsettle += jobs[i].connect == PYSIM_INIT_SETTLE;
+  }
+  init_settle = nrep == 0 || nsettle > 0;
+  pthread_mutex_unlock(&init_mutex);
+
+  while (nthrd < npar && nthrd < PYSIM_INIT_WORKERS) {
+    if (pthread_create(&thrd[nthrd], NULL, worker, NULL) != 0)
+      break;
+    nthrd++;
+  }
+
+  for (i = 0; i < n; i++) {
+    if (!jobs[i].parallel || nthrd == 0)
+      run_job(&jobs[i]);
+  }
+
+  for (i = 0; i < nthrd; i++)
+    pthread_join(thrd[i], NULL);
+  init_total = elapsed();
+}
+
+void pysim_init_pending(python_block *block)
+{
+  struct pysim_init_job *job;
+
+  pthread_mutex_lock(&init_mutex);
+  job = find_job(block);
+  if (job != NULL && !job->pending) {
+    job->pending = 1;
+    init_pending++;
+  }
+  pthread_mutex_unlock(&init_mutex);
+}
+
+void pysim_init_ready(python_block *block)
+{
+  struct pysim_init_job *job;
+
+  pthread_mutex_lock(&init_mutex);
+  job = find_job(block);
+  if (job != NULL && job->pending) {
+    job->pending = 0;
+    job->ready = elapsed();
+    if (--init_pending == 0)
+      pthread_cond_broadcast(&init_cond);
+  }
+  pthread_mutex_unlock(&init_mutex);
+}
+
+/* Returns the number of blocks still not ready after timeout s */
+
+int pysim_init_wait(double timeout)
+{
+  struct timespec t;
+  double dl = init_t0.tv_sec + 1e-9 * init_t0.tv_nsec + init_total + timeout;
+  int ret = 0;
+
+  pthread_once(&init_once, init_cond_clock);
+  t.tv_sec = (time_t) dl;
+  t.tv_nsec = (long) ((dl - t.tv_sec) * 1e9);
+
+  pthread_mutex_lock(&init_mutex);
+  while (init_pending > 0 && ret != ETIMEDOUT) {
+    ret = pthread_cond_timedwait(&init_cond, &init_mutex, &t);
+  }
+  ret = init_pending;
+  pthread_mutex_unlock(&init_mutex);
+  return ret;
+}
+
+/* Returns 1 if the platform has to give the blocks the fixed settle time
+ * after the init, as some connect without reporting their readiness.
+ * Also for models without the init table.
+ */
+
+int pysim_init_settle(void)
+{
+  return init_settle;
+}
+
+/* Blocks which took at least 1 ms or wait for a connection */
+
+void pysim_init_report(void)
+{
+  int i;
+
+  if (init_jobs == NULL)
+    return;
+
+  pthread_mutex_lock(&init_mutex);
+  printf("Init %.1f ms, ready after %.1f ms\n", 1e3 * init_total, 1e3 * elapsed());
+  for (i = 0; i < init_num; i++) {
+    struct pysim_init_job *job = &init_jobs[i];
+
+    if (job->pending) {
+      printf("  %-20s init %8.1f ms, not ready\n", job->name, 1e3 * job->init);
+    } else if (job->ready > 0.0) {
+      printf("  %-20s init %8.1f ms, ready %8.1f ms\n", job->name,
+             1e3 * job->init, 1e3 * job->ready);
+    } else if (job->init >= 1e-3) {
+      printf("  %-20s init %8.1f ms%s\n", job->name, 1e3 * job->init,
+             job->parallel ? " (parallel)" : "");
+    }
+  }
+  pthread_mutex_unlock(&init_mutex);
+}
@@ -0,0 +1,480 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#include <flightrec.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <threadclass.h>
+
+/* The RT thread writes the ring in REC_RUN and REC_POST, the writer
+ * thread reads it in REC_DUMP */
+
+#define REC_RUN         0
+#define REC_POST        1
+#define REC_DUMP        2
+
+#define REC_MAX_BYTES   (4 << 20)
+#define REC_POST_PART   10        /* Part of the ring kept after the trigger */
+#define REC_MAX_DUMPS   16
+#define REC_MAX_RANGES  16
+
+struct rec_range {
+  const char *name;
+  unsigned offset;              /* In the frame */
+  char type;
+  double min, max;
+  int out;
+};
+
+/* Frames of one version of the model */
+
+struct rec_ring {
+  const struct pysim_rec_model *model;
+  char *ring;
+  size_t frame_size;
+  unsigned long nframes;
+  unsigned *region_offset;
+  unsigned long head;           /* Frames written */
+  unsigned long rearm;          /* No trigger before a full ring after a dump */
+  struct rec_range ranges[REC_MAX_RANGES];
+  int nranges;
+};
+
+static const char *const reason_name[] = {
+  "none", "overrun", "range", "command", "signal", "watchdog"
+};
+
+/* The ring of the running version and the one of the other version
+ * during a hot swap, the RT thread switches between them */
+
+static struct rec_ring rings[2];
+static int cur;
+static int dumped;                      /* Ring written by the writer thread */
+static int rec_on;
+
+static double rec_tsamp;
+static double rec_seconds;
+static const char *rec_dir;
+static const char *range_specs[REC_MAX_RANGES];
+static int nspecs;
+
+static unsigned long post;              /* Frames still to write after the trigger */
+static unsigned long trig;              /* Frame of the trigger */
+static int reason;
+static int ndumps;
+
+static atomic_int state;
+static atomic_int pending;              /* Trigger not seen by the RT thread */
+static atomic_ulong dropped;            /* Triggers while frozen */
+static atomic_int writer_end;
+static sem_t writer_sem;
+static pthread_t writer_thrd;
+
+static double read_value(const char *p, char type)
+{
+  double d;
+  float f;
+  int32_t q;
+
+  switch (type) {
+  case 'f':
+    memcpy(&f, p, sizeof(f));
+    return f;
+  case 'q':
+    memcpy(&q, p, sizeof(q));
+    return q / 65536.0;
+  default:
+    memcpy(&d, p, sizeof(d));
+    return d;
+  }
+}
+
+static void rec_dump(void)
+{
+  const struct rec_ring *r = &rings[dumped];
+  const struct pysim_rec_model *m = r->model;
+  unsigned long count = r->head < r->nframes ? r->head : r->nframes;
+  unsigned long first = r->head - count;
+  unsigned long pos = first % r->nframes;
+  char fname[512], stamp[32];
+  time_t now = time(NULL);
+  struct tm tm;
+  uint16_t one = 1;
+  FILE *fp;
+  int i;
+
+  localtime_r(&now, &tm);
+  strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+  snprintf(fname, sizeof(fname), "%s/%s-%s-%d.rec", rec_dir, m->name, stamp, ndumps);
+
+  fp = fopen(fname, "wb");
+  if (fp == NULL) {
+    fprintf(stderr, "Flight recorder: %s: %s\n", fname, strerror(errno));
+    return;
+  }
+
+  fprintf(fp, "pysimCoder flight recorder 1\n");
+  fprintf(fp, "model %s\n", m->name);
+  fprintf(fp, "tsamp %.17g\n", rec_tsamp);
+  fprintf(fp, "reason %s\n", reason_name[reason]);
+  fprintf(fp, "trigger %lu\n", trig - first);
+  fprintf(fp, "frames %lu\n", count);
+  fprintf(fp, "framesize %zu\n", r->frame_size);
+  fprintf(fp, "endian %s\n", *(char *)&one ? "little" : "big");
+  fprintf(fp, "signal d 0 1 t\n");
+  for (i = 0; i < m->nsignals; i++) {
+    const struct pysim_rec_signal *sig = &m->signals[i];
+
+    fprintf(fp, "signal %c %u %u %s\n", sig->type,
+            r->region_offset[sig->region] + sig->offset, sig->n, sig->name);
+  }
+  fprintf(fp, "data\n");
+
+  /* Oldest frame first, the ring may wrap once */
+
+  if (pos + count > r->nframes) {
+    fwrite(r->ring + pos * r->frame_size, r->frame_size, r->nframes - pos, fp);
+    fwrite(r->ring, r->frame_size, count - (r->nframes - pos), fp);
+  } else {
+    fwrite(r->ring + pos * r->frame_size, r->frame_size, count, fp);
+  }
+
+  if (fclose(fp) != 0) {
+    fprintf(stderr, "Flight recorder: %s: %s\n", fname, strerror(errno));
+    return;
+  }
+  fprintf(stderr, "Flight recorder: %s, %lu frames, trigger %s\n",
+          fname, count, reason_name[reason]);
+}
+
+static void *rec_writer(void *p)
+{
+  (void) p;
+  set_thread_class("monitor");
+  for (;;) {
+    while (sem_wait(&writer_sem) < 0 && errno == EINTR)
+      ;
+    if (atomic_load_explicit(&state, memory_order_acquire) == REC_DUMP) {
+      rec_dump();
+      atomic_store_explicit(&state, REC_RUN, memory_order_release);
+    }
+    if (atomic_load(&writer_end))
+      break;
+  }
+  return NULL;
+}
+
+static int ring_alloc(struct rec_ring *r, const struct pysim_rec_model *model)
+{
+  size_t size = sizeof(double);
+  int i;
+
+  r->region_offset = malloc(model->nregions * sizeof(*r->region_offset));
+  if (r->region_offset == NULL)
+    return -1;
+  for (i = 0; i < model->nregions; i++) {
+    r->region_offset[i] = size;
+    size += (model->regions[i].size + 7) & ~7U;
+  }
+
+  r->frame_size = size;
+  r->nframes = rec_seconds / rec_tsamp + 0.5;
+  if (r->nframes < REC_POST_PART)
+    r->nframes = REC_POST_PART;
+  if (r->nframes * r->frame_size > REC_MAX_BYTES) {
+    r->nframes = REC_MAX_BYTES / r->frame_size;
+    fprintf(stderr, "Flight recorder: limited to %g s\n", r->nframes * rec_tsamp);
+  }
+
+  r->ring = malloc(r->nframes * r->frame_size);
+  if (r->ring == NULL) {
+    free(r->region_offset);
+    r->region_offset = NULL;
+    return -1;
+  }
+  memset(r->ring, 0, r->nframes * r->frame_size);  /* Fault the pages in now */
+
+  r->model = model;
+  r->head = 0;
+  r->rearm = 0;
+  r->nranges = 0;
+  printf("Flight recorder: %s, %g s, %lu frames of %zu bytes\n",
+         model->name, r->nframes * rec_tsamp, r->nframes, r->frame_size);
+  return 0;
+}
+
+static void ring_free(struct rec_ring *r)
+{
+  free(r->ring);
+  free(r->region_offset);
+  memset(r, 0, sizeof(*r));
+}
+
+static int ring_range(struct rec_ring *r, const char *spec)
+{
+  const struct pysim_rec_model *m = r->model;
+  const struct pysim_rec_signal *sig = NULL;
+  const char *eq = strrchr(spec, '=');
+  const char *sep = eq ? strchr(eq, ':') : NULL;
+  size_t len;
+  unsigned idx = 0;
+  struct rec_range *rg;
+  int i;
+
+  if (eq == NULL || sep == NULL || r->nranges == REC_MAX_RANGES) {
+    fprintf(stderr, "Flight recorder: invalid range \"%s\"\n", spec);
+    return -1;
+  }
+
+  len = eq - spec;
+  if (len > 0 && spec[len - 1] == ']') {
+    const char *br = memchr(spec, '[', len);
+
+    if (br != NULL) {
+      idx = atoi(br + 1);
+      len = br - spec;
+    }
+  }
+  for (i = 0; i < m->nsignals; i++) {
+    if (strlen(m->signals[i].name) == len &&
+        !strncmp(m->signals[i].name, spec, len)) {
+      sig = &m->signals[i];
+      break;
+    }
+  }
+  if (sig == NULL || idx >= sig->n) {
+    fprintf(stderr, "Flight recorder: no signal \"%.*s\" in %s\n",
+            (int)(eq - spec), spec, m->name);
+    return -1;
+  }
+
+  rg = &r->ranges[r->nranges++];
+  rg->name = sig->name;
+  rg->type = sig->type;
+  rg->offset = r->region_offset[sig->region] + sig->offset +
+               idx * (sig->type == 'd' ? sizeof(double) : 4);
+  rg->min = eq + 1 == sep ? -1e300 : atof(eq + 1);
+  rg->max = sep[1] == '\0' ? 1e300 : atof(sep + 1);
+  rg->out = 0;
+  return 0;
+}
+
+/* Returns 0 if the recorder is off (seconds 0) or ready, -1 on error.
+ * It may be opened again after pysim_rec_close, for another model. */
+
+int pysim_rec_open(const struct pysim_rec_model *model, double tsamp,
+                   double seconds, const char *dir)
+{
+  if (seconds <= 0.0 || tsamp <= 0.0)
+    return 0;
+
+  rec_tsamp = tsamp;
+  rec_seconds = seconds;
+  rec_dir = dir;
+  cur = 0;
+  nspecs = 0;
+  if (ring_alloc(&rings[cur], model) < 0)
+    return -1;
+
+  atomic_store(&pending, 0);
+  atomic_store(&dropped, 0);
+  atomic_store(&writer_end, 0);
+  atomic_store(&state, REC_RUN);
+  sem_init(&writer_sem, 0, 0);
+  if (pthread_create(&writer_thrd, NULL, rec_writer, NULL) != 0) {
+    ring_free(&rings[cur]);
+    return -1;
+  }
+  rec_on = 1;
+  return 0;
+}
+
+/* Range trigger "name=min:max", name[i] for an element of a vector,
+ * min or max may be empty. The text is kept for the versions prepared
+ * later. */
+
+int pysim_rec_range(const char *spec)
+{
+  if (!rec_on)
+    return 0;
+  if (ring_range(&rings[cur], spec) < 0)
+    return -1;
+  range_specs[nspecs++] = spec;
+  return 0;
+}
+
+/* Ring of another version of the model, not running yet. Ranges on
+ * signals it does not have are left out. Returns -1 if out of memory,
+ * the recorder pauses while that version runs then. */
+
+int pysim_rec_prepare(const struct pysim_rec_model *model)
+{
+  struct rec_ring *r = &rings[!cur];
+  int i;
+
+  if (!rec_on)
+    return 0;
+  pysim_rec_release();
+  if (ring_alloc(r, model) < 0)
+    return -1;
+  for (i = 0; i < nspecs; i++)
+    ring_range(r, range_specs[i]);
+  return 0;
+}
+
+/* Called by the RT thread between two samples when the other version
+ * runs from the next one. A dump in progress ends with the last frame
+ * of the version stopped. */
+
+void pysim_rec_switch(void)
+{
+  struct rec_ring *r = &rings[cur];
+
+  if (!rec_on)
+    return;
+  if (atomic_load_explicit(&state, memory_order_relaxed) == REC_POST) {
+    ndumps++;
+    r->rearm = r->head + r->nframes;
+    dumped = cur;
+    atomic_store_explicit(&state, REC_DUMP, memory_order_release);
+    sem_post(&writer_sem);
+  }
+  cur = !cur;
+}
+
+/* Frees the ring of the version not running, after a dump of it */
+
+void pysim_rec_release(void)
+{
+  struct timespec ts = {0, 1000 * 1000};
+  int other = !cur;
+
+  if (!rec_on || rings[other].ring == NULL)
+    return;
+  while (atomic_load_explicit(&state, memory_order_acquire) == REC_DUMP && dumped == other)
+    nanosleep(&ts, NULL);
+  ring_free(&rings[other]);
+}
+
+/* Called by the RT thread after each step */
+
+void pysim_rec_sample(double t)
+{
+  struct rec_ring *r = &rings[cur];
+  const struct pysim_rec_model *m = r->model;
+  int st = atomic_load_explicit(&state, memory_order_acquire);
+  char *frame;
+  double v;
+  int i, out;
+
+  if (r->ring == NULL)
+    return;
+  if (st == REC_DUMP) {
+    if (atomic_exchange_explicit(&pending, 0, memory_order_relaxed))
+      atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+    return;
+  }
+
+  frame = r->ring + (r->head % r->nframes) * r->frame_size;
+  memcpy(frame, &t, sizeof(t));
+  for (i = 0; i < m->nregions; i++)
+    memcpy(frame + r->region_offset[i], m->regions[i].ptr, m->regions[i].size);
+  r->head++;
+
+  /* A range trigger fires when the signal leaves the range */
+
+  for (i = 0; i < r->nranges; i++) {
+    v = read_value(frame + r->ranges[i].offset, r->ranges[i].type);
+    out = v < r->ranges[i].min || v > r->ranges[i].max;
+    if (out && !r->ranges[i].out)
+      pysim_rec_trigger(PYSIM_REC_RANGE);
+    r->ranges[i].out = out;
+  }
+
+  if (st == REC_RUN) {
+    int rs = atomic_exchange_explicit(&pending, 0, memory_order_relaxed);
+
+    if (rs == 0)
+      return;
+    if (ndumps == REC_MAX_DUMPS || r->head < r->rearm) {
+      atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+      return;
+    }
+    reason = rs;
+    trig = r->head - 1;
+    post = r->nframes / REC_POST_PART;
+    atomic_store_explicit(&state, REC_POST, memory_order_relaxed);
+  } else if (post > 0) {
+    post--;
+  } else {
+    ndumps++;
+    r->rearm = r->head + r->nframes;
+    dumped = cur;
+    atomic_store_explicit(&state, REC_DUMP, memory_order_release);
+    sem_post(&writer_sem);
+  }
+}
+
+/* Safe in a signal handler, the first trigger wins */
+
+void pysim_rec_trigger(int r)
+{
+  int none = 0;
+
+  atomic_compare_exchange_strong(&pending, &none, r);
+}
+
+/* Writes a dump still pending and stops the writer */
+
+void pysim_rec_close(void)
+{
+  struct rec_ring *r = &rings[cur];
+  int rs;
+
+  if (!rec_on)
+    return;
+
+  rs = atomic_exchange(&pending, 0);
+  if (atomic_load(&state) == REC_RUN && rs != 0 && r->head > 0 && ndumps < REC_MAX_DUMPS) {
+    reason = rs;
+    trig = r->head - 1;
+    atomic_store(&state, REC_POST);
+  }
+  if (atomic_load(&state) == REC_POST) {
+    ndumps++;
+    dumped = cur;
+    atomic_store_explicit(&state, REC_DUMP, memory_order_release);
+  }
+  atomic_store(&writer_end, 1);
+  sem_post(&writer_sem);
+  pthread_join(writer_thrd, NULL);
+  sem_destroy(&writer_sem);
+
+  if (atomic_load(&dropped) > 0)
+    fprintf(stderr, "Flight recorder: %lu triggers ignored\n", atomic_load(&dropped));
+  ring_free(&rings[0]);
+  ring_free(&rings[1]);
+  rec_on = 0;
+}
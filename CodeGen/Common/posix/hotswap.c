@@ -0,0 +1,579 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#include <hotswap.h>
+#include <blkinit.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <threadclass.h>
+
+/* The swap thread loads a version (LOADING -> READY), the RT thread
+ * switches to it (PROBATION), may switch back, and waits for the end of
+ * the ramp (SETTLING), then the swap thread ends the version not running
+ * (RETIRING -> IDLE). The modules are never unloaded, threads of the
+ * device blocks may still use the blocks of an old version. */
+
+#define SWAP_IDLE       0
+#define SWAP_LOADING    1
+#define SWAP_READY      2
+#define SWAP_PROBATION  3
+#define SWAP_SETTLING   4
+#define SWAP_RETIRING   5
+
+#define SWAP_INIT_WAIT  1.0       /* s for the blocks still connecting */
+
+struct swap_version {
+  const struct pysim_swap_model *model;
+  void *handle;
+  python_block **owner;           /* Per block, first block of a device taken over */
+};
+
+/* A block found in both versions, by slot */
+
+struct swap_pair {
+  python_block *blk[2];
+  void **u[2];
+  void **y[2];
+  python_block *owner;            /* Device taken over, else NULL */
+  int nstate;
+  int blend;
+  int armed;
+  double *offset;
+  double *last;                   /* Inputs of the other version at the switch */
+  double *in;                     /* Inputs of the device during the ramp */
+  void **node;                    /* Input nodes of the ramped block */
+  python_block *ramped;           /* Block reading in[], else NULL */
+};
+
+static struct swap_version ver[2];
+static int run;                   /* Slot of the running version */
+static int loaded;                /* Slot of the last version loaded */
+static int retiring = -1;         /* Slot being ended */
+static struct swap_pair *pairs;
+static int npairs;
+
+static const char *swap_file;
+static unsigned long blend_n;     /* Samples of the ramp */
+static unsigned long blend_k;
+static unsigned long probation_n;
+static unsigned long probation_left;
+
+static atomic_int phase;
+static atomic_int requested;
+static atomic_int swap_end;
+static pthread_mutex_t swap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static sem_t swap_sem;
+static pthread_t swap_thrd;
+static int thrd_started;
+
+static int find_block(const struct pysim_swap_model *m, python_block *block)
+{
+  int i;
+
+  for (i = 0; i < m->nblocks; i++) {
+    if (m->blocks[i].block == block)
+      return i;
+  }
+  return -1;
+}
+
+static int find_name(const struct pysim_swap_model *m, const struct pysim_swap_block *b)
+{
+  int i;
+
+  for (i = 0; i < m->nblocks; i++) {
+    if (!strcmp(m->blocks[i].name, b->name) && !strcmp(m->blocks[i].fcn, b->fcn))
+      return i;
+  }
+  return -1;
+}
+
+/* CG_INIT of a device block of the version loading: takes over the
+ * device of the running version if nothing changed */
+
+static int adopt(python_block *block)
+{
+  const struct pysim_swap_model *om = ver[run].model;
+  const struct pysim_swap_model *nm = ver[loaded].model;
+  int i = find_block(nm, block);
+  int j = i < 0 ? -1 : find_name(om, &nm->blocks[i]);
+  python_block *old;
+
+  if (j < 0 || !nm->blocks[i].device || !om->blocks[j].device ||
+      nm->blocks[i].parcrc != om->blocks[j].parcrc)
+    return 0;
+
+  old = om->blocks[j].block;
+  if (old->nin != block->nin || old->nout != block->nout ||
+      old->realParNum != block->realParNum || old->intParNum != block->intParNum)
+    return 0;
+
+  block->realPar = old->realPar;
+  block->intPar = old->intPar;
+  block->ptrPar = old->ptrPar;
+  ver[loaded].owner[i] = ver[run].owner != NULL && ver[run].owner[j] != NULL ?
+                         ver[run].owner[j] : old;
+  return 1;
+}
+
+/* Bumpless transfer, the inputs of a device block get the difference to
+ * the last inputs of the other version, ramped down. The nodes are shared
+ * with other blocks and not written, the device reads a private copy in
+ * in[] until unramp() */
+
+static void ramp(python_block *block)
+{
+  struct swap_pair *p;
+  double w;
+  int i;
+
+  if (blend_k >= blend_n)
+    return;
+  for (p = pairs; p < pairs + npairs; p++) {
+    if (p->blend && p->blk[run] == block)
+      break;
+  }
+  if (p == pairs + npairs)
+    return;
+
+  if (p->armed) {
+    for (i = 0; i < block->nin; i++) {
+      p->node[i] = block->u[i];
+      p->offset[i] = p->last[i] - *(double *) p->node[i];
+      block->u[i] = &p->in[i];
+    }
+    p->ramped = block;
+    p->armed = 0;
+  }
+  w = 1.0 - (double) blend_k / blend_n;
+  for (i = 0; i < block->nin; i++)
+    p->in[i] = *(double *) p->node[i] + w * p->offset[i];
+}
+
+/* Inputs of the ramped device blocks back on their nodes */
+
+static void unramp(struct swap_pair *p)
+{
+  int i;
+
+  if (p->ramped == NULL)
+    return;
+  for (i = 0; i < p->ramped->nin; i++)
+    p->ramped->u[i] = p->node[i];
+  p->ramped = NULL;
+}
+
+static void unramp_all(void)
+{
+  struct swap_pair *p;
+
+  for (p = pairs; p < pairs + npairs; p++)
+    unramp(p);
+}
+
+static int swap_hook(int flag, python_block *block)
+{
+  struct swap_pair *p;
+
+  switch (flag) {
+  case CG_INIT:
+    return atomic_load(&phase) == SWAP_LOADING && adopt(block);
+  case CG_END:
+    if (retiring < 0)
+      return 0;
+    if (retiring == loaded) {
+      int i = find_block(ver[loaded].model, block);
+
+      return i >= 0 && ver[loaded].owner[i] != NULL;
+    }
+    for (p = pairs; p < pairs + npairs; p++) {
+      if (p->owner != NULL && p->blk[retiring] == block)
+        return 1;
+    }
+    return 0;
+  case CG_OUT:
+    ramp(block);
+    return 0;
+  }
+  return 0;
+}
+
+static void free_pairs(void)
+{
+  int i;
+
+  for (i = 0; i < npairs; i++) {
+    free(pairs[i].offset);
+    free(pairs[i].node);
+  }
+  free(pairs);
+  pairs = NULL;
+  npairs = 0;
+}
+
+/* Blocks found in both versions, after the init of the new one */
+
+static int map_blocks(void)
+{
+  const struct pysim_swap_model *om = ver[run].model;
+  const struct pysim_swap_model *nm = ver[loaded].model;
+  int i, j, nstates = 0, ndev = 0, nnew = 0;
+
+  pairs = calloc(nm->nblocks, sizeof(*pairs));
+  if (pairs == NULL)
+    return -1;
+
+  for (i = 0; i < nm->nblocks; i++) {
+    const struct pysim_swap_block *nb = &nm->blocks[i];
+    struct swap_pair *p = &pairs[npairs];
+    python_block *ob;
+
+    j = find_name(om, nb);
+    if (j < 0) {
+      if (nb->nstate > 0)
+        printf("  %-20s new, initial states\n", nb->name);
+      nnew++;
+      continue;
+    }
+    ob = om->blocks[j].block;
+
+    p->blk[run] = ob;
+    p->blk[loaded] = nb->block;
+    p->u[run] = ob->u;
+    p->u[loaded] = nb->block->u;
+    p->y[run] = ob->y;
+    p->y[loaded] = nb->block->y;
+    p->owner = ver[loaded].owner[i];
+    if (p->owner != NULL)
+      ndev++;
+
+    if (nb->nstate > 0 && nb->nstate == om->blocks[j].nstate &&
+        nb->block->realParNum >= nb->nstate && ob->realParNum >= nb->nstate) {
+      p->nstate = nb->nstate;
+      nstates++;
+    } else if (nb->nstate > 0) {
+      printf("  %-20s %d states, was %d, initial states\n", nb->name,
+             nb->nstate, om->blocks[j].nstate);
+    }
+
+    if (blend_n > 0 && nb->device && nb->block->nin > 0 && nb->block->nin == ob->nin) {
+      p->offset = calloc(3 * ob->nin, sizeof(double));
+      p->node = calloc(ob->nin, sizeof(void *));
+      if (p->offset == NULL || p->node == NULL)
+        return -1;
+      p->last = p->offset + ob->nin;
+      p->in = p->last + ob->nin;
+      p->blend = 1;
+    }
+    npairs++;
+  }
+
+  printf("Hot swap: %d blocks with states transferred, %d devices taken over, %d new blocks\n",
+         nstates, ndev, nnew);
+  return 0;
+}
+
+/* The module is opened from a copy, dlopen of a path already loaded
+ * would give the old version again */
+
+static void *open_copy(void)
+{
+  static unsigned count;
+  const char *dir = getenv("TMPDIR");
+  char path[512], buf[8192];
+  FILE *in, *out;
+  size_t n;
+  void *h;
+
+  snprintf(path, sizeof(path), "%s/pysim-swap-%d-%u.so", dir ? dir : "/tmp",
+           (int) getpid(), count++);
+  in = fopen(swap_file, "rb");
+  if (in == NULL) {
+    fprintf(stderr, "Hot swap: %s: %s\n", swap_file, strerror(errno));
+    return NULL;
+  }
+  out = fopen(path, "wb");
+  if (out == NULL) {
+    fprintf(stderr, "Hot swap: %s: %s\n", path, strerror(errno));
+    fclose(in);
+    return NULL;
+  }
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    fwrite(buf, 1, n, out);
+  fclose(in);
+  if (fclose(out) != 0) {
+    fprintf(stderr, "Hot swap: %s: %s\n", path, strerror(errno));
+    unlink(path);
+    return NULL;
+  }
+
+  h = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (h == NULL)
+    fprintf(stderr, "Hot swap: %s\n", dlerror());
+  unlink(path);
+  return h;
+}
+
+static void load(void)
+{
+  const struct pysim_swap_model *om = ver[run].model;
+  const struct pysim_swap_model *nm;
+  char sym[256];
+  void *h;
+
+  h = open_copy();
+  if (h == NULL)
+    return;
+  snprintf(sym, sizeof(sym), "%s_swap", om->name);
+  nm = dlsym(h, sym);
+  if (nm == NULL) {
+    fprintf(stderr, "Hot swap: %s is not a module of the model %s\n", swap_file, om->name);
+    dlclose(h);
+    return;
+  }
+  if (nm->get_tsamp() != om->get_tsamp()) {
+    fprintf(stderr, "Hot swap: sample time %g s, running %g s\n",
+            nm->get_tsamp(), om->get_tsamp());
+    dlclose(h);
+    return;
+  }
+
+  loaded = !run;
+  ver[loaded].model = nm;
+  ver[loaded].handle = h;
+  ver[loaded].owner = calloc(nm->nblocks, sizeof(python_block *));
+  if (ver[loaded].owner == NULL) {
+    dlclose(h);
+    return;
+  }
+
+  printf("Hot swap: loading %s\n", swap_file);
+  atomic_store(&phase, SWAP_LOADING);
+  *nm->hook = swap_hook;
+  nm->init();
+  if (pysim_init_wait(SWAP_INIT_WAIT) > 0)
+    printf("Hot swap: blocks not ready\n");
+  if (map_blocks() < 0) {
+    fprintf(stderr, "Hot swap: out of memory\n");
+    retiring = loaded;
+    nm->end();
+    retiring = -1;
+    free_pairs();
+    atomic_store(&phase, SWAP_IDLE);
+    return;
+  }
+  if (pysim_rec_prepare(nm->rec) < 0)
+    fprintf(stderr, "Hot swap: out of memory, new version not recorded\n");
+  atomic_store_explicit(&phase, SWAP_READY, memory_order_release);
+}
+
+/* Ends the version not running, the devices taken over stay open */
+
+static void retire(void)
+{
+  int slot = !run;
+  int used = atomic_load(&phase) != SWAP_READY;
+
+  retiring = slot;
+  ver[slot].model->end();
+  retiring = -1;
+
+  if (slot == loaded) {
+    printf(used ? "Hot swap: rolled back\n" : "Hot swap: version loaded not used\n");
+  } else {
+    printf("Hot swap: new version committed\n");
+  }
+  pysim_rec_release();
+  free(ver[slot].owner);
+  memset(&ver[slot], 0, sizeof(ver[slot]));
+  free_pairs();
+  atomic_store(&phase, SWAP_IDLE);
+}
+
+static void *swap_thread(void *arg)
+{
+  (void) arg;
+  set_thread_class("monitor");
+  for (;;) {
+    while (sem_wait(&swap_sem) < 0 && errno == EINTR)
+      ;
+    if (atomic_load(&swap_end))
+      break;
+
+    pthread_mutex_lock(&swap_mutex);
+    if (atomic_load(&phase) == SWAP_RETIRING) {
+      retire();
+    } else if (atomic_exchange(&requested, 0)) {
+      if (atomic_load(&phase) == SWAP_IDLE)
+        load();
+      else
+        fprintf(stderr, "Hot swap: already in progress\n");
+    }
+    pthread_mutex_unlock(&swap_mutex);
+  }
+  return NULL;
+}
+
+/* The module fname is loaded on pysim_swap_request(), NULL disables the
+ * swap. blend and probation are in s. */
+
+void pysim_swap_setup(const struct pysim_swap_model *model, const char *fname,
+                      double blend, double probation)
+{
+  double tsamp = model->get_tsamp();
+
+  ver[0].model = model;
+  run = 0;
+  swap_file = fname;
+  blend_n = blend > 0.0 ? blend / tsamp + 0.5 : 0;
+  blend_k = blend_n;
+  probation_n = probation > 0.0 ? probation / tsamp + 0.5 : 0;
+
+  if (fname == NULL)
+    return;
+  *model->hook = swap_hook;
+  sem_init(&swap_sem, 0, 0);
+  if (pthread_create(&swap_thrd, NULL, swap_thread, NULL) != 0) {
+    fprintf(stderr, "Hot swap: no thread, disabled\n");
+    return;
+  }
+  thrd_started = 1;
+}
+
+/* Safe in a signal handler */
+
+int pysim_swap_request(void)
+{
+  if (!thrd_started)
+    return -1;
+  atomic_store(&requested, 1);
+  sem_post(&swap_sem);
+  return 0;
+}
+
+const struct pysim_swap_model *pysim_swap_model(void)
+{
+  return ver[run].model;
+}
+
+/* Between two samples, by the RT thread */
+
+static void switch_version(void)
+{
+  int to = !run;
+  struct swap_pair *p;
+  int i;
+
+  for (p = pairs; p < pairs + npairs; p++) {
+    python_block *from = p->blk[run];
+    python_block *dst = p->blk[to];
+
+    if (p->nstate > 0)
+      memcpy(&dst->realPar[dst->realParNum - p->nstate],
+             &from->realPar[from->realParNum - p->nstate], p->nstate * sizeof(double));
+    if (p->blend) {
+      for (i = 0; i < from->nin; i++)
+        p->last[i] = *(double *) from->u[i];
+      unramp(p);
+    }
+    if (p->owner != NULL) {
+      p->owner->u = p->u[to];
+      p->owner->y = p->y[to];
+    }
+    p->armed = p->blend;
+  }
+  *ver[to].model->degraded = *ver[run].model->degraded;
+  pysim_rec_switch();
+  run = to;
+  blend_k = 0;
+}
+
+/* Called by the RT thread after each sample, overrun is set if the sample
+ * was late */
+
+int pysim_swap_sample(int overrun)
+{
+  int ret = PYSIM_SWAP_NONE;
+
+  if (blend_k < blend_n && ++blend_k == blend_n)
+    unramp_all();
+
+  switch (atomic_load_explicit(&phase, memory_order_acquire)) {
+  case SWAP_READY:
+    switch_version();
+    probation_left = probation_n;
+    atomic_store(&phase, SWAP_PROBATION);
+    ret = PYSIM_SWAP_SWITCHED;
+    break;
+  case SWAP_PROBATION:
+    if (overrun) {
+      switch_version();
+      atomic_store(&phase, SWAP_SETTLING);
+      ret = PYSIM_SWAP_ROLLBACK;
+    } else if (probation_left > 0) {
+      probation_left--;
+    } else {
+      atomic_store(&phase, SWAP_SETTLING);
+    }
+    break;
+  case SWAP_SETTLING:
+    if (blend_k >= blend_n) {
+      atomic_store(&phase, SWAP_RETIRING);
+      sem_post(&swap_sem);
+    }
+    break;
+  }
+  return ret;
+}
+
+/* With the loop stopped: ends the version not running, a version
+ * switched to is kept */
+
+void pysim_swap_settle(void)
+{
+  if (!thrd_started)
+    return;
+
+  pthread_mutex_lock(&swap_mutex);
+  if (atomic_load(&phase) != SWAP_IDLE) {
+    blend_k = blend_n;
+    unramp_all();
+    retire();
+  }
+  pthread_mutex_unlock(&swap_mutex);
+}
+
+void pysim_swap_close(void)
+{
+  if (!thrd_started)
+    return;
+
+  pysim_swap_settle();
+  atomic_store(&swap_end, 1);
+  sem_post(&swap_sem);
+  pthread_join(swap_thrd, NULL);
+  sem_destroy(&swap_sem);
+  thrd_started = 0;
+}
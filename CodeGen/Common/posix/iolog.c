@@ -0,0 +1,265 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#include <iolog.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <threadclass.h>
+
+/* Log: text header ended by a "data" line, then one frame per sample,
+ * the time and the outputs of the device blocks as doubles */
+
+#define IO_RING_MIN     1024      /* Frames */
+#define IO_RING_TIME    2.0       /* s of samples buffered for the writer */
+#define IO_FLUSH_NS     20000000
+
+static const struct pysim_io_model *io_model;
+static FILE *io_fp;
+static double *frame;             /* Replay: current frame */
+static size_t frame_len;          /* Doubles */
+static unsigned long replayed;
+
+/* Record ring, the RT thread writes the head, the writer the tail */
+
+static double *ring;
+static unsigned long nframes;
+static atomic_ulong head;
+static atomic_ulong tail;
+static atomic_ulong lost;
+static atomic_int writer_end;
+static pthread_t writer_thrd;
+
+static size_t count_values(const struct pysim_io_model *m)
+{
+  size_t n = 0;
+  int i;
+
+  for (i = 0; i < m->nblocks; i++)
+    n += m->nout[i];
+  return n;
+}
+
+static void *io_writer(void *p)
+{
+  struct timespec ts = {0, IO_FLUSH_NS};
+  unsigned long h, t, n;
+  int last;
+
+  (void) p;
+  set_thread_class("monitor");
+  do {
+    last = atomic_load(&writer_end);
+    h = atomic_load_explicit(&head, memory_order_acquire);
+    t = atomic_load_explicit(&tail, memory_order_relaxed);
+    while (t != h) {
+      n = nframes - t % nframes;
+      if (n > h - t)
+        n = h - t;
+      fwrite(ring + (t % nframes) * frame_len, frame_len * sizeof(double), n, io_fp);
+      t += n;
+      atomic_store_explicit(&tail, t, memory_order_release);
+    }
+    if (!last)
+      nanosleep(&ts, NULL);
+  } while (!last);
+  return NULL;
+}
+
+int pysim_io_record_open(const struct pysim_io_model *model, double tsamp,
+                         const char *fname)
+{
+  uint16_t one = 1;
+  int i;
+
+  io_fp = fopen(fname, "wb");
+  if (io_fp == NULL) {
+    fprintf(stderr, "I/O log: %s: %s\n", fname, strerror(errno));
+    return -1;
+  }
+
+  io_model = model;
+  frame_len = 1 + count_values(model);
+  nframes = IO_RING_TIME / tsamp;
+  if (nframes < IO_RING_MIN)
+    nframes = IO_RING_MIN;
+  ring = malloc(nframes * frame_len * sizeof(double));
+  if (ring == NULL) {
+    fclose(io_fp);
+    return -1;
+  }
+  memset(ring, 0, nframes * frame_len * sizeof(double));
+
+  fprintf(io_fp, "pysimCoder io log 1\n");
+  fprintf(io_fp, "model %s\n", model->name);
+  fprintf(io_fp, "tsamp %.17g\n", tsamp);
+  fprintf(io_fp, "endian %s\n", *(char *)&one ? "little" : "big");
+  for (i = 0; i < model->nblocks; i++)
+    fprintf(io_fp, "block %d %s\n", model->nout[i], model->names[i]);
+  fprintf(io_fp, "data\n");
+
+  if (pthread_create(&writer_thrd, NULL, io_writer, NULL) != 0) {
+    fclose(io_fp);
+    free(ring);
+    ring = NULL;
+    return -1;
+  }
+  printf("I/O log: %s, %d blocks, %zu values\n", fname, model->nblocks, frame_len - 1);
+  return 0;
+}
+
+/* Called by the RT thread after each step */
+
+void pysim_io_record(double t)
+{
+  const struct pysim_io_model *m = io_model;
+  unsigned long h = atomic_load_explicit(&head, memory_order_relaxed);
+  double *fr;
+  int i, j;
+
+  if (ring == NULL)
+    return;
+  if (h - atomic_load_explicit(&tail, memory_order_acquire) >= nframes) {
+    atomic_fetch_add_explicit(&lost, 1, memory_order_relaxed);
+    return;
+  }
+
+  fr = ring + (h % nframes) * frame_len;
+  *fr++ = t;
+  for (i = 0; i < m->nblocks; i++) {
+    python_block *blk = m->blocks[i];
+
+    for (j = 0; j < m->nout[i]; j++)
+      *fr++ = *(double *) blk->y[j];
+  }
+  atomic_store_explicit(&head, h + 1, memory_order_release);
+}
+
+void pysim_io_record_close(void)
+{
+  if (ring == NULL)
+    return;
+
+  atomic_store(&writer_end, 1);
+  pthread_join(writer_thrd, NULL);
+  if (fclose(io_fp) != 0)
+    perror("I/O log");
+  if (atomic_load(&lost) > 0)
+    fprintf(stderr, "I/O log: %lu samples lost (disk too slow), the replay is not exact\n",
+            atomic_load(&lost));
+  free(ring);
+  ring = NULL;
+}
+
+/* The log has to come from the same model, the device blocks are
+ * compared by name and number of outputs */
+
+int pysim_io_replay_open(const struct pysim_io_model *model, const char *fname)
+{
+  char line[512], name[256];
+  int nout, i = 0;
+
+  io_fp = fopen(fname, "rb");
+  if (io_fp == NULL) {
+    fprintf(stderr, "I/O log: %s: %s\n", fname, strerror(errno));
+    return -1;
+  }
+  if (fgets(line, sizeof(line), io_fp) == NULL ||
+      strncmp(line, "pysimCoder io log ", 18) != 0) {
+    fprintf(stderr, "I/O log: %s is not a log\n", fname);
+    fclose(io_fp);
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), io_fp) != NULL && strcmp(line, "data\n") != 0) {
+    if (sscanf(line, "model %255s", name) == 1 && strcmp(name, model->name) != 0) {
+      fprintf(stderr, "I/O log: recorded by model %s\n", name);
+    } else if (sscanf(line, "block %d %255[^\n]", &nout, name) == 2) {
+      if (i == model->nblocks || nout != model->nout[i] ||
+          strcmp(name, model->names[i]) != 0) {
+        fprintf(stderr, "I/O log: device block %s does not match the model\n", name);
+        fclose(io_fp);
+        return -1;
+      }
+      i++;
+    }
+  }
+  if (i != model->nblocks) {
+    fprintf(stderr, "I/O log: device blocks of the model missing in the log\n");
+    fclose(io_fp);
+    return -1;
+  }
+
+  io_model = model;
+  frame_len = 1 + count_values(model);
+  frame = calloc(frame_len, sizeof(double));
+  if (frame == NULL) {
+    fclose(io_fp);
+    return -1;
+  }
+  setvbuf(io_fp, NULL, _IOFBF, 1 << 20);
+  replayed = 0;
+  return 0;
+}
+
+/* Reads the next frame, returns 0 at the end of the log */
+
+int pysim_io_replay_next(double *t)
+{
+  if (fread(frame, sizeof(double), frame_len, io_fp) != frame_len)
+    return 0;
+  *t = frame[0];
+  replayed++;
+  return 1;
+}
+
+void pysim_io_replay_close(void)
+{
+  if (frame == NULL)
+    return;
+  fclose(io_fp);
+  free(frame);
+  frame = NULL;
+  printf("I/O log: %lu samples replayed\n", replayed);
+}
+
+/* Replaces the function of a device block, the outputs are taken from
+ * the current frame */
+
+void pysim_io_replay_blk(int flag, python_block *block)
+{
+  const struct pysim_io_model *m = io_model;
+  size_t off = 1;
+  int i;
+
+  if (flag == CG_INIT) {
+    for (i = 0; i < m->nblocks && m->blocks[i] != block; i++)
+      off += m->nout[i];
+    block->ptrPar = &frame[off];
+  } else if (flag == CG_OUT) {
+    double *val = block->ptrPar;
+
+    for (i = 0; i < block->nout; i++)
+      *(double *) block->y[i] = val[i];
+  }
+}
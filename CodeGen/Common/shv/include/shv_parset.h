@@ -0,0 +1,59 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#ifndef _SHV_PARSET_H
+#define _SHV_PARSET_H
+
+#include <pyblock.h>
+
+/* Parameter transactions.
+ *
+ * A plain set of a parameter node writes realPar at once, as it always
+ * did. A client which needs several values to change in the same sample
+ * opens a transaction first, then the parameter nodes read and write
+ * the shadow set of each block and the values are handed over to the RT
+ * thread this way:
+ *
+ *  shv_parset_begin()    - com thread, open the transaction, the shadow
+ *                          set starts from the current values
+ *  shv_parset_commit()   - com thread, copy modified shadow values
+ *                          to the staged set and mark them pending
+ *  shv_parset_apply()    - RT thread, at the start of the sample, swap
+ *                          the staged values into realPar
+ *  shv_parset_rollback() - com thread, stage the values replaced by
+ *                          the last commit (and drop uncommitted edits)
+ *
+ * Commit and rollback close the transaction. Begin, commit and rollback
+ * return -1 if the previous transaction has not been applied yet (the
+ * model is paused or the sample has not started yet).
+ *
+ * The sets cover the parameters only, the states some blocks keep at
+ * the end of realPar are always accessed directly.
+ */
+
+void shv_parset_init(python_block_name_map *block_map);
+int shv_parset_begin(python_block_name_map *block_map);
+int shv_parset_commit(python_block_name_map *block_map);
+int shv_parset_rollback(python_block_name_map *block_map);
+void shv_parset_apply(python_block_name_map *block_map);
+
+/* Parameter nodes, val_ptr points to the value in realPar */
+
+extern const struct shv_dmap shv_parset_dmap;
+
+#endif /* _SHV_PARSET_H */
@@ -36,10 +36,21 @@
  *       ...
  */
 
+/* Lazy tree (SHV tree type GAVL_LAZY) builds block's parameters, inputs
+ * and outputs on the first ls or dir of the block node or on the first
+ * request with a path below it, and keeps at most CONF_SHV_LAZY_BLOCKS
+ * built blocks.
+ */
+
+#ifndef CONF_SHV_LAZY_BLOCKS
+#define CONF_SHV_LAZY_BLOCKS 16
+#endif
+
 /* A SHV node used by the model's manager */
 struct shv_node_model_ctx {
   struct shv_node shv_node;          /* Node instance */
   struct pysim_model_ctx *model_ctx; /* A pointer to the model's context, needed for interaction */
+  python_block_name_map *block_map;  /* Blocks of the model, needed for parameter transactions */
 };
 
 struct shv_node_model_ctx *shv_node_model_ctx_new(const char *child_name,
@@ -54,7 +65,7 @@ struct shv_con_ctx *shv_tree_init(python_block_name_map * block_map,
                                   struct shv_dotdevice_node *dotdevice_node,
                                   struct shv_fwstable_node *fwstable_node);
 
-void shv_tree_end(struct shv_con_ctx *ctx, int mode);
+void shv_tree_end(python_block_name_map *block_map, struct shv_con_ctx *ctx, int mode);
 
 extern const struct shv_dmap shv_blk_dmap;
 
@@ -0,0 +1,137 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#ifndef _SHV_STREAM_H
+#define _SHV_STREAM_H
+
+#include <pthread.h>
+
+#include <shv/tree/shv_tree.h>
+#include <shv/tree/shv_com.h>
+
+/* Signal streaming.
+ *
+ * Instead of polling every signal node, a client subscribes the signals
+ * it wants to watch (method subscribe on the signal node). The RT thread
+ * snapshots all subscribed signals into a ring of frames once per sample
+ * (shv_stream_sample), the publisher thread drains the ring and emits
+ * chng signals. Each subscription has its own decimation, deadband and
+ * minimal period between two published values.
+ *
+ * The number of subscriptions and the ring depth are fixed at build time,
+ * no memory is allocated after shv_stream_new().
+ *
+ * The publisher shares the connection with the com thread. The frames
+ * of one publisher run are packed into a batch written at once under
+ * the connection lock, which the com thread holds while it runs a method
+ * of a node (the nodes get their dmap through shv_stream_dmap) and from
+ * a message it sends on its own until it reads the next one
+ * (shv_stream_attach), so the frames never interleave. If a dmap cannot
+ * be locked, the tree runs without streaming.
+ *
+ * The attached connection can also pass the path of each request it reads
+ * to a hook before the library resolves it (shv_stream_set_path_hook),
+ * the lazy tree uses it to build the block named in the path.
+ */
+
+#ifndef CONF_SHV_STREAM_SLOTS
+#define CONF_SHV_STREAM_SLOTS    64     /* Max. number of subscribed signals */
+#endif
+
+#ifndef CONF_SHV_STREAM_DEPTH
+#define CONF_SHV_STREAM_DEPTH    32     /* Frames in the ring, power of 2 */
+#endif
+
+#ifndef CONF_SHV_STREAM_PERIOD_MS
+#define CONF_SHV_STREAM_PERIOD_MS 20    /* Publisher thread period */
+#endif
+
+#ifndef CONF_SHV_STREAM_BATCH
+#define CONF_SHV_STREAM_BATCH    2048   /* Bytes of chng frames written at once */
+#endif
+
+struct shv_stream_sub {
+  const double *_Atomic signal; /* Subscribed signal, NULL if the slot is free */
+  const char *path;         /* Path of the signal node in the SHV tree */
+  int decimation;           /* Publish every n-th sample */
+  double deadband;          /* Minimal change of value to be published */
+  double min_period;        /* Minimal time between two published values */
+
+  /* Publisher's state, accessed by the publisher thread only */
+
+  int dec_cnt;
+  int published;
+  double last_val;
+  double last_t;
+};
+
+struct shv_stream {
+  struct shv_stream_sub subs[CONF_SHV_STREAM_SLOTS];
+  _Atomic int subs_hwm;     /* All used slots are below this index */
+
+  /* Frames are t followed by values of all slots below subs_hwm */
+
+  double frames[CONF_SHV_STREAM_DEPTH][CONF_SHV_STREAM_SLOTS + 1];
+  _Atomic unsigned int locin;  /* Written by the RT thread */
+  _Atomic unsigned int locout; /* Written by the publisher thread */
+  unsigned int lostcount;   /* Frames dropped because the ring was full */
+
+  char batch[CONF_SHV_STREAM_BATCH]; /* Publisher's frames */
+
+  struct shv_con_ctx *shv_ctx;
+  pthread_t thrd;
+  int started;
+  volatile int terminate;
+};
+
+/* A signal node, read-only double value which can be subscribed */
+
+struct shv_node_signal {
+  struct shv_node shv_node;
+  const double *val_ptr;
+  struct shv_stream *stream;
+  int slot;                 /* Slot in stream's subscriptions, -1 if none */
+  char *path;               /* Full SHV path, used for chng signals */
+};
+
+extern const struct shv_dmap shv_signal_dmap;
+
+/* nth counts the paths of one read from the connection */
+
+typedef void (*shv_stream_path_hook)(const char *path, int nth, void *arg);
+
+struct shv_stream *shv_stream_new(void);
+void shv_stream_set_path_hook(shv_stream_path_hook hook, void *arg);
+void shv_stream_attach(struct shv_con_ctx *shv_ctx);
+const struct shv_dmap *shv_stream_dmap(const struct shv_dmap *dmap);
+int shv_stream_start(struct shv_stream *stream, struct shv_con_ctx *shv_ctx,
+                     int prio);
+void shv_stream_stop(struct shv_stream *stream);
+int shv_stream_subscribed(const struct shv_stream *stream, const char *prefix);
+
+struct shv_node_signal *shv_node_signal_new(const char *parent_path,
+                                            const char *child_name,
+                                            const double *val_ptr,
+                                            struct shv_stream *stream,
+                                            int mode);
+
+/* Called by the RT thread at the end of each sample */
+
+void shv_stream_sample(struct shv_stream *stream, double t);
+
+#endif /* _SHV_STREAM_H */
@@ -18,6 +18,7 @@
 #include <pyblock.h>
 #include <shv_pysim.h>
 #include <shv_manager_node.h>
+#include <shv_parset.h>
 
 #include <shv/tree/shv_tree.h>
 #include <shv/tree/shv_methods.h>
@@ -54,6 +55,21 @@ static int shv_resumectrl(struct shv_con_ctx *shv_ctx, struct shv_node *item, in
     return -1;
 }
 
+static int shv_dumprec(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+    shv_unpack_data(&shv_ctx->unpack_ctx, 0, 0);
+    struct shv_node_model_ctx *item_node = UL_CONTAINEROF(item, struct shv_node_model_ctx,
+                                                          shv_node);
+    struct pysim_model_ctx *mctx = item_node->model_ctx;
+    if (mctx->pt_ops.recdump) {
+        mctx->pt_ops.recdump(mctx->pt_arg);
+        shv_send_empty_response(shv_ctx, rid);
+        return 0;
+    }
+    shv_send_error(shv_ctx, rid, SHV_RE_METHOD_CALL_EXCEPTION, "Platform has no flight recorder!");
+    return -1;
+}
+
 static int shv_getstate(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
 {
     shv_unpack_data(&shv_ctx->unpack_ctx, 0, 0);
@@ -68,6 +84,69 @@ static int shv_getstate(struct shv_con_ctx *shv_ctx, struct shv_node *item, int
     return -1;
 }
 
+static int shv_beginpars(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+    shv_unpack_data(&shv_ctx->unpack_ctx, 0, 0);
+    struct shv_node_model_ctx *item_node = UL_CONTAINEROF(item, struct shv_node_model_ctx,
+                                                          shv_node);
+    if (item_node->block_map && shv_parset_begin(item_node->block_map) == 0) {
+        shv_send_empty_response(shv_ctx, rid);
+        return 0;
+    }
+    shv_send_error(shv_ctx, rid, SHV_RE_METHOD_CALL_EXCEPTION, "Previous commit not applied yet!");
+    return -1;
+}
+
+static int shv_commitpars(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+    shv_unpack_data(&shv_ctx->unpack_ctx, 0, 0);
+    struct shv_node_model_ctx *item_node = UL_CONTAINEROF(item, struct shv_node_model_ctx,
+                                                          shv_node);
+    if (item_node->block_map && shv_parset_commit(item_node->block_map) == 0) {
+        shv_send_empty_response(shv_ctx, rid);
+        return 0;
+    }
+    shv_send_error(shv_ctx, rid, SHV_RE_METHOD_CALL_EXCEPTION, "Previous commit not applied yet!");
+    return -1;
+}
+
+static int shv_rollbackpars(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+    shv_unpack_data(&shv_ctx->unpack_ctx, 0, 0);
+    struct shv_node_model_ctx *item_node = UL_CONTAINEROF(item, struct shv_node_model_ctx,
+                                                          shv_node);
+    if (item_node->block_map && shv_parset_rollback(item_node->block_map) == 0) {
+        shv_send_empty_response(shv_ctx, rid);
+        return 0;
+    }
+    shv_send_error(shv_ctx, rid, SHV_RE_METHOD_CALL_EXCEPTION, "Previous commit not applied yet!");
+    return -1;
+}
+
+static const struct shv_method_des shv_dmap_item_beginpars =
+{
+  .name = "begin",
+  .result = "",
+  .access = SHV_ACCESS_COMMAND,
+  .method = shv_beginpars
+};
+
+static const struct shv_method_des shv_dmap_item_commitpars =
+{
+  .name = "commit",
+  .result = "",
+  .access = SHV_ACCESS_COMMAND,
+  .method = shv_commitpars
+};
+
+static const struct shv_method_des shv_dmap_item_rollbackpars =
+{
+  .name = "rollback",
+  .result = "",
+  .access = SHV_ACCESS_COMMAND,
+  .method = shv_rollbackpars
+};
+
 static const struct shv_method_des shv_dmap_item_pausectrl =
 {
   .name = "pause",
@@ -84,6 +163,14 @@ static const struct shv_method_des shv_dmap_item_resumectrl =
   .method = shv_resumectrl
 };
 
+static const struct shv_method_des shv_dmap_item_dumprec =
+{
+  .name = "dumprec",
+  .result = "",
+  .access = SHV_ACCESS_COMMAND,
+  .method = shv_dumprec
+};
+
 static const struct shv_method_des shv_dmap_item_getctrlstate =
 {
   .name = "getstate",
@@ -96,11 +183,15 @@ static const struct shv_method_des shv_dmap_item_getctrlstate =
 
 static const struct shv_method_des * const shv_manager_dmap_items[] =
 {
+  &shv_dmap_item_beginpars,
+  &shv_dmap_item_commitpars,
   &shv_dmap_item_dir,
+  &shv_dmap_item_dumprec,
   &shv_dmap_item_getctrlstate,
   &shv_dmap_item_ls,
   &shv_dmap_item_pausectrl,
-  &shv_dmap_item_resumectrl
+  &shv_dmap_item_resumectrl,
+  &shv_dmap_item_rollbackpars
 };
 
 const struct shv_dmap shv_manager_dmap =
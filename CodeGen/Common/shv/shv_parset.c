@@ -0,0 +1,327 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include <pyblock.h>
+#include <shv_parset.h>
+
+#include <shv/tree/shv_tree.h>
+#include <shv/tree/shv_methods.h>
+#include <shv/tree/shv_com.h>
+#include <ulut/ul_utdefs.h>
+
+/* Model of the parameter nodes, the com thread serves one model */
+
+static python_block_name_map *parset_map;
+
+/****************************************************************************
+ * Name: shv_parset_init
+ *
+ * Description:
+ *  Binds the parameter nodes to the model. Called before the com thread
+ *  starts.
+ *
+ ****************************************************************************/
+
+void shv_parset_init(python_block_name_map *block_map)
+{
+  block_map->parset_open = 0;
+  parset_map = block_map;
+}
+
+/****************************************************************************
+ * Name: shv_parset_value
+ *
+ * Description:
+ *  Returns the value a parameter node works with, the shadow one inside
+ *  a transaction, else the one in realPar.
+ *
+ ****************************************************************************/
+
+static double *shv_parset_value(double *val_ptr)
+{
+  python_block_name_map *block_map = parset_map;
+
+  if (block_map == NULL || !block_map->parset_open)
+    {
+      return val_ptr;
+    }
+
+  for (int i = 0; i < block_map->blocks_count; i++)
+    {
+      python_block_parset *parset = &block_map->parsets[i];
+      double *realPar = block_map->block_structure[i].realPar;
+
+      if (parset->count > 0 && val_ptr >= realPar && val_ptr < realPar + parset->count)
+        {
+          return &parset->shadow[val_ptr - realPar];
+        }
+    }
+
+  /* States are not in the sets */
+
+  return val_ptr;
+}
+
+/****************************************************************************
+ * Name: shv_parset_begin
+ *
+ * Description:
+ *  Opens a transaction. Called from the communication thread.
+ *
+ ****************************************************************************/
+
+int shv_parset_begin(python_block_name_map *block_map)
+{
+  if (block_map->parsets == NULL)
+    {
+      return -1;
+    }
+
+  if (atomic_load_explicit(&block_map->parset_pending, memory_order_acquire))
+    {
+      return -1;
+    }
+
+  /* Plain sets may have changed realPar since the last transaction */
+
+  for (int i = 0; i < block_map->blocks_count; i++)
+    {
+      python_block_parset *parset = &block_map->parsets[i];
+      double *realPar = block_map->block_structure[i].realPar;
+
+      for (int j = 0; j < parset->count; j++)
+        {
+          parset->shadow[j] = realPar[j];
+          parset->staged[j] = realPar[j];
+        }
+    }
+
+  block_map->parset_open = 1;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: shv_parset_commit
+ *
+ * Description:
+ *  Stages all shadow values modified in the transaction and closes it.
+ *  Called from the communication thread.
+ *
+ ****************************************************************************/
+
+int shv_parset_commit(python_block_name_map *block_map)
+{
+  int staged = 0;
+
+  if (block_map->parsets == NULL)
+    {
+      return -1;
+    }
+
+  if (atomic_load_explicit(&block_map->parset_pending, memory_order_acquire))
+    {
+      return -1;
+    }
+
+  for (int i = 0; i < block_map->blocks_count; i++)
+    {
+      python_block_parset *parset = &block_map->parsets[i];
+
+      for (int j = 0; j < parset->count; j++)
+        {
+          parset->flags[j] &= ~PYSIM_PARSET_STAGED;
+          if (parset->shadow[j] != parset->staged[j])
+            {
+              parset->staged[j] = parset->shadow[j];
+              parset->flags[j] |= PYSIM_PARSET_STAGED;
+              staged = 1;
+            }
+        }
+    }
+
+  block_map->parset_open = 0;
+  if (staged)
+    {
+      atomic_store_explicit(&block_map->parset_pending, 1, memory_order_release);
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: shv_parset_rollback
+ *
+ * Description:
+ *  Drops uncommitted shadow values and stages the last-known-good values
+ *  of the parameters changed by the last commit. Called from
+ *  the communication thread, closes the transaction if one is open.
+ *
+ ****************************************************************************/
+
+int shv_parset_rollback(python_block_name_map *block_map)
+{
+  int staged = 0;
+
+  if (block_map->parsets == NULL)
+    {
+      return -1;
+    }
+
+  if (atomic_load_explicit(&block_map->parset_pending, memory_order_acquire))
+    {
+      return -1;
+    }
+
+  for (int i = 0; i < block_map->blocks_count; i++)
+    {
+      python_block_parset *parset = &block_map->parsets[i];
+
+      for (int j = 0; j < parset->count; j++)
+        {
+          if (parset->flags[j] & PYSIM_PARSET_APPLIED)
+            {
+              parset->staged[j] = parset->backup[j];
+              parset->flags[j] = PYSIM_PARSET_STAGED;
+              staged = 1;
+            }
+          else
+            {
+              parset->flags[j] = 0;
+            }
+          parset->shadow[j] = parset->staged[j];
+        }
+    }
+
+  block_map->parset_open = 0;
+  if (staged)
+    {
+      atomic_store_explicit(&block_map->parset_pending, 1, memory_order_release);
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: shv_parset_apply
+ *
+ * Description:
+ *  Swaps the staged values into blocks' realPar. Called from the RT thread
+ *  at the sample boundary, before any block is computed. Does nothing
+ *  if no transaction is pending.
+ *
+ ****************************************************************************/
+
+void shv_parset_apply(python_block_name_map *block_map)
+{
+  if (!atomic_load_explicit(&block_map->parset_pending, memory_order_acquire))
+    {
+      return;
+    }
+
+  for (int i = 0; i < block_map->blocks_count; i++)
+    {
+      python_block_parset *parset = &block_map->parsets[i];
+      double *realPar = block_map->block_structure[i].realPar;
+
+      for (int j = 0; j < parset->count; j++)
+        {
+          if (parset->flags[j] & PYSIM_PARSET_STAGED)
+            {
+              parset->backup[j] = realPar[j];
+              realPar[j] = parset->staged[j];
+              parset->flags[j] = PYSIM_PARSET_APPLIED;
+            }
+          else
+            {
+              parset->flags[j] = 0;
+            }
+        }
+    }
+
+  atomic_store_explicit(&block_map->parset_pending, 0, memory_order_release);
+}
+
+/****************************************************************************
+ * Parameter node methods
+ ****************************************************************************/
+
+static int shv_parset_get(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+  shv_unpack_data(&shv_ctx->unpack_ctx, 0, 0);
+  struct shv_node_typed_val *item_val = UL_CONTAINEROF(item, struct shv_node_typed_val,
+                                                       shv_node);
+  shv_send_double(shv_ctx, rid, *shv_parset_value(item_val->val_ptr));
+  return 0;
+}
+
+static int shv_parset_set(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+  double value;
+  struct shv_node_typed_val *item_val = UL_CONTAINEROF(item, struct shv_node_typed_val,
+                                                       shv_node);
+
+  if (shv_unpack_data(&shv_ctx->unpack_ctx, 0, &value) < 0)
+    {
+      shv_send_error(shv_ctx, rid, SHV_RE_INVALID_PARAMS, "Double value expected!");
+      return -1;
+    }
+
+  *shv_parset_value(item_val->val_ptr) = value;
+  shv_send_empty_response(shv_ctx, rid);
+  return 0;
+}
+
+static const struct shv_method_des shv_dmap_item_parset_get =
+{
+  .name = "get",
+  .flags = SHV_METHOD_GETTER,
+  .param = "i(0,)|n",
+  .result = "f",
+  .access = SHV_ACCESS_READ,
+  .method = shv_parset_get
+};
+
+static const struct shv_method_des shv_dmap_item_parset_set =
+{
+  .name = "set",
+  .param = "f",
+  .result = "",
+  .access = SHV_ACCESS_WRITE,
+  .method = shv_parset_set
+};
+
+static const struct shv_method_des * const shv_parset_dmap_items[] =
+{
+  &shv_dmap_item_dir,
+  &shv_dmap_item_parset_get,
+  &shv_dmap_item_ls,
+  &shv_dmap_item_parset_set,
+};
+
+const struct shv_dmap shv_parset_dmap =
+{
+  .methods =
+  {
+    .items = (void **)shv_parset_dmap_items,
+    .count = sizeof(shv_parset_dmap_items)/sizeof(shv_parset_dmap_items[0]),
+    .alloc_count = 0,
+  }
+};
@@ -30,6 +30,42 @@
 
 #include <shv_pysim.h>
 #include <shv_manager_node.h>
+#include <shv_parset.h>
+#include <shv_stream.h>
+
+#define SHV_PYSIM_PATH_MAXLEN 128
+#define SHV_PYSIM_NAME_LEN    10
+
+/* A block node of the lazy tree.
+ * Parameters, inputs and outputs of the block are built on the first
+ * ls or dir of the block node or on the first request with a path below
+ * the block. Only block_map->lazy_blocks blocks keep
+ * their subtrees, the least recently used one is released when another
+ * block is built or when the allocation fails.
+ */
+
+struct shv_node_blk {
+  struct shv_node shv_node;
+  python_block_name_map *block_map;
+  int index;                          /* Index in block_structure */
+  int built;                          /* Subtree is allocated */
+  struct shv_node *children[3];       /* parameters, inputs and outputs */
+  struct shv_node_blk *lru_prev;      /* Towards the most recently used */
+  struct shv_node_blk *lru_next;      /* Towards the least recently used */
+};
+
+/* Runtime state of the dynamically allocated tree */
+
+struct shv_pysim_tree {
+  char (*in_names)[SHV_PYSIM_NAME_LEN]; /* Interned "inputN" names */
+  int in_names_count;
+  int mode;                             /* Node list mode of the tree */
+  int built_count;                      /* Blocks with allocated subtrees */
+  struct shv_node_blk *lru_first;       /* Most recently used block */
+  struct shv_node_blk *lru_last;        /* Least recently used block */
+  struct shv_node_blk **lazy_nodes;     /* Block nodes of the lazy tree */
+  int lazy_nodes_count;
+};
 
 static const struct shv_method_des * const shv_blk_dmap_items[] = {
   &shv_dmap_item_dir,
@@ -41,6 +77,87 @@ const struct shv_dmap shv_blk_dmap = {.methods = {.items = (void **)shv_blk_dmap
                                              .alloc_count = 0,
                                             }};
 
+/* Lazy block's dir and ls, filled from the library's ones in
+ * shv_tree_create, only the method is replaced.
+ */
+
+static struct shv_method_des shv_blk_lazy_item_dir;
+static struct shv_method_des shv_blk_lazy_item_ls;
+
+static const struct shv_method_des * const shv_blk_lazy_dmap_items[] = {
+  &shv_blk_lazy_item_dir,
+  &shv_blk_lazy_item_ls,
+};
+
+static const struct shv_dmap shv_blk_lazy_dmap =
+{
+  .methods =
+  {
+    .items = (void **)shv_blk_lazy_dmap_items,
+    .count = sizeof(shv_blk_lazy_dmap_items)/sizeof(shv_blk_lazy_dmap_items[0]),
+    .alloc_count = 0,
+  }
+};
+
+/****************************************************************************
+ * Name: shv_tree_dmap
+ *
+ * Description:
+ *  Returns the dmap for a node of the dynamic tree. With streaming,
+ *  the methods run under the connection lock shared with the publisher.
+ *
+ ****************************************************************************/
+
+static const struct shv_dmap *shv_tree_dmap(python_block_name_map *block_map,
+                                            const struct shv_dmap *dmap)
+{
+  return block_map->stream != NULL ? shv_stream_dmap(dmap) : dmap;
+}
+
+/****************************************************************************
+ * Name: shv_tree_names_init
+ *
+ * Description:
+ *  Allocates the table of input names shared by all nodes of the tree.
+ *  The names of typed value nodes are not owned by the nodes, so one
+ *  string per index is enough for the whole model.
+ *
+ ****************************************************************************/
+
+static int shv_tree_names_init(struct shv_pysim_tree *tree,
+                               python_block_name_map *block_map)
+{
+  int count = 0;
+
+  for (int i = 0; i < block_map->blocks_count; i++)
+    {
+      const python_block *blk;
+
+      blk = &block_map->block_structure[block_map->blocks[i].block_idx];
+      count = blk->nin > count ? blk->nin : count;
+      count = blk->nout > count ? blk->nout : count;
+    }
+
+  if (count == 0)
+    {
+      return 0;
+    }
+
+  tree->in_names = malloc(count * sizeof(tree->in_names[0]));
+  if (tree->in_names == NULL)
+    {
+      return -1;
+    }
+
+  for (int j = 0; j < count; j++)
+    {
+      snprintf(tree->in_names[j], SHV_PYSIM_NAME_LEN, "input%d", j % 1000);
+    }
+
+  tree->in_names_count = count;
+  return 0;
+}
+
 /****************************************************************************
  * Name: shv_add_block
  *
@@ -49,17 +166,25 @@ const struct shv_dmap shv_blk_dmap = {.methods = {.items = (void **)shv_blk_dmap
  *
  ****************************************************************************/
 
-static void shv_add_block(python_block_name_map *block_map, int index,
-                   struct shv_node *item_blk, int mode)
+static int shv_add_block(python_block_name_map *block_map, int index,
+                         struct shv_node *item_blk, struct shv_node **children,
+                         int mode)
 {
-  struct shv_node *item_blk_par = shv_tree_node_new("parameters", &shv_dir_ls_dmap, mode);
+  const struct shv_dmap *dir_ls_dmap = shv_tree_dmap(block_map, &shv_dir_ls_dmap);
+  const struct shv_dmap *parset_dmap = shv_tree_dmap(block_map, &shv_parset_dmap);
+  const struct shv_dmap *input_dmap = shv_tree_dmap(block_map, &shv_double_read_only_dmap);
+  char parent_path[SHV_PYSIM_PATH_MAXLEN];
+  int ret = 0;
+
+  struct shv_node *item_blk_par = shv_tree_node_new("parameters", dir_ls_dmap, mode);
   if (item_blk_par == NULL)
     {
       printf("ERROR: Failed to allocate memory for SHV tree block's parameters.");
-      return;
+      return -1;
     }
 
   shv_tree_add_child(item_blk, item_blk_par);
+  children[0] = item_blk_par;
 
   /* For each parameter */
 
@@ -67,7 +192,14 @@ static void shv_add_block(python_block_name_map *block_map, int index,
     {
       const char *par_name = block_map->block_structure[index].realParNames[j];
       struct shv_node_typed_val *item_par = shv_tree_node_typed_val_new(par_name,
-                                                            &shv_double_dmap, mode);
+                                                            parset_dmap, mode);
+      if (item_par == NULL)
+        {
+          printf("ERROR: Failed to allocate memory for SHV tree parameter.\n");
+          return -1;
+        }
+
+      /* Inside a transaction the shadow set is used, see shv_parset.h */
 
       item_par->val_ptr = &block_map->block_structure[index].realPar[j];
       item_par->type_name = "double";
@@ -75,28 +207,27 @@ static void shv_add_block(python_block_name_map *block_map, int index,
       shv_tree_add_child(item_blk_par, &item_par->shv_node);
     }
 
-  struct shv_node *item_blk_ins = shv_tree_node_new("inputs", &shv_dir_ls_dmap, mode);
+  struct shv_node *item_blk_ins = shv_tree_node_new("inputs", dir_ls_dmap, mode);
   if (item_blk_ins == NULL)
     {
       printf("ERROR: Failed to allocate memory for SHV tree block's inputs.");
-      return;
+      return -1;
     }
 
   shv_tree_add_child(item_blk, item_blk_ins);
+  children[1] = item_blk_ins;
 
   for (int j = 0; j < block_map->block_structure[index].nin; j++)
     {
-      char *input_name = malloc(sizeof(char) * 10);
-      if (input_name == NULL)
-        {
-          printf("ERROR: malloc() failed to allocate space for input_name.\n");
-          continue;
-        }
-
-      snprintf(input_name, 10, "input%d", j % 1000);
+      const char *input_name = block_map->tree->in_names[j];
       struct shv_node_typed_val *item_val = shv_tree_node_typed_val_new(input_name,
-                                                           &shv_double_read_only_dmap,
+                                                           input_dmap,
                                                            mode);
+      if (item_val == NULL)
+        {
+          printf("ERROR: Failed to allocate memory for SHV tree input.\n");
+          return -1;
+        }
 
       double *u = block_map->block_structure[index].u[j];
       item_val->val_ptr = &u[0];
@@ -105,35 +236,41 @@ static void shv_add_block(python_block_name_map *block_map, int index,
       shv_tree_add_child(item_blk_ins, &item_val->shv_node);
     }
 
-  struct shv_node *item_blk_outs = shv_tree_node_new("outputs", &shv_dir_ls_dmap, mode);
+  struct shv_node *item_blk_outs = shv_tree_node_new("outputs", dir_ls_dmap, mode);
   if (item_blk_outs == NULL)
     {
       printf("ERROR: Failed to allocate memory for SHV tree block's inputs.");
-      return;
+      return -1;
     }
 
   shv_tree_add_child(item_blk, item_blk_outs);
+  children[2] = item_blk_outs;
+
+  /* Outputs are signal nodes, they can be subscribed for streaming */
+
+  snprintf(parent_path, sizeof(parent_path), "blocks/%s/outputs", item_blk->name);
 
   for (int j = 0; j < block_map->block_structure[index].nout; j++)
     {
-      char *output_name = malloc(sizeof(char) * 10);
-      if (output_name == NULL)
-        {
-          printf("ERROR: malloc() failed to allocate space for input_name.\n");
-          continue;
-        }
+      char output_name[10];
 
       snprintf(output_name, 10, "output%d", j % 1000);
-      struct shv_node_typed_val *item_val = shv_tree_node_typed_val_new(output_name,
-                                                           &shv_double_read_only_dmap,
-                                                           mode);
 
-      double *u = block_map->block_structure[index].y[j];
-      item_val->val_ptr = &u[0];
-      item_val->type_name = "double";
+      double *y = block_map->block_structure[index].y[j];
+      struct shv_node_signal *item_sig = shv_node_signal_new(parent_path, output_name,
+                                                             &y[0], block_map->stream,
+                                                             mode);
+      if (item_sig == NULL)
+        {
+          printf("ERROR: Failed to allocate memory for SHV signal node.\n");
+          ret = -1;
+          continue;
+        }
 
-      shv_tree_add_child(item_blk_outs, &item_val->shv_node);
+      shv_tree_add_child(item_blk_outs, &item_sig->shv_node);
     }
+
+  return ret;
 }
 
 /****************************************************************************
@@ -151,18 +288,17 @@ static void shv_add_system_in(python_block_name_map *block_map, int index,
 
   for (int j = 0; j < block_map->block_structure[index].nout; j++)
     {
-      char *input_name = malloc(sizeof(char) * 10);
-      if (input_name == NULL)
+      const char *input_name = block_map->tree->in_names[j];
+      struct shv_node_typed_val *item_val = shv_tree_node_typed_val_new(input_name,
+                                                            shv_tree_dmap(block_map,
+                                                                          &shv_double_dmap),
+                                                            mode);
+      if (item_val == NULL)
         {
-          printf("ERROR: malloc() failed to allocate space for input_name.\n");
+          printf("ERROR: Failed to allocate memory for SHV tree input.\n");
           continue;
         }
 
-      snprintf(input_name, 10, "input%d", j % 1000);
-      struct shv_node_typed_val *item_val = shv_tree_node_typed_val_new(input_name,
-                                                            &shv_double_dmap,
-                                                            mode);
-
       double *y = block_map->block_structure[index].y[j];
       item_val->val_ptr = &y[0];
       item_val->type_name = "double";
@@ -184,26 +320,274 @@ static void shv_add_system_out(python_block_name_map *block_map, int index,
 {
   /* For each block input */
 
+  char parent_path[SHV_PYSIM_PATH_MAXLEN];
+
+  snprintf(parent_path, sizeof(parent_path), "outputs/%s", item_blk->name);
+
   for (int j = 0; j < block_map->block_structure[index].nin; j++)
     {
-      char *output_name = malloc(sizeof(char) * 10);
-      if (output_name == NULL)
+      char output_name[10];
+
+      snprintf(output_name, 10, "output%d", j % 1000);
+
+      double *u = block_map->block_structure[index].u[j];
+      struct shv_node_signal *item_sig = shv_node_signal_new(parent_path, output_name,
+                                                             &u[0], block_map->stream,
+                                                             mode);
+      if (item_sig == NULL)
         {
-          printf("ERROR: malloc() failed to allocate space for output_name.\n");
+          printf("ERROR: Failed to allocate memory for SHV signal node.\n");
           continue;
         }
 
-      snprintf(output_name, 10, "output%d", j % 1000);
-      struct shv_node_typed_val *item_val = shv_tree_node_typed_val_new(output_name,
-                                                            &shv_double_read_only_dmap,
-                                                            mode);
+      shv_tree_add_child(item_blk, &item_sig->shv_node);
+    }
+}
 
-      double *u = block_map->block_structure[index].u[j];
-      item_val->val_ptr = &u[0];
-      item_val->type_name = "double";
+/****************************************************************************
+ * Name: shv_blk_release
+ *
+ * Description:
+ *  Destroys the subtree of a lazy block node, the block node itself stays
+ *  in the tree.
+ *
+ ****************************************************************************/
 
-      shv_tree_add_child(item_blk, &item_val->shv_node);
+static void shv_blk_release(struct shv_node_blk *blk)
+{
+  for (int i = 0; i < 3; i++)
+    {
+      if (blk->children[i] != NULL)
+        {
+          shv_tree_destroy(blk->children[i]);
+          blk->children[i] = NULL;
+        }
+    }
+
+  /* Lazy trees are GAVL only, the list root holds no allocated memory */
+
+  shv_node_list_gavl_init_root_field(&blk->shv_node.children);
+  blk->shv_node.children.mode = blk->block_map->tree->mode;
+  blk->built = 0;
+}
+
+static void shv_blk_lru_unlink(struct shv_pysim_tree *tree,
+                               struct shv_node_blk *blk)
+{
+  if (blk->lru_prev != NULL)
+    {
+      blk->lru_prev->lru_next = blk->lru_next;
+    }
+  else
+    {
+      tree->lru_first = blk->lru_next;
+    }
+
+  if (blk->lru_next != NULL)
+    {
+      blk->lru_next->lru_prev = blk->lru_prev;
+    }
+  else
+    {
+      tree->lru_last = blk->lru_prev;
+    }
+
+  blk->lru_prev = NULL;
+  blk->lru_next = NULL;
+}
+
+static void shv_blk_lru_push(struct shv_pysim_tree *tree,
+                             struct shv_node_blk *blk)
+{
+  blk->lru_prev = NULL;
+  blk->lru_next = tree->lru_first;
+  if (tree->lru_first != NULL)
+    {
+      tree->lru_first->lru_prev = blk;
+    }
+  else
+    {
+      tree->lru_last = blk;
+    }
+
+  tree->lru_first = blk;
+}
+
+/****************************************************************************
+ * Name: shv_blk_evict
+ *
+ * Description:
+ *  Releases the subtree of the least recently used block. Blocks with
+ *  subscribed signals are skipped, the stream refers to their nodes.
+ *  Returns -1 if there is nothing to release.
+ *
+ ****************************************************************************/
+
+static int shv_blk_evict(struct shv_pysim_tree *tree)
+{
+  char prefix[SHV_PYSIM_PATH_MAXLEN];
+  struct shv_node_blk *blk;
+
+  for (blk = tree->lru_last; blk != NULL; blk = blk->lru_prev)
+    {
+      snprintf(prefix, sizeof(prefix), "blocks/%s/", blk->shv_node.name);
+      if (!shv_stream_subscribed(blk->block_map->stream, prefix))
+        {
+          break;
+        }
+    }
+
+  if (blk == NULL)
+    {
+      return -1;
+    }
+
+  shv_blk_lru_unlink(tree, blk);
+  shv_blk_release(blk);
+  tree->built_count--;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: shv_blk_build
+ *
+ * Description:
+ *  Builds the subtree of a lazy block node if it is not built yet and
+ *  marks the block as the most recently used one. Runs in the com thread,
+ *  which is the only one walking the tree.
+ *
+ ****************************************************************************/
+
+static int shv_blk_build(struct shv_node_blk *blk)
+{
+  struct shv_pysim_tree *tree = blk->block_map->tree;
+  int ret;
+
+  if (blk->built)
+    {
+      shv_blk_lru_unlink(tree, blk);
+      shv_blk_lru_push(tree, blk);
+      return 0;
+    }
+
+  while (tree->built_count >= blk->block_map->lazy_blocks)
+    {
+      if (shv_blk_evict(tree) < 0)
+        {
+          break;
+        }
+    }
+
+  ret = shv_add_block(blk->block_map, blk->index, &blk->shv_node,
+                      blk->children, tree->mode);
+  if (ret < 0)
+    {
+      /* Out of memory, release everything unused and try once more */
+
+      shv_blk_release(blk);
+      while (shv_blk_evict(tree) == 0);
+
+      ret = shv_add_block(blk->block_map, blk->index, &blk->shv_node,
+                          blk->children, tree->mode);
+      if (ret < 0)
+        {
+          shv_blk_release(blk);
+          printf("ERROR: Failed to build SHV subtree of block \"%s\".\n",
+                 blk->shv_node.name);
+          return -1;
+        }
     }
+
+  blk->built = 1;
+  shv_blk_lru_push(tree, blk);
+  tree->built_count++;
+  return 0;
+}
+
+static int shv_blk_lazy_dir(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+  shv_blk_build(UL_CONTAINEROF(item, struct shv_node_blk, shv_node));
+  return shv_dmap_item_dir.method(shv_ctx, item, rid);
+}
+
+static int shv_blk_lazy_ls(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+  shv_blk_build(UL_CONTAINEROF(item, struct shv_node_blk, shv_node));
+  return shv_dmap_item_ls.method(shv_ctx, item, rid);
+}
+
+/****************************************************************************
+ * Name: shv_blk_lazy_path
+ *
+ * Description:
+ *  Path hook of the connection. Builds the block named in the path of a
+ *  request below "blocks/<name>/", so the library finds the nodes below
+ *  it when it resolves the path. The block node itself is resolved
+ *  without it, its ls and dir build it.
+ *
+ *  The block a running method works on is the most recently used one,
+ *  at most lazy_blocks - 1 blocks (one at least) are built per read so
+ *  it is not released under the method.
+ *
+ ****************************************************************************/
+
+static const char shv_blk_path_prefix[] = "blocks/";
+
+static void shv_blk_lazy_path(const char *path, int nth, void *arg)
+{
+  python_block_name_map *block_map = (python_block_name_map *)arg;
+  struct shv_pysim_tree *tree = block_map->tree;
+  const char *name = path + sizeof(shv_blk_path_prefix) - 1;
+  size_t len;
+
+  if (strncmp(path, shv_blk_path_prefix, sizeof(shv_blk_path_prefix) - 1) != 0)
+    {
+      return;
+    }
+
+  len = strcspn(name, "/");
+  if (name[len] != '/' || (nth > 0 && nth >= block_map->lazy_blocks - 1))
+    {
+      return;
+    }
+
+  for (int j = 0; j < tree->lazy_nodes_count; j++)
+    {
+      const char *blk_name = tree->lazy_nodes[j]->shv_node.name;
+
+      if (strncmp(blk_name, name, len) == 0 && blk_name[len] == '\0')
+        {
+          shv_blk_build(tree->lazy_nodes[j]);
+          break;
+        }
+    }
+}
+
+static void _shv_node_blk_destructor(struct shv_node *this)
+{
+  struct shv_node_blk *item = UL_CONTAINEROF(this, struct shv_node_blk, shv_node);
+
+  /* Children are destroyed by shv_tree_destroy() */
+
+  free(item);
+}
+
+static struct shv_node_blk *shv_node_blk_new(python_block_name_map *block_map,
+                                             int index, const char *child_name,
+                                             int mode)
+{
+  struct shv_node_blk *item = calloc(1, sizeof(struct shv_node_blk));
+  if (item == NULL)
+    {
+      return NULL;
+    }
+
+  shv_tree_node_init(&item->shv_node, child_name,
+                     shv_tree_dmap(block_map, &shv_blk_lazy_dmap), mode);
+  item->shv_node.vtable.destructor = _shv_node_blk_destructor;
+  item->block_map = block_map;
+  item->index = index;
+  return item;
 }
 
 /****************************************************************************
@@ -223,6 +607,8 @@ static void shv_tree_create(python_block_name_map * block_map,
   struct shv_node *item_out;
   struct shv_node *item_blocks;
   struct shv_node_model_ctx *item_manager;
+  const struct shv_dmap *dir_ls_dmap = shv_tree_dmap(block_map, &shv_dir_ls_dmap);
+  const struct shv_dmap *blk_dmap = shv_tree_dmap(block_map, &shv_blk_dmap);
 
   /* Initialization of tree root */
 
@@ -239,7 +625,7 @@ static void shv_tree_create(python_block_name_map * block_map,
 
   /* Create children for SHV input and output blocks */
 
-  item_in = shv_tree_node_new("inputs", &shv_dir_ls_dmap, mode);
+  item_in = shv_tree_node_new("inputs", dir_ls_dmap, mode);
   if (item_in == NULL)
     {
       printf("ERROR: Failed to allocate memory for SHV tree block \"inputs\"!");
@@ -248,7 +634,7 @@ static void shv_tree_create(python_block_name_map * block_map,
 
   shv_tree_add_child(shv_tree_root, item_in);
 
-  item_out = shv_tree_node_new("outputs", &shv_dir_ls_dmap, mode);
+  item_out = shv_tree_node_new("outputs", dir_ls_dmap, mode);
   if (item_out == NULL)
     {
       printf("ERROR: Failed to allocate memory for SHV tree block \"outputs\"!");
@@ -259,7 +645,7 @@ static void shv_tree_create(python_block_name_map * block_map,
 
   /* Create a child for common blocks */
 
-  item_blocks = shv_tree_node_new("blocks", &shv_dir_ls_dmap, mode);
+  item_blocks = shv_tree_node_new("blocks", dir_ls_dmap, mode);
   if (item_blocks == NULL)
     {
       printf("ERROR: Failed to allocate memory for SHV tree block \"blocks\"!");
@@ -270,7 +656,8 @@ static void shv_tree_create(python_block_name_map * block_map,
 
   /* Create the manager node, to manage the behaviour of the model */
 
-  item_manager = shv_node_model_ctx_new("manager", &shv_manager_dmap, mode);
+  item_manager = shv_node_model_ctx_new("manager",
+                                        shv_tree_dmap(block_map, &shv_manager_dmap), mode);
   if (item_manager == NULL)
     {
       printf("ERROR: Failed to allocate memory for SHV tree block \"blocks\"!");
@@ -278,12 +665,28 @@ static void shv_tree_create(python_block_name_map * block_map,
     }
 
   item_manager->model_ctx = block_map->model_ctx;
+  item_manager->block_map = block_map;
   shv_tree_add_child(shv_tree_root, &item_manager->shv_node);
 
   /* Do not allocate the fwUpdate, fwStable and .device nodes.
    * The generated code will take care of this.
    */
 
+  if (block_map->lazy_blocks > 0)
+    {
+      block_map->tree->lazy_nodes = malloc(n_blocks * sizeof(struct shv_node_blk *));
+      if (block_map->tree->lazy_nodes == NULL)
+        {
+          printf("ERROR: Failed to allocate memory for SHV lazy tree!");
+          return;
+        }
+
+      shv_blk_lazy_item_dir = shv_dmap_item_dir;
+      shv_blk_lazy_item_dir.method = shv_blk_lazy_dir;
+      shv_blk_lazy_item_ls = shv_dmap_item_ls;
+      shv_blk_lazy_item_ls.method = shv_blk_lazy_ls;
+    }
+
   /* For each block */
 
   for (int i = 0; i < n_blocks; i++)
@@ -295,7 +698,25 @@ static void shv_tree_create(python_block_name_map * block_map,
 
       if ((block_map->blocks[i].system_outputs == 0) && (block_map->blocks[i].system_inputs == 0))
         {
-          struct shv_node *item_blk = shv_tree_node_new(blk_name, &shv_blk_dmap, mode);
+          if (block_map->lazy_blocks > 0)
+            {
+              /* Only the block node now, the rest on the first access */
+
+              struct shv_node_blk *item_lazy = shv_node_blk_new(block_map, index,
+                                                                blk_name, mode);
+              if (item_lazy == NULL)
+                {
+                  printf("ERROR: Failed to allocate memory for SHV tree block \"%s\"!", blk_name);
+                  continue;
+                }
+
+              shv_tree_add_child(item_blocks, &item_lazy->shv_node);
+              block_map->tree->lazy_nodes[block_map->tree->lazy_nodes_count++] = item_lazy;
+              continue;
+            }
+
+          struct shv_node *children[3];
+          struct shv_node *item_blk = shv_tree_node_new(blk_name, blk_dmap, mode);
           if (item_blk == NULL)
             {
               printf("ERROR: Failed to allocate memory for SHV tree block \"%s\"!", blk_name);
@@ -304,7 +725,7 @@ static void shv_tree_create(python_block_name_map * block_map,
 
           shv_tree_add_child(item_blocks, item_blk);
 
-          shv_add_block(block_map, index, item_blk, mode);
+          shv_add_block(block_map, index, item_blk, children, mode);
         }
 
       /* If block has editable outputs
@@ -313,7 +734,7 @@ static void shv_tree_create(python_block_name_map * block_map,
 
       if (block_map->blocks[i].system_inputs == 1)
         {
-          struct shv_node *item_blk = shv_tree_node_new(blk_name, &shv_blk_dmap, mode);
+          struct shv_node *item_blk = shv_tree_node_new(blk_name, blk_dmap, mode);
           if (item_blk == NULL)
             {
               printf("ERROR: Failed to allocate memory for SHV tree block \"%s\"!", blk_name);
@@ -329,7 +750,7 @@ static void shv_tree_create(python_block_name_map * block_map,
 
       if (block_map->blocks[i].system_outputs == 1)
         {
-          struct shv_node *item_blk = shv_tree_node_new(blk_name, &shv_blk_dmap, mode);
+          struct shv_node *item_blk = shv_tree_node_new(blk_name, blk_dmap, mode);
           if (item_blk == NULL)
             {
               printf("ERROR: Failed to allocate memory for SHV tree block \"%s\"!", blk_name);
@@ -394,16 +815,49 @@ struct shv_con_ctx *shv_tree_init(python_block_name_map * block_map,
     }
   comprio = block_map->model_ctx->pt_ops.comprio(block_map->model_ctx->pt_arg);
 
+  if (block_map->parsets != NULL)
+    {
+      shv_parset_init(block_map);
+    }
+
   if ((mode & SHV_NLIST_MODE_STATIC) == 0)
     {
+      /* Signal nodes of the dynamic tree can be streamed. The stream
+       * is created first, the nodes are locked against its publisher.
+       */
+
+      block_map->stream = shv_stream_new();
+      if (block_map->stream == NULL)
+        {
+          printf("ERROR: Failed to allocate memory for SHV stream.\n");
+        }
+
       /* Create tree only if it should be allocated dynamically */
 
-      root = shv_tree_node_new(NULL, &shv_root_dmap, mode);
+      root = shv_tree_node_new(NULL, shv_tree_dmap(block_map, &shv_root_dmap), mode);
       if (root == NULL)
         {
           printf("ERROR: malloc() failed\n");
           return NULL;
         }
+
+      block_map->tree = calloc(1, sizeof(struct shv_pysim_tree));
+      if (block_map->tree == NULL ||
+          shv_tree_names_init(block_map->tree, block_map) < 0)
+        {
+          printf("ERROR: malloc() failed\n");
+          return NULL;
+        }
+
+      /* Lazy tree builds on GAVL lists only */
+
+      if (mode & SHV_NLIST_MODE_GSA)
+        {
+          block_map->lazy_blocks = 0;
+        }
+
+      block_map->tree->mode = mode;
+
       shv_tree_create(block_map, (struct shv_node *)root, mode);
     }
   else
@@ -415,14 +869,17 @@ struct shv_con_ctx *shv_tree_init(python_block_name_map * block_map,
 
   if (fwupdate_root != NULL)
     {
+      fwupdate_root->shv_node.dir = shv_tree_dmap(block_map, fwupdate_root->shv_node.dir);
       shv_tree_add_child((struct shv_node*) root, &fwupdate_root->shv_node);
     }
   if (dotdevice_node != NULL)
     {
+      dotdevice_node->shv_node.dir = shv_tree_dmap(block_map, dotdevice_node->shv_node.dir);
       shv_tree_add_child((struct shv_node*) root, &dotdevice_node->shv_node);
     }
   if (fwstable_node != NULL)
     {
+      fwstable_node->shv_node.dir = shv_tree_dmap(block_map, fwstable_node->shv_node.dir);
       shv_tree_add_child((struct shv_node*) root, &fwstable_node->shv_node);
     }
 
@@ -434,12 +891,34 @@ struct shv_con_ctx *shv_tree_init(python_block_name_map * block_map,
       printf("ERROR: shv_init() failed.\n");
     }
 
+  /* The publisher shares the connection with the com thread, the lazy
+   * tree builds the blocks named in the requests read from it.
+   */
+
+  if (ctx != NULL && block_map->tree != NULL && block_map->tree->lazy_nodes != NULL)
+    {
+      shv_stream_set_path_hook(shv_blk_lazy_path, block_map);
+    }
+
+  if (ctx != NULL && (block_map->stream != NULL || block_map->lazy_blocks > 0))
+    {
+      shv_stream_attach(ctx);
+    }
+
   ret = shv_create_process_thread(comprio, ctx);
   if (ret < 0)
     {
       printf("ERROR: %s\n", shv_errno_str(ctx));
     }
 
+  if (ctx != NULL && block_map->stream != NULL)
+    {
+      if (shv_stream_start(block_map->stream, ctx, comprio) < 0)
+        {
+          printf("ERROR: Failed to start SHV stream publisher.\n");
+        }
+    }
+
   return ctx;
 }
 
@@ -448,14 +927,24 @@ struct shv_con_ctx *shv_tree_init(python_block_name_map * block_map,
  *
  * Description:
  *  End function for SHV tree. This should be called before blocks's end
- *  functions are called. This destroys the SHV tree, free memory and
- *  terminates TCP communication.
+ *  functions are called. This stops the signal publisher, destroys the SHV
+ *  tree, free memory and terminates TCP communication.
  *
  ****************************************************************************/
 
-void shv_tree_end(struct shv_con_ctx *ctx, int mode)
+void shv_tree_end(python_block_name_map *block_map, struct shv_con_ctx *ctx, int mode)
 {
   struct shv_node *root;
+
+  /* Stop publishing first, the publisher uses the connection */
+
+  if (block_map->stream != NULL)
+    {
+      struct shv_stream *stream = block_map->stream;
+      block_map->stream = NULL;
+      shv_stream_stop(stream);
+    }
+
   if (ctx == NULL)
     {
       return;
@@ -471,4 +960,14 @@ void shv_tree_end(struct shv_con_ctx *ctx, int mode)
     {
       shv_tree_destroy(root);
     }
+
+  /* Names were used by the nodes, free them last */
+
+  if (block_map->tree != NULL)
+    {
+      free(block_map->tree->in_names);
+      free(block_map->tree->lazy_nodes);
+      free(block_map->tree);
+      block_map->tree = NULL;
+    }
 }
@@ -0,0 +1,1139 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sched.h>
+
+#include <shv/chainpack/cchainpack.h>
+#include <shv/tree/shv_tree.h>
+#include <shv/tree/shv_com.h>
+#include <shv/tree/shv_methods.h>
+#include <ulut/ul_utdefs.h>
+
+#include <shv_stream.h>
+#include <threadclass.h>
+
+#define SHV_STREAM_MSG_MAXLEN 256
+#define SHV_STREAM_HEAD_LEN   256       /* Start of a message with its path */
+#define SHV_STREAM_DMAPS        16      /* Distinct dmaps of the tree */
+#define SHV_STREAM_DMAP_METHODS 16      /* Methods of one dmap */
+
+/* Connection lock.
+ *
+ * shv-libs4c packs the messages in the pack context of the connection,
+ * each one in two passes (length, then data), so nothing else may write
+ * from the start of a message to its end. The com thread takes the lock
+ * around each method it runs (locked dmaps) and, for the messages it
+ * sends on its own (login, keepalive), at their first flush until it
+ * reads the next message. The publisher writes under the lock only.
+ * There is one connection per process.
+ */
+
+#define COM_UNLOCKED  0
+#define COM_METHOD    1     /* Com thread runs a method */
+#define COM_MESSAGE   2     /* Com thread sends a message on its own */
+
+static pthread_mutex_t com_lock;
+static pthread_once_t com_lock_once = PTHREAD_ONCE_INIT;
+static int com_locked;              /* Com thread only */
+static int com_publishing;          /* Publisher only, under com_lock */
+static int com_disabled;            /* A dmap is not locked, under com_lock */
+static ccpcp_pack_overflow_handler com_overflow;
+static ccpcp_unpack_underflow_handler com_underflow;
+static shv_stream_path_hook com_path_hook;
+static void *com_path_arg;
+
+static void com_lock_init(void)
+{
+  pthread_mutexattr_t attr;
+
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&com_lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+/* Pack overflow of the connection, called for each flush of the com
+ * thread and of the publisher. The publisher already holds the lock. */
+
+static size_t shv_stream_overflow(ccpcp_pack_context *ctx, size_t size_hint)
+{
+  pthread_mutex_lock(&com_lock);
+
+  /* Read under the lock, so only the publisher can see it set */
+
+  if (com_publishing || com_locked != COM_UNLOCKED)
+    {
+      pthread_mutex_unlock(&com_lock);
+    }
+  else
+    {
+      com_locked = COM_MESSAGE;
+    }
+
+  return com_overflow(ctx, size_hint);
+}
+
+/****************************************************************************
+ * Request paths
+ *
+ *  The messages read by the com thread are framed by their length, the
+ *  start of each one is kept up to SHV_STREAM_HEAD_LEN bytes and its
+ *  meta data are unpacked to get the path of the request. The path hook
+ *  gets it before the library resolves the path. Com thread only.
+ *
+ ****************************************************************************/
+
+#define CP_TINY_INT  64
+#define CP_UINT      129
+#define CP_INT       130
+#define CP_DOUBLE    131
+#define CP_BLOB      133
+#define CP_STRING    134
+#define CP_LIST      136
+#define CP_MAP       137
+#define CP_IMAP      138
+#define CP_META_MAP  139
+#define CP_DECIMAL   140
+#define CP_DATE_TIME 141
+#define CP_CSTRING   142
+#define CP_NULL      128
+#define CP_FALSE     253
+#define CP_TRUE      254
+#define CP_TERM      255
+
+#define CP_META_SHV_PATH 9
+#define CP_DEPTH_MAX     8
+
+static struct {
+  unsigned char len[9];               /* Length of the message read so far */
+  int len_cnt;
+  size_t remain;                      /* Bytes of the message to be read */
+  int parsed;                         /* Path of the message passed */
+  size_t head_len;
+  unsigned char head[SHV_STREAM_HEAD_LEN];
+  int paths;                          /* Paths passed in this read */
+} com_msg;
+
+/* Bytes of ChainPack unsigned data starting with b, 0 if not supported */
+
+static int cp_uint_size(unsigned char b)
+{
+  if ((b & 0x80) == 0)
+    {
+      return 1;
+    }
+  if ((b & 0x40) == 0)
+    {
+      return 2;
+    }
+  if ((b & 0x20) == 0)
+    {
+      return 3;
+    }
+  if ((b & 0x10) == 0)
+    {
+      return 4;
+    }
+  return (b & 0x0f) <= 3 ? (b & 0x0f) + 5 : 0;
+}
+
+/* Unpacks unsigned data, returns the position after it or NULL */
+
+static const unsigned char *cp_uint(const unsigned char *p, const unsigned char *end,
+                                    uint64_t *val)
+{
+  int n;
+
+  if (p >= end || (n = cp_uint_size(*p)) == 0 || end - p < n)
+    {
+      return NULL;
+    }
+
+  *val = n < 5 ? *p & (0xff >> n) : 0;
+  for (int i = 1; i < n; i++)
+    {
+      *val = (*val << 8) | p[i];
+    }
+
+  return p + n;
+}
+
+/* Skips one value, returns the position after it or NULL */
+
+static const unsigned char *cp_skip(const unsigned char *p, const unsigned char *end,
+                                    int depth)
+{
+  uint64_t len;
+
+  if (p >= end || depth > CP_DEPTH_MAX)
+    {
+      return NULL;
+    }
+
+  if (*p < CP_NULL)
+    {
+      return p + 1;                   /* Tiny integer */
+    }
+
+  switch (*p++)
+    {
+      case CP_NULL:
+      case CP_FALSE:
+      case CP_TRUE:
+        return p;
+
+      case CP_UINT:
+      case CP_INT:
+      case CP_DATE_TIME:
+        return cp_uint(p, end, &len);
+
+      case CP_DECIMAL:
+        p = cp_uint(p, end, &len);
+        return p != NULL ? cp_uint(p, end, &len) : NULL;
+
+      case CP_DOUBLE:
+        return end - p >= 8 ? p + 8 : NULL;
+
+      case CP_BLOB:
+      case CP_STRING:
+        p = cp_uint(p, end, &len);
+        return p != NULL && (uint64_t)(end - p) >= len ? p + len : NULL;
+
+      case CP_CSTRING:
+        for (; p < end && *p != 0; p++)
+          {
+            if (*p == '\\')
+              {
+                p++;
+              }
+          }
+        return p < end ? p + 1 : NULL;
+
+      case CP_LIST:
+      case CP_MAP:
+      case CP_IMAP:
+      case CP_META_MAP:
+        while (p != NULL && p < end && *p != CP_TERM)
+          {
+            p = cp_skip(p, end, depth + 1);
+          }
+        return p != NULL && p < end ? p + 1 : NULL;
+
+      default:
+        return NULL;
+    }
+}
+
+/* Unpacks the path from the meta data at the start of a message, returns
+ * 0 if the message has a path.
+ */
+
+static int cp_request_path(const unsigned char *p, const unsigned char *end,
+                           char *path, size_t size)
+{
+  uint64_t val;
+  size_t n = 0;
+
+  p = cp_uint(p, end, &val);              /* Protocol */
+  if (p == NULL || val != 1 || p >= end || *p++ != CP_META_MAP)
+    {
+      return -1;
+    }
+
+  while (p != NULL && p < end && *p != CP_TERM)
+    {
+      /* Keys are packed as integers */
+
+      if (*p != CP_META_SHV_PATH && *p != CP_TINY_INT + CP_META_SHV_PATH)
+        {
+          p = cp_skip(p, end, 0);         /* Key */
+          p = cp_skip(p, end, 0);         /* Value */
+          continue;
+        }
+
+      p++;
+      if (p < end && *p == CP_STRING)
+        {
+          p = cp_uint(p + 1, end, &val);
+          if (p == NULL || val >= size || (uint64_t)(end - p) < val)
+            {
+              return -1;
+            }
+          memcpy(path, p, val);
+          path[val] = '\0';
+          return 0;
+        }
+
+      if (p < end && *p == CP_CSTRING)
+        {
+          for (p++; p < end && *p != 0; p++)
+            {
+              char c = *p;
+
+              if (c == '\\')
+                {
+                  if (++p == end)
+                    {
+                      break;
+                    }
+                  c = *p == '0' ? '\0' : *p;
+                }
+              if (n == size - 1)
+                {
+                  return -1;
+                }
+              path[n++] = c;
+            }
+          if (p == end)
+            {
+              return -1;
+            }
+          path[n] = '\0';
+          return 0;
+        }
+
+      return -1;
+    }
+
+  return -1;
+}
+
+static void shv_stream_read(const unsigned char *data, size_t len)
+{
+  char path[SHV_STREAM_HEAD_LEN];
+  uint64_t val;
+  size_t n;
+
+  com_msg.paths = 0;
+  while (len > 0)
+    {
+      if (com_msg.remain == 0)
+        {
+          /* Length of the next message */
+
+          com_msg.len[com_msg.len_cnt++] = *data++;
+          len--;
+          if (cp_uint_size(com_msg.len[0]) == 0)
+            {
+              com_msg.len_cnt = 0;        /* Lost the framing */
+              continue;
+            }
+          if (com_msg.len_cnt < cp_uint_size(com_msg.len[0]))
+            {
+              continue;
+            }
+
+          cp_uint(com_msg.len, com_msg.len + com_msg.len_cnt, &val);
+          com_msg.len_cnt = 0;
+          com_msg.remain = val;
+          com_msg.head_len = 0;
+          com_msg.parsed = 0;
+          continue;
+        }
+
+      n = len < com_msg.remain ? len : com_msg.remain;
+      if (!com_msg.parsed)
+        {
+          size_t copy = sizeof(com_msg.head) - com_msg.head_len;
+
+          copy = n < copy ? n : copy;
+          memcpy(com_msg.head + com_msg.head_len, data, copy);
+          com_msg.head_len += copy;
+        }
+      data += n;
+      len -= n;
+      com_msg.remain -= n;
+
+      if (!com_msg.parsed &&
+          (com_msg.remain == 0 || com_msg.head_len == sizeof(com_msg.head)))
+        {
+          com_msg.parsed = 1;
+          if (cp_request_path(com_msg.head, com_msg.head + com_msg.head_len,
+                              path, sizeof(path)) == 0)
+            {
+              com_path_hook(path, com_msg.paths++, com_path_arg);
+            }
+        }
+    }
+}
+
+/* Unpack underflow of the connection, the com thread waits for the next
+ * message, so the one it has sent on its own is complete. The path hook
+ * gets the paths of the requests read before the library unpacks them. */
+
+static size_t shv_stream_underflow(ccpcp_unpack_context *ctx)
+{
+  size_t ret;
+
+  if (com_locked == COM_MESSAGE)
+    {
+      com_locked = COM_UNLOCKED;
+      pthread_mutex_unlock(&com_lock);
+    }
+
+  ret = com_underflow(ctx);
+  if (com_path_hook != NULL && ctx->end > ctx->current)
+    {
+      shv_stream_read((const unsigned char *)ctx->current, ctx->end - ctx->current);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: shv_stream_attach
+ *
+ * Description:
+ *  Hooks the connection lock into the connection. Called before the com
+ *  thread is started.
+ *
+ ****************************************************************************/
+
+void shv_stream_attach(struct shv_con_ctx *shv_ctx)
+{
+  pthread_once(&com_lock_once, com_lock_init);
+
+  if (shv_ctx->pack_ctx.handle_pack_overflow != shv_stream_overflow)
+    {
+      com_overflow = shv_ctx->pack_ctx.handle_pack_overflow;
+      shv_ctx->pack_ctx.handle_pack_overflow = shv_stream_overflow;
+    }
+  if (shv_ctx->unpack_ctx.handle_unpack_underflow != shv_stream_underflow)
+    {
+      com_underflow = shv_ctx->unpack_ctx.handle_unpack_underflow;
+      shv_ctx->unpack_ctx.handle_unpack_underflow = shv_stream_underflow;
+      memset(&com_msg, 0, sizeof(com_msg));
+    }
+}
+
+/****************************************************************************
+ * Name: shv_stream_set_path_hook
+ *
+ * Description:
+ *  Sets the function called by the com thread with the path of each
+ *  message read from the connection. Called before shv_stream_attach.
+ *
+ ****************************************************************************/
+
+void shv_stream_set_path_hook(shv_stream_path_hook hook, void *arg)
+{
+  com_path_hook = hook;
+  com_path_arg = arg;
+}
+
+static int shv_stream_attached(struct shv_con_ctx *shv_ctx)
+{
+  return shv_ctx->pack_ctx.handle_pack_overflow == shv_stream_overflow &&
+         shv_ctx->unpack_ctx.handle_unpack_underflow == shv_stream_underflow;
+}
+
+/****************************************************************************
+ * Locked dmaps
+ *
+ *  A copy of a dmap with the same method descriptions, each method runs
+ *  the original one with the connection lock held. The method is found
+ *  by its index, the copies keep the order of the original.
+ *
+ ****************************************************************************/
+
+struct shv_stream_dmap {
+  struct shv_dmap dmap;
+  const struct shv_dmap *orig;
+  struct shv_method_des items[SHV_STREAM_DMAP_METHODS];
+  const struct shv_method_des *item_ptrs[SHV_STREAM_DMAP_METHODS];
+};
+
+static struct shv_stream_dmap stream_dmaps[SHV_STREAM_DMAPS];
+static int stream_dmaps_count;
+
+static int shv_stream_locked_call(struct shv_con_ctx *shv_ctx, struct shv_node *item,
+                                  int rid, int index)
+{
+  struct shv_stream_dmap *locked = UL_CONTAINEROF(item->dir, struct shv_stream_dmap, dmap);
+  const struct shv_method_des *method = locked->orig->methods.items[index];
+  int own = 0;
+  int ret;
+
+  pthread_mutex_lock(&com_lock);
+  if (com_locked == COM_UNLOCKED)
+    {
+      com_locked = COM_METHOD;
+      own = 1;
+    }
+  else
+    {
+      pthread_mutex_unlock(&com_lock);
+    }
+
+  ret = method->method(shv_ctx, item, rid);
+
+  if (own)
+    {
+      com_locked = COM_UNLOCKED;
+      pthread_mutex_unlock(&com_lock);
+    }
+
+  return ret;
+}
+
+#define SHV_STREAM_LOCKED(i) \
+  static int shv_stream_locked_##i(struct shv_con_ctx *shv_ctx, struct shv_node *item, \
+                                   int rid) \
+  { \
+    return shv_stream_locked_call(shv_ctx, item, rid, i); \
+  }
+
+SHV_STREAM_LOCKED(0)  SHV_STREAM_LOCKED(1)  SHV_STREAM_LOCKED(2)  SHV_STREAM_LOCKED(3)
+SHV_STREAM_LOCKED(4)  SHV_STREAM_LOCKED(5)  SHV_STREAM_LOCKED(6)  SHV_STREAM_LOCKED(7)
+SHV_STREAM_LOCKED(8)  SHV_STREAM_LOCKED(9)  SHV_STREAM_LOCKED(10) SHV_STREAM_LOCKED(11)
+SHV_STREAM_LOCKED(12) SHV_STREAM_LOCKED(13) SHV_STREAM_LOCKED(14) SHV_STREAM_LOCKED(15)
+
+static int (*const shv_stream_locked[SHV_STREAM_DMAP_METHODS])(struct shv_con_ctx *,
+                                                               struct shv_node *, int) =
+{
+  shv_stream_locked_0,  shv_stream_locked_1,  shv_stream_locked_2,  shv_stream_locked_3,
+  shv_stream_locked_4,  shv_stream_locked_5,  shv_stream_locked_6,  shv_stream_locked_7,
+  shv_stream_locked_8,  shv_stream_locked_9,  shv_stream_locked_10, shv_stream_locked_11,
+  shv_stream_locked_12, shv_stream_locked_13, shv_stream_locked_14, shv_stream_locked_15,
+};
+
+/****************************************************************************
+ * Name: shv_stream_dmap
+ *
+ * Description:
+ *  Returns the locked copy of a dmap, to be used by all nodes of a tree
+ *  with streaming. Called before the com thread is started or from it.
+ *  If there is no room for the copy, the dmap itself is returned and
+ *  the tree runs without streaming from then on.
+ *
+ ****************************************************************************/
+
+const struct shv_dmap *shv_stream_dmap(const struct shv_dmap *dmap)
+{
+  struct shv_stream_dmap *locked;
+  int i;
+
+  pthread_once(&com_lock_once, com_lock_init);
+
+  for (i = 0; i < stream_dmaps_count; i++)
+    {
+      if (stream_dmaps[i].orig == dmap || &stream_dmaps[i].dmap == dmap)
+        {
+          return &stream_dmaps[i].dmap;
+        }
+    }
+
+  if (stream_dmaps_count == SHV_STREAM_DMAPS ||
+      dmap->methods.count > SHV_STREAM_DMAP_METHODS)
+    {
+      /* Its methods would write without the lock, nothing is published
+       * any more
+       */
+
+      pthread_mutex_lock(&com_lock);
+      if (!com_disabled)
+        {
+          printf("ERROR: SHV stream cannot lock dmap, increase SHV_STREAM_DMAPS/METHODS. "
+                 "Streaming disabled.\n");
+          com_disabled = 1;
+        }
+      pthread_mutex_unlock(&com_lock);
+      return dmap;
+    }
+
+  locked = &stream_dmaps[stream_dmaps_count];
+  locked->orig = dmap;
+  locked->dmap = *dmap;
+  for (i = 0; i < dmap->methods.count; i++)
+    {
+      locked->items[i] = *(const struct shv_method_des *)dmap->methods.items[i];
+      locked->items[i].method = shv_stream_locked[i];
+      locked->item_ptrs[i] = &locked->items[i];
+    }
+  locked->dmap.methods.items = (void **)locked->item_ptrs;
+  locked->dmap.methods.alloc_count = 0;
+  stream_dmaps_count++;
+
+  return &locked->dmap;
+}
+
+/****************************************************************************
+ * Name: shv_stream_pack_chng
+ *
+ * Description:
+ *  Appends chng signal with the new value of the node at path to
+ *  the batch. Returns -1 if the batch is full.
+ *
+ ****************************************************************************/
+
+static int shv_stream_pack_chng(ccpcp_pack_context *batch, const char *path,
+                                double val)
+{
+  char buf[SHV_STREAM_MSG_MAXLEN];
+  ccpcp_pack_context pack;
+  size_t len;
+
+  ccpcp_pack_context_init(&pack, buf, sizeof(buf), NULL);
+
+  cchainpack_pack_uint_data(&pack, 1);   /* ChainPack protocol */
+  cchainpack_pack_meta_begin(&pack);
+  cchainpack_pack_int(&pack, 1);         /* MetaTypeId */
+  cchainpack_pack_int(&pack, 1);         /* RpcMessage */
+  cchainpack_pack_int(&pack, 9);         /* ShvPath */
+  cchainpack_pack_cstring_terminated(&pack, path);
+  cchainpack_pack_int(&pack, 10);        /* Method */
+  cchainpack_pack_cstring_terminated(&pack, "chng");
+  cchainpack_pack_container_end(&pack);
+  cchainpack_pack_imap_begin(&pack);
+  cchainpack_pack_int(&pack, 1);         /* Params */
+  cchainpack_pack_double(&pack, val);
+  cchainpack_pack_container_end(&pack);
+
+  if (pack.err_no != CCPCP_RC_OK)
+    {
+      return 0;                          /* Path too long, skip */
+    }
+
+  len = pack.current - pack.start;
+
+  /* Length is at most 10 bytes */
+
+  if ((size_t)(batch->end - batch->current) < len + 10)
+    {
+      return -1;
+    }
+
+  cchainpack_pack_uint_data(batch, len);
+  ccpcp_pack_copy_bytes(batch, buf, len);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: shv_stream_flush
+ *
+ * Description:
+ *  Writes the batch to the connection. The com thread may be packing
+ *  a message of its own up to its first flush, the publisher waits for
+ *  it a few periods of the com thread. The batch is dropped if it does
+ *  not finish or if the connection was set up again without the lock,
+ *  it is hooked again by the next subscribe.
+ *
+ ****************************************************************************/
+
+static void shv_stream_flush(struct shv_stream *stream, ccpcp_pack_context *batch)
+{
+  struct shv_con_ctx *shv_ctx = stream->shv_ctx;
+  size_t len = batch->current - batch->start;
+  int tries = 10;
+
+  if (len == 0)
+    {
+      return;
+    }
+
+  pthread_mutex_lock(&com_lock);
+  while (shv_ctx->pack_ctx.current != shv_ctx->pack_ctx.start && --tries > 0)
+    {
+      pthread_mutex_unlock(&com_lock);
+      usleep(1000);
+      pthread_mutex_lock(&com_lock);
+    }
+
+  if (tries > 0 && !com_disabled && shv_stream_attached(shv_ctx))
+    {
+      com_publishing = 1;
+      ccpcp_pack_copy_bytes(&shv_ctx->pack_ctx, batch->start, len);
+      com_overflow(&shv_ctx->pack_ctx, 0);
+      com_publishing = 0;
+    }
+  pthread_mutex_unlock(&com_lock);
+
+  batch->current = batch->start;
+}
+
+/****************************************************************************
+ * Name: shv_stream_publish
+ *
+ * Description:
+ *  Drains all frames from the ring and publishes values passing
+ *  the decimation, deadband and rate limit of their subscription.
+ *  All chng signals of the run are written at once.
+ *
+ ****************************************************************************/
+
+static void shv_stream_publish(struct shv_stream *stream)
+{
+  unsigned int locin = atomic_load_explicit(&stream->locin, memory_order_acquire);
+  int hwm = atomic_load_explicit(&stream->subs_hwm, memory_order_acquire);
+  ccpcp_pack_context batch;
+
+  ccpcp_pack_context_init(&batch, stream->batch, sizeof(stream->batch), NULL);
+
+  while (stream->locout != locin)
+    {
+      double *frame = stream->frames[stream->locout % CONF_SHV_STREAM_DEPTH];
+      double t = frame[0];
+
+      for (int i = 0; i < hwm; i++)
+        {
+          struct shv_stream_sub *sub = &stream->subs[i];
+          double val = frame[i + 1];
+
+          if (atomic_load_explicit(&sub->signal, memory_order_acquire) == NULL)
+            {
+              continue;
+            }
+
+          if (++sub->dec_cnt < sub->decimation)
+            {
+              continue;
+            }
+          sub->dec_cnt = 0;
+
+          if (sub->published)
+            {
+              if (fabs(val - sub->last_val) <= sub->deadband)
+                {
+                  continue;
+                }
+              if (t - sub->last_t < sub->min_period)
+                {
+                  continue;
+                }
+            }
+
+          if (shv_stream_pack_chng(&batch, sub->path, val) < 0)
+            {
+              shv_stream_flush(stream, &batch);
+              shv_stream_pack_chng(&batch, sub->path, val);
+            }
+
+          sub->published = 1;
+          sub->last_val = val;
+          sub->last_t = t;
+        }
+
+      atomic_store_explicit(&stream->locout, stream->locout + 1,
+                            memory_order_release);
+    }
+
+  shv_stream_flush(stream, &batch);
+}
+
+static void *shv_stream_thread(void *arg)
+{
+  struct shv_stream *stream = (struct shv_stream *)arg;
+
+  set_thread_class("com");
+  while (!stream->terminate)
+    {
+      usleep(CONF_SHV_STREAM_PERIOD_MS * 1000);
+      shv_stream_publish(stream);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: shv_stream_sample
+ *
+ * Description:
+ *  Snapshots all subscribed signals into the ring. Called by the RT thread
+ *  once per sample, does nothing if there is no subscription.
+ *
+ ****************************************************************************/
+
+void shv_stream_sample(struct shv_stream *stream, double t)
+{
+  unsigned int locin;
+  unsigned int locout;
+  int hwm;
+  double *frame;
+
+  if (stream == NULL)
+    {
+      return;
+    }
+
+  hwm = atomic_load_explicit(&stream->subs_hwm, memory_order_acquire);
+  if (hwm == 0)
+    {
+      return;
+    }
+
+  locin = stream->locin;
+  locout = atomic_load_explicit(&stream->locout, memory_order_acquire);
+  if (locin - locout >= CONF_SHV_STREAM_DEPTH)
+    {
+      stream->lostcount++;
+      return;
+    }
+
+  frame = stream->frames[locin % CONF_SHV_STREAM_DEPTH];
+  frame[0] = t;
+  for (int i = 0; i < hwm; i++)
+    {
+      const double *signal = atomic_load_explicit(&stream->subs[i].signal,
+                                                  memory_order_acquire);
+      if (signal != NULL)
+        {
+          frame[i + 1] = *signal;
+        }
+    }
+
+  atomic_store_explicit(&stream->locin, locin + 1, memory_order_release);
+}
+
+struct shv_stream *shv_stream_new(void)
+{
+  return calloc(1, sizeof(struct shv_stream));
+}
+
+int shv_stream_start(struct shv_stream *stream, struct shv_con_ctx *shv_ctx,
+                     int prio)
+{
+  pthread_attr_t attr;
+  struct sched_param schparam;
+  int ret;
+
+  if (com_disabled)
+    {
+      return -1;
+    }
+
+  stream->shv_ctx = shv_ctx;
+  stream->terminate = 0;
+
+  pthread_attr_init(&attr);
+  if (prio > 0)
+    {
+      /* Publish with the priority of the com thread */
+
+      pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+      pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+      schparam.sched_priority = prio;
+      pthread_attr_setschedparam(&attr, &schparam);
+    }
+
+  ret = pthread_create(&stream->thrd, &attr, shv_stream_thread, stream);
+  pthread_attr_destroy(&attr);
+  if (ret != 0)
+    {
+      return -1;
+    }
+
+  stream->started = 1;
+  return 0;
+}
+
+void shv_stream_stop(struct shv_stream *stream)
+{
+  if (stream == NULL)
+    {
+      return;
+    }
+
+  if (stream->started)
+    {
+      stream->terminate = 1;
+      pthread_join(stream->thrd, NULL);
+    }
+
+  if (stream->lostcount)
+    {
+      printf("SHV stream: %u frames lost\n", stream->lostcount);
+    }
+
+  free(stream);
+}
+
+/****************************************************************************
+ * Name: shv_stream_subscribed
+ *
+ * Description:
+ *  Returns 1 if any signal under the given path prefix is subscribed.
+ *  Subscriptions are changed by the com thread only, so the call is
+ *  safe from the com thread without further locking.
+ *
+ ****************************************************************************/
+
+int shv_stream_subscribed(const struct shv_stream *stream, const char *prefix)
+{
+  size_t len = strlen(prefix);
+
+  if (stream == NULL)
+    {
+      return 0;
+    }
+
+  for (int slot = 0; slot < stream->subs_hwm; slot++)
+    {
+      const struct shv_stream_sub *sub = &stream->subs[slot];
+
+      if (sub->signal != NULL && strncmp(sub->path, prefix, len) == 0)
+        {
+          return 1;
+        }
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Signal node methods
+ ****************************************************************************/
+
+static int shv_signal_get(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+  shv_unpack_data(&shv_ctx->unpack_ctx, 0, 0);
+  struct shv_node_signal *sig = UL_CONTAINEROF(item, struct shv_node_signal, shv_node);
+  shv_send_double(shv_ctx, rid, *sig->val_ptr);
+  return 0;
+}
+
+static int shv_signal_subscribe(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+  int decimation = 1;
+  struct shv_node_signal *sig = UL_CONTAINEROF(item, struct shv_node_signal, shv_node);
+  struct shv_stream *stream = sig->stream;
+  struct shv_stream_sub *sub;
+  int slot;
+
+  shv_unpack_data(&shv_ctx->unpack_ctx, &decimation, 0);
+
+  /* The connection is set up again on reconnect, hook the lock again */
+
+  shv_stream_attach(shv_ctx);
+
+  if (com_disabled)
+    {
+      shv_send_error(shv_ctx, rid, SHV_RE_METHOD_CALL_EXCEPTION,
+                     "Streaming disabled!");
+      return -1;
+    }
+
+  if (decimation < 1)
+    {
+      decimation = 1;
+    }
+
+  if (sig->slot >= 0)
+    {
+      stream->subs[sig->slot].decimation = decimation;
+      shv_send_empty_response(shv_ctx, rid);
+      return 0;
+    }
+
+  for (slot = 0; slot < CONF_SHV_STREAM_SLOTS; slot++)
+    {
+      if (stream->subs[slot].signal == NULL)
+        {
+          break;
+        }
+    }
+
+  if (slot == CONF_SHV_STREAM_SLOTS)
+    {
+      shv_send_error(shv_ctx, rid, SHV_RE_METHOD_CALL_EXCEPTION,
+                     "No free stream slot!");
+      return -1;
+    }
+
+  sub = &stream->subs[slot];
+  sub->path = sig->path;
+  sub->decimation = decimation;
+  sub->deadband = 0.0;
+  sub->min_period = 0.0;
+  sub->dec_cnt = decimation;
+  sub->published = 0;
+  atomic_store_explicit(&sub->signal, sig->val_ptr, memory_order_release);
+
+  if (slot >= stream->subs_hwm)
+    {
+      atomic_store_explicit(&stream->subs_hwm, slot + 1, memory_order_release);
+    }
+
+  sig->slot = slot;
+  shv_send_empty_response(shv_ctx, rid);
+  return 0;
+}
+
+static int shv_signal_unsubscribe(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+  shv_unpack_data(&shv_ctx->unpack_ctx, 0, 0);
+  struct shv_node_signal *sig = UL_CONTAINEROF(item, struct shv_node_signal, shv_node);
+
+  if (sig->slot >= 0)
+    {
+      atomic_store_explicit(&sig->stream->subs[sig->slot].signal, NULL,
+                            memory_order_release);
+      sig->slot = -1;
+    }
+
+  shv_send_empty_response(shv_ctx, rid);
+  return 0;
+}
+
+static int shv_signal_deadband(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+  double deadband = 0.0;
+  struct shv_node_signal *sig = UL_CONTAINEROF(item, struct shv_node_signal, shv_node);
+
+  shv_unpack_data(&shv_ctx->unpack_ctx, 0, &deadband);
+  if (sig->slot < 0)
+    {
+      shv_send_error(shv_ctx, rid, SHV_RE_METHOD_CALL_EXCEPTION, "Signal not subscribed!");
+      return -1;
+    }
+
+  sig->stream->subs[sig->slot].deadband = deadband;
+  shv_send_empty_response(shv_ctx, rid);
+  return 0;
+}
+
+static int shv_signal_minperiod(struct shv_con_ctx *shv_ctx, struct shv_node *item, int rid)
+{
+  double min_period = 0.0;
+  struct shv_node_signal *sig = UL_CONTAINEROF(item, struct shv_node_signal, shv_node);
+
+  shv_unpack_data(&shv_ctx->unpack_ctx, 0, &min_period);
+  if (sig->slot < 0)
+    {
+      shv_send_error(shv_ctx, rid, SHV_RE_METHOD_CALL_EXCEPTION, "Signal not subscribed!");
+      return -1;
+    }
+
+  sig->stream->subs[sig->slot].min_period = min_period;
+  shv_send_empty_response(shv_ctx, rid);
+  return 0;
+}
+
+static const struct shv_method_des shv_dmap_item_signal_deadband =
+{
+  .name = "deadband",
+  .param = "f",
+  .result = "",
+  .access = SHV_ACCESS_WRITE,
+  .method = shv_signal_deadband
+};
+
+static const struct shv_method_des shv_dmap_item_signal_get =
+{
+  .name = "get",
+  .flags = SHV_METHOD_GETTER,
+  .param = "i(0,)|n",
+  .result = "f",
+  .access = SHV_ACCESS_READ,
+  .method = shv_signal_get
+};
+
+static const struct shv_method_des shv_dmap_item_signal_minperiod =
+{
+  .name = "minperiod",
+  .param = "f",
+  .result = "",
+  .access = SHV_ACCESS_WRITE,
+  .method = shv_signal_minperiod
+};
+
+static const struct shv_method_des shv_dmap_item_signal_subscribe =
+{
+  .name = "subscribe",
+  .param = "i(1,)|n",
+  .result = "",
+  .access = SHV_ACCESS_WRITE,
+  .method = shv_signal_subscribe
+};
+
+static const struct shv_method_des shv_dmap_item_signal_unsubscribe =
+{
+  .name = "unsubscribe",
+  .result = "",
+  .access = SHV_ACCESS_WRITE,
+  .method = shv_signal_unsubscribe
+};
+
+static const struct shv_method_des * const shv_signal_dmap_items[] =
+{
+  &shv_dmap_item_signal_deadband,
+  &shv_dmap_item_dir,
+  &shv_dmap_item_signal_get,
+  &shv_dmap_item_ls,
+  &shv_dmap_item_signal_minperiod,
+  &shv_dmap_item_signal_subscribe,
+  &shv_dmap_item_signal_unsubscribe
+};
+
+const struct shv_dmap shv_signal_dmap = SHV_CREATE_NODE_DMAP(signal, shv_signal_dmap_items);
+
+static void _shv_node_signal_destructor(struct shv_node *this)
+{
+  struct shv_node_signal *item = UL_CONTAINEROF(this, struct shv_node_signal, shv_node);
+
+  /* The stream is already stopped and freed by shv_tree_end() */
+
+  free(item->path);
+  free(item);
+}
+
+/****************************************************************************
+ * Name: shv_node_signal_new
+ *
+ * Description:
+ *  Allocates a signal node. The node keeps its full path, the name of
+ *  the node points to the last component of the path.
+ *
+ ****************************************************************************/
+
+struct shv_node_signal *shv_node_signal_new(const char *parent_path,
+                                            const char *child_name,
+                                            const double *val_ptr,
+                                            struct shv_stream *stream,
+                                            int mode)
+{
+  size_t len = strlen(parent_path) + strlen(child_name) + 2;
+  struct shv_node_signal *item = calloc(1, sizeof(struct shv_node_signal));
+
+  if (item == NULL)
+    {
+      return NULL;
+    }
+
+  item->path = malloc(len);
+  if (item->path == NULL)
+    {
+      free(item);
+      return NULL;
+    }
+
+  snprintf(item->path, len, "%s/%s", parent_path, child_name);
+  item->val_ptr = val_ptr;
+  item->stream = stream;
+  item->slot = -1;
+
+  shv_tree_node_init(&item->shv_node, item->path + strlen(parent_path) + 1,
+                     shv_stream_dmap(&shv_signal_dmap), mode);
+  item->shv_node.vtable.destructor = _shv_node_signal_destructor;
+  return item;
+}
@@ -21,23 +21,202 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include "fmi2.h"
 #include <fmu_fun.h>
 
-double get_run_time();
+/* Poll period of an asynchronous (fmi2Pending) step */
+
+#define FMU_PENDING_POLL_US 50
+
+/* realPar[2] is the step budget. If it is zero, the FMU is stepped
+ * in CG_OUT. Otherwise the FMU runs on its own thread one sample behind
+ * the model: CG_OUT takes the outputs of the step requested in the
+ * previous sample and requests the next one. A step running longer than
+ * the budget is interrupted and counted as an overrun, the outputs are
+ * held and the missing time is stepped with the next request. An
+ * asynchronous step still pending at the deadline is cancelled, FMI 2.0
+ * allows no further step of the instance then and the outputs are held
+ * up to the end. The overruns and failures are reported by CG_END.
+ */
 
 struct fmustruct{
   FMU* fmu;
   fmi2Component c;
+  double t;                   /* Communication point of the FMU */
+  double tnext;               /* Model time the FMU should reach */
+  double budget;              /* Step budget [s], 0 steps in CG_OUT */
+
+  /* Worker thread, used only with a budget */
+
+  pthread_t thrd;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int request;                /* A step waits for the worker */
+  int busy;                   /* Worker owns inp, out and the FMU */
+  int terminate;
+  int failed;                 /* Worker stopped after an FMU error */
+  int canceled;               /* Failed by a cancelled step */
+  int prio_set;               /* Worker priority derived from the RT thread */
+  double tend;                /* End of the requested step */
+  struct timespec deadline;   /* Budget of the requested step */
+  unsigned long overruns;
+  fmi2Real *inp;
+  fmi2Real *out;
 };
 
+/* Waits for the end of an asynchronous step. With a deadline the step
+ * is cancelled when the deadline passes, the instance accepts no more
+ * steps then and fmi2Error is returned.
+ */
+
+static fmi2Status fmu_wait_pending(struct fmustruct *strFMU,
+                                   const struct timespec *deadline)
+{
+  fmi2Status status;
+  struct timespec now;
+
+  for(;;){
+    if(strFMU->fmu->getStatus(strFMU->c, fmi2DoStepStatus, &status) > fmi2Warning)
+      return fmi2Error;
+    if(status != fmi2Pending)
+      return status;
+
+    if(deadline){
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      if((now.tv_sec > deadline->tv_sec) ||
+         ((now.tv_sec == deadline->tv_sec) && (now.tv_nsec >= deadline->tv_nsec))){
+        strFMU->fmu->cancelStep(strFMU->c);
+        strFMU->canceled = 1;
+        return fmi2Error;
+      }
+    }
+    usleep(FMU_PENDING_POLL_US);
+  }
+}
+
+/* Steps the FMU by major steps dt up to tend. Returns fmi2Discard if
+ * the deadline passed before tend was reached, the FMU time is left
+ * at the last finished step then.
+ */
+
+static fmi2Status fmu_step(struct fmustruct *strFMU, double tend, double dt,
+                           const struct timespec *deadline)
+{
+  fmi2Status ret;
+  struct timespec now;
+
+  while(tend - strFMU->t > 0.5*dt){
+    ret = strFMU->fmu->doStep(strFMU->c, strFMU->t, dt, fmi2True);
+    if(ret == fmi2Pending)
+      ret = fmu_wait_pending(strFMU, deadline);
+    if(ret > fmi2Warning)
+      return ret;
+    strFMU->t += dt;
+
+    if(deadline){
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      if((now.tv_sec > deadline->tv_sec) ||
+         ((now.tv_sec == deadline->tv_sec) && (now.tv_nsec >= deadline->tv_nsec)))
+        return (tend - strFMU->t > 0.5*dt) ? fmi2Discard : fmi2OK;
+    }
+  }
+  return fmi2OK;
+}
+
+static void *fmu_worker(void *arg)
+{
+  python_block *block = (python_block *) arg;
+  struct fmustruct *strFMU =  (struct fmustruct *) block->ptrPar;
+  int * intPar = block->intPar;
+  double dt = block->realPar[1];
+  int len_in = block->nin;
+  int len_out = block->nout;
+  fmi2Status ret;
+  int overrun;
+
+  pthread_mutex_lock(&strFMU->mutex);
+  for(;;){
+    while(!strFMU->request && !strFMU->terminate)
+      pthread_cond_wait(&strFMU->cond, &strFMU->mutex);
+    if(strFMU->terminate)
+      break;
+    strFMU->request = 0;
+    pthread_mutex_unlock(&strFMU->mutex);
+
+    /* inp, out and the FMU are not touched by the RT thread while busy */
+
+    ret = fmi2OK;
+    overrun = 0;
+    if(len_in != 0)
+      ret = strFMU->fmu->setReal(strFMU->c, &intPar[2], len_in, strFMU->inp);
+    if(ret <= fmi2Warning){
+      ret = fmu_step(strFMU, strFMU->tend, dt, &strFMU->deadline);
+      if(ret == fmi2Discard){
+        overrun = 1;
+        ret = fmi2OK;
+      }
+    }
+    if(ret <= fmi2Warning)
+      ret = strFMU->fmu->getReal(strFMU->c, &intPar[2+len_in], len_out, strFMU->out);
+
+    pthread_mutex_lock(&strFMU->mutex);
+    if(ret > fmi2Warning){
+      /* No more calls into the instance, the outputs are held */
+      strFMU->failed = 1;
+      overrun = strFMU->canceled;
+    }
+    strFMU->overruns += overrun;
+    strFMU->busy = 0;
+    if(strFMU->failed)
+      break;
+  }
+  pthread_mutex_unlock(&strFMU->mutex);
+  return NULL;
+}
+
+static void init_worker(python_block *block)
+{
+  struct fmustruct *strFMU =  (struct fmustruct *) block->ptrPar;
+  pthread_mutexattr_t mattr;
+
+  strFMU->inp = (fmi2Real *) calloc(block->nin + 1, sizeof(fmi2Real));
+  strFMU->out = (fmi2Real *) calloc(block->nout + 1, sizeof(fmi2Real));
+  if(!strFMU->inp || !strFMU->out){
+    printf("could not allocate FMU worker buffers");
+    exit(1);
+  }
+
+  /* Outputs of the initialized model for the first sample */
+
+  if(strFMU->fmu->getReal(strFMU->c, &block->intPar[2+block->nin], block->nout,
+                          strFMU->out) > fmi2Warning){
+    printf("could not read FMU outputs");
+    exit(1);
+  }
+
+  pthread_mutexattr_init(&mattr);
+  pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
+  pthread_mutex_init(&strFMU->mutex, &mattr);
+  pthread_mutexattr_destroy(&mattr);
+  pthread_cond_init(&strFMU->cond, NULL);
+
+  if(pthread_create(&strFMU->thrd, NULL, fmu_worker, block)){
+    printf("could not start FMU worker thread");
+    exit(1);
+  }
+}
+
 static void init(python_block *block)
 {
   ModelDescription* md;
   char * guid;
   const char *instanceName; 
-  char *fmuResourceLocation = getTempResourcesLocation(block->str);
-  fmi2CallbackFunctions callbacks = {fmuLogger, calloc, free, NULL, NULL};
+  char *fmuResourceLocation;
+  /* The instance keeps a pointer to the callbacks */
+  static const fmi2CallbackFunctions callbacks = {fmuLogger, calloc, free, NULL, NULL};
   Element *defaultExp;
   fmi2Real tolerance = 0; 
   fmi2Boolean toleranceDefined = fmi2False;
@@ -45,9 +224,10 @@ static void init(python_block *block)
   fmi2Status fmi2Flag;
     
   struct fmustruct *strFMU = (struct fmustruct *) malloc(sizeof(struct fmustruct));  
-  FMU *fmu = (FMU*) malloc(sizeof(FMU));
+  /* Instances of one FMU share the unpacked files and the library */
+  FMU *fmu = acquireFMU(block->str);
 
-  loadFMU(fmu, block->str);
+  fmuResourceLocation = getSharedResourcesLocation(fmu);
   md = fmu->modelDescription;
   guid = getAttributeValue((Element *)md, att_guid);
     
@@ -84,15 +264,19 @@ static void init(python_block *block)
 	exit(1);
     }
   
+  memset(strFMU, 0, sizeof(struct fmustruct));
   strFMU->fmu = fmu;
   strFMU->c = c;
+  strFMU->budget = block->realPar[2];
   block->ptrPar = (void *) strFMU;
+
+  if(strFMU->budget > 0)
+    init_worker(block);
 }
 
 static void inout(python_block *block)
 {
   fmi2Status ret;
-  fmi2Component myC = (fmi2Component) block->ptrPar;
   fmi2Real inp[block->nin];
   fmi2Real out[block->nout];
   int i;
@@ -101,7 +285,7 @@ static void inout(python_block *block)
   int len_in = block->nin;
   int len_out = block->nout;
   
-  double ts = realPar[0];;
+  double ts = realPar[0];
   double dt = realPar[1];
   double *u;
   double *y;
@@ -109,8 +293,7 @@ static void inout(python_block *block)
   struct fmustruct *strFMU =  (struct fmustruct *) block->ptrPar;
   fmi2Component  c = strFMU->c;
 
-  double t = get_run_time();
-  double tend = t + ts;
+  strFMU->tnext += ts;
  
   /* Update the outputs */
   ret = strFMU->fmu->getReal(c, &intPar[2+len_in], len_out, out);
@@ -132,27 +315,103 @@ static void inout(python_block *block)
   }
   
   /* Perform the integration step */
-  do{
-    t +=dt;
-    do{
-      ret = strFMU->fmu->doStep(c, t, dt, fmi2True);
-    }while(ret!=fmi2OK);
-    t += dt;
-  }while(t<tend);
+  ret = fmu_step(strFMU, strFMU->tnext, dt, NULL);
+  if(ret > fmi2Warning){
+    printf("FMU %s: doStep failed at t=%g\n", block->str, strFMU->t);
+    exit(1);
+  }
+}
+
+static void inout_worker(python_block *block)
+{
+  struct fmustruct *strFMU =  (struct fmustruct *) block->ptrPar;
+  struct sched_param param;
+  struct timespec now;
+  int policy;
+  int i;
+  double *u;
+  double *y;
+
+  strFMU->tnext += block->realPar[0];
+
+  /* Run the worker just below the thread calling the model */
+
+  if(!strFMU->prio_set){
+    strFMU->prio_set = 1;
+    if(!pthread_getschedparam(pthread_self(), &policy, &param) &&
+       (policy == SCHED_FIFO) && (param.sched_priority > 1)){
+      param.sched_priority--;
+      pthread_setschedparam(strFMU->thrd, SCHED_FIFO, &param);
+    }
+  }
+
+  pthread_mutex_lock(&strFMU->mutex);
+  if(strFMU->busy || strFMU->failed){
+    /* Hold the outputs, the next request covers the missed time */
+
+    if(strFMU->busy)
+      strFMU->overruns++;
+    pthread_mutex_unlock(&strFMU->mutex);
+    return;
+  }
+
+  for(i=0;i<block->nout;i++){
+    y = (double *) block->y[i];
+    y[0] = (double) strFMU->out[i];
+  }
+  for(i=0;i<block->nin;i++){
+    u = (double *) block->u[i];
+    strFMU->inp[i] = (fmi2Real) u[0];
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  now.tv_sec += (time_t) strFMU->budget;
+  now.tv_nsec += (long) ((strFMU->budget - (time_t) strFMU->budget) * 1e9);
+  if(now.tv_nsec >= 1000000000){
+    now.tv_nsec -= 1000000000;
+    now.tv_sec++;
+  }
+  strFMU->deadline = now;
+  strFMU->tend = strFMU->tnext;
+  strFMU->busy = 1;
+  strFMU->request = 1;
+  pthread_cond_signal(&strFMU->cond);
+  pthread_mutex_unlock(&strFMU->mutex);
 }
 
 static void end(python_block *block)
 {
   struct fmustruct *strFMU =  (struct fmustruct *) block->ptrPar;
-  dlclose(strFMU->fmu->dllHandle);
-  freeModelDescription(strFMU->fmu->modelDescription);
-  deleteUnzippedFiles(block->str);
+
+  if(strFMU->budget > 0){
+    pthread_mutex_lock(&strFMU->mutex);
+    strFMU->terminate = 1;
+    pthread_cond_signal(&strFMU->cond);
+    pthread_mutex_unlock(&strFMU->mutex);
+    pthread_join(strFMU->thrd, NULL);
+
+    if(strFMU->overruns)
+      printf("FMU %s: %lu step overruns\n", block->str, strFMU->overruns);
+    if(strFMU->canceled)
+      printf("FMU %s: stopped after a cancelled step at t=%g\n", block->str, strFMU->t);
+    else if(strFMU->failed)
+      printf("FMU %s: stopped after an FMU error at t=%g\n", block->str, strFMU->t);
+    free(strFMU->inp);
+    free(strFMU->out);
+  }
+  strFMU->fmu->freeInstance(strFMU->c);
+  releaseFMU(strFMU->fmu);
+  free(strFMU);
 }
 
 void FMUinterface(int flag, python_block *block)
 {
   if (flag==CG_OUT){          /* get input */
-    inout(block);
+    struct fmustruct *strFMU =  (struct fmustruct *) block->ptrPar;
+    if(strFMU->budget > 0)
+      inout_worker(block);
+    else
+      inout(block);
   }
   else if (flag==CG_END){     /* termination */ 
     end(block);
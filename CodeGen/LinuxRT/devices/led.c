@@ -9,8 +9,10 @@
 #include <sys/un.h>
 #include <unistd.h>
 #include <sched.h>
+#include <stdatomic.h>
 
 #include <pyblock.h>
+#include <threadclass.h>
 
 /* sth to convert number macros to strings */
 #define STR_HELPER(x) #x
@@ -84,6 +86,7 @@ static void start_led(unsigned nin, int sock, const char * sock_name)
       perror("sched_setscheduler");
       exit(EXIT_FAILURE);
     }
+    set_thread_class("monitor");
     /* start led with sock_name and packet num as args */
     char * nin_str = unsigned_to_str(nin);
     if (!nin_str) {
@@ -124,7 +127,8 @@ static int led_init(python_block * blk)
 {
   int * intPar    = blk->intPar;
   /* allow us to have more than one led */
-  static unsigned num_instances = 0;
+  static atomic_uint num_instances;
+  unsigned instance = atomic_fetch_add(&num_instances, 1);
   /* remove old led if exists */
   /* remLed(); */
   /* get _led struct and append to blk */
@@ -142,11 +146,9 @@ static int led_init(python_block * blk)
   }
   ld->buff_pos = 0;
   snprintf(ld->sock_name,
-	   SOCK_NAME_MAX_LEN, "/tmp/%s%u", SOCKET_NAME, num_instances);
+	   SOCK_NAME_MAX_LEN, "/tmp/%s%u", SOCKET_NAME, instance);
   remove(ld->sock_name);
   blk->ptrPar = (void *)ld;
-  /* count instances up */
-  num_instances++;
 
   struct sockaddr_un sockaddr;
   socklen_t addrlen = sizeof(sockaddr);
@@ -9,8 +9,10 @@
 #include <sys/un.h>
 #include <unistd.h>
 #include <sched.h>
+#include <stdatomic.h>
 
 #include <pyblock.h>
+#include <threadclass.h>
 
 /* sth to convert number macros to strings */
 #define STR_HELPER(x) #x
@@ -21,18 +23,33 @@
 #define SOCK_NAME_MAX_LEN 108
 #define BACKLOG 1
 
-/* how many values to send for each stream to plotter */
+/* how many values to send for each stream to plotter, the packets
+   are sized for about PACKET_PERIOD seconds of samples */
 #define PACKET_NUM 12U
+#define PACKET_MAX_BYTES 65536U
+#define PACKET_PERIOD 0.01
 #define DOUBLE_SIZE sizeof(double)
 
+/* socket buffer, absorbs short stalls of the plotter */
+#define SEND_BUFFER (1 << 20)
+
 #define PYCONTROL_PATH_ENV_VAR "PYSUPSICTRL"
 #define PLOTTER_COMMAND_ARGV_NUM 5
 /* when compiling define PLOTTER_SCRIPT */
 
+/* Each packet is one message of the SOCK_SEQPACKET socket: the index
+   of its first sample followed by packet_num samples of all inputs.
+   The model never waits for the plotter, a packet that does not fit
+   into the socket buffer is dropped and the plotter sees the gap in the
+   sample index. */
+
 struct _scope {
   int sock;
   size_t buff_pos;
   size_t buff_len;
+  unsigned packet_num;
+  double sample;
+  unsigned long dropped;
   char sock_name[SOCK_NAME_MAX_LEN];
   char * buff;
 };
@@ -74,7 +91,8 @@ static char * unsigned_to_str(unsigned u)
   return str;
 }
 
-static void start_plotter(unsigned nin, int sock, int timed, const char * sock_name)
+static void start_plotter(unsigned nin, unsigned packet_num, int sock, double dt,
+                          const char * sock_name)
 {
   /* fork off process that will NOT run as rt */
   pid_t pid = fork();
@@ -87,12 +105,12 @@ static void start_plotter(unsigned nin, int sock, int timed, const char * sock_n
       perror("sched_setscheduler");
       exit(EXIT_FAILURE);
     }
+    set_thread_class("monitor");
     /* start plotter with sock_name and packet num as args */
-    char * packet_num_str = unsigned_to_str(PACKET_NUM);
-    char dtime[10];
-    if(timed) sprintf(dtime, "%9.6lf", get_Tsamp());
-    else        sprintf(dtime, "1");
-	    
+    char * packet_num_str = unsigned_to_str(packet_num);
+    char dtime[32];
+    snprintf(dtime, sizeof(dtime), "%.9g", dt);
+
     if (!packet_num_str) {
       unlink(sock_name);
       fprintf(stderr, "mem error in start_plotter\n");
@@ -140,7 +158,8 @@ static int scope_init(python_block * blk)
 {
   int * intPar    = blk->intPar;
   /* allow us to have more than one scope */
-  static unsigned num_instances = 0;
+  static atomic_uint num_instances;
+  unsigned instance = atomic_fetch_add(&num_instances, 1);
   /* remove old scope if exists */
   /* remScope(); */
   /* get _scope struct and append to blk */
@@ -149,7 +168,18 @@ static int scope_init(python_block * blk)
     fprintf(stderr, "Memory error in scope_init\n");
     exit(EXIT_FAILURE);
   }
-  sc->buff_len = blk->nin * PACKET_NUM * DOUBLE_SIZE;
+  /* intPar[0] selects a time axis, intPar[1] is the decimation */
+  double dt = intPar[1] * get_Tsamp();
+  double pn = PACKET_PERIOD / dt;
+  unsigned pn_max = PACKET_MAX_BYTES / (blk->nin * DOUBLE_SIZE);
+  if (pn_max > 1)
+    pn_max--;
+  sc->packet_num = PACKET_NUM;
+  if (pn > sc->packet_num)
+    sc->packet_num = pn;
+  if (sc->packet_num > pn_max)
+    sc->packet_num = pn_max;
+  sc->buff_len = (1 + blk->nin * sc->packet_num) * DOUBLE_SIZE;
   sc->buff = malloc(sc->buff_len * sizeof(*sc->buff));
   if (!sc->buff) {
     free(sc);
@@ -157,12 +187,12 @@ static int scope_init(python_block * blk)
     exit(EXIT_FAILURE);
   }
   sc->buff_pos = 0;
+  sc->sample = 0;
+  sc->dropped = 0;
   snprintf(sc->sock_name,
-	   SOCK_NAME_MAX_LEN, "/tmp/%s%u", SOCKET_NAME, num_instances);
+	   SOCK_NAME_MAX_LEN, "/tmp/%s%u", SOCKET_NAME, instance);
   remove(sc->sock_name);
   blk->ptrPar = (void *)sc;
-  /* count instances up */
-  num_instances++;
 
   struct sockaddr_un sockaddr;
   socklen_t addrlen = sizeof(sockaddr);
@@ -171,7 +201,7 @@ static int scope_init(python_block * blk)
   strncpy(sockaddr.sun_path, sc->sock_name, SOCK_NAME_MAX_LEN);
 
   /* get unix socket */
-  int sock = socket(sockaddr.sun_family, SOCK_STREAM, 0);
+  int sock = socket(sockaddr.sun_family, SOCK_SEQPACKET, 0);
   if (0 > sock) {
     free(sc->buff);
     free(sc);
@@ -202,7 +232,8 @@ static int scope_init(python_block * blk)
   }
 
   /* try to start plotter process */
-  start_plotter(blk->nin, sock, intPar[0], sc->sock_name);
+  start_plotter(blk->nin, sc->packet_num, sock, intPar[0] ? dt : 1.0,
+                sc->sock_name);
 
   /* accept (blocking call) plotter */
   int conn = accept(sock, 0, 0);
@@ -215,40 +246,41 @@ static int scope_init(python_block * blk)
     exit(EXIT_FAILURE);
   }
   close(sock);
+  int sndbuf = SEND_BUFFER;
+  setsockopt(conn, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
   sc->sock = conn;
   intPar[2] = 0;	
+  return 0;
 }
 
 static void scope_out(python_block * blk)
 {
   int * intPar    = blk->intPar;
   struct _scope * sc = (struct _scope *)blk->ptrPar;
-  int sock = sc->sock;
-  char * buff = sc->buff;
-  size_t send_ret = 0;
-  int send_ret2 = 0;
-  size_t buff_len = sc->buff_len;
+  double * buff = (double *)sc->buff;
   unsigned nin = blk->nin;
-  /* write values to buffer */
+  /* write values to buffer, after the sample index */
 	
   if((intPar[2] % intPar[1]) == 0){
+    if (sc->buff_pos == 0)
+      buff[0] = sc->sample;
     for (unsigned i = 0; nin > i; i++)
-      memcpy((void *)(buff + (sc->buff_pos + i) * DOUBLE_SIZE),
-	     blk->u[i], DOUBLE_SIZE);
+      memcpy(&buff[1 + sc->buff_pos + i], blk->u[i], DOUBLE_SIZE);
     sc->buff_pos += nin;
+    sc->sample += 1;
     /* if we are to send this tick, well send buffer contents */
-    if (PACKET_NUM * nin == sc->buff_pos) {
-      while (buff_len != send_ret) {
-	send_ret2 = send(sock, buff, buff_len, 0);
-	if (0 > send_ret2) {
-	  /* assuming this only happens when */
-	  /* plotter quits before we do */
-	  perror("send");
-	  break;
-	} else
-	  send_ret += send_ret2;
+    if (sc->packet_num * nin == sc->buff_pos) {
+      if (sc->sock >= 0 &&
+          send(sc->sock, buff, sc->buff_len, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          sc->dropped++;
+        } else {
+          /* plotter quit before we do */
+          perror("scope send");
+          close(sc->sock);
+          sc->sock = -1;
+        }
       }
-      send_ret = 0;
       sc->buff_pos = 0;
     }
   }
@@ -258,8 +290,10 @@ static void scope_out(python_block * blk)
 static void scope_end(python_block * blk)
 {
   struct _scope * sc = (struct _scope *)blk->ptrPar;
-  int sock = sc->sock;
-  close(sock);
+  if (sc->dropped)
+    fprintf(stderr, "scope: %lu packets dropped, plotter too slow\n", sc->dropped);
+  if (sc->sock >= 0)
+    close(sc->sock);
   unlink(sc->sock_name);
   free(sc->buff);
   free(sc);
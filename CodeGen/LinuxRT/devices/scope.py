@@ -3,97 +3,335 @@
 import sys
 import os
 import socket
+import threading
+import time
 import numpy as np
 
 from PyQt5 import QtWidgets, QtCore
 import pyqtgraph as pg
 
 COL = 170
-PENWIDTH = 2.0
+PENWIDTH = 1.0
 pg.setConfigOption('background', pg.mkColor((COL, COL, COL)))
 pg.setConfigOption('foreground', 'k')
 
-# globals
-SOCKET_NAME = sys.argv[1]
 CONNECTION_TRIES = 9999 # just in case
-PACKET_NUM = int(sys.argv[2])
-NIN = int(sys.argv[3]);
-DT = float(sys.argv[4]);
-PLOT_LEN = 2048
-
-if DT != 1:
-    PLOT_LEN = int(20/DT)
-    
 DOUBLE_SIZE = 8
-PACKET_LEN = NIN * PACKET_NUM * DOUBLE_SIZE
 PLOT_LINE_COLORS = ['y', 'g', 'r', 'b', 'c', 'm', 'k', 'w']
 PLOT_WINDOM_SIZE = (1000, 600)
 TIMER_PERIOD = 20
 
-# connect to model
-sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
-for i in range(CONNECTION_TRIES):
-    try:
-        sock.connect(SOCKET_NAME)
-        break;
-    except OSError as msg:
-        os.write(2, str.encode(msg))
-
-# some plot related stuff
-app = QtWidgets.QApplication([])
-#win = pg.GraphicsWindow(title="Scope")
-win = pg.GraphicsLayoutWidget(title="Scope")
-win.resize(PLOT_WINDOM_SIZE[0], PLOT_WINDOM_SIZE[1])
-pg.setConfigOptions(antialias=True)
-plots = []
-curves = []
-p = win.addPlot(title="u"+str(i))
-plots.append(p)
-# add plots for all inputs to blk
-for i in range(NIN):
-    p.showGrid(x=True, y=True)
-    c = PLOT_LINE_COLORS[i % len(PLOT_LINE_COLORS)]
-    curves.append(p.plot(pen={'color':c, 'width' : PENWIDTH}))
-    win.nextRow()
-win.show()
-
-xdata = np.zeros(shape=(NIN, PLOT_LEN))
-ydata = np.zeros(shape=(NIN, PLOT_LEN))
-
-# time bounds, s.t. we start at 0 Delta
-t = -PLOT_LEN
-x = np.arange(-PLOT_LEN, 0)*DT
-for i in range(NIN):
-    xdata[i][-PLOT_LEN:] = x
-
-
-def update():
-    """Will receive data from model and plot it."""
-    import struct
-    global t, curves, xdata, ydata, PACKET_NUM, NIN, timer
-    data = sock.recv(PACKET_LEN, socket.MSG_WAITALL)
-    if not data:
-        # other end closed connection
-        sock.close()
-        timer.stop()
-        return
-
-    data = list(struct.unpack('d' * (NIN * PACKET_NUM), data))
-    x=(np.arange(0,PACKET_NUM)+PLOT_LEN+t)*DT
-    t += PACKET_NUM
-    xdata = np.roll(xdata, -PACKET_NUM)
-    ydata = np.roll(ydata, -PACKET_NUM)
-
-    for j in range(NIN):
-        ydata[j][-PACKET_NUM:] = data[j::NIN]
-        xdata[j][-PACKET_NUM:] = x
-        curves[j].setData(xdata[j], ydata[j])
-
-timer = QtCore.QTimer()
-timer.timeout.connect(update)
-timer.start(TIMER_PERIOD)
+LOD_FACTOR = 16           # Samples per block between two detail levels
+LOD_MIN_LEN = 1024        # Min. number of blocks of the coarsest level
+RING_BYTES = 1 << 27      # Max. memory for the raw samples
+PRETRIGGER = 0.1          # Part of the window before the trigger
+
+
+class Ring:
+    """Samples of all channels in a circular buffer.
+
+    Row i % cap holds sample i, the receiver writes the packets in place
+    and nothing is shifted. Level k keeps the min and max of the blocks of
+    LOD_FACTOR**k samples, a block is reduced once when it is complete.
+    window() then draws any range from the level giving about two points
+    per pixel.
+    """
+    def __init__(self, cap, nin):
+        f = LOD_FACTOR
+        self.levels = 0
+        while cap // f**(self.levels+1) >= LOD_MIN_LEN:
+            self.levels += 1
+        s = f**self.levels
+        self.cap = max(s, (cap + s - 1) // s * s)
+        self.nin = nin
+        self.raw = np.full((self.cap, nin), np.nan)
+        self.mn = [self.raw]
+        self.mx = [self.raw]
+        for k in range(1, self.levels+1):
+            self.mn.append(np.full((self.cap // f**k, nin), np.nan))
+            self.mx.append(np.full((self.cap // f**k, nin), np.nan))
+        self.done = [0] * (self.levels+1)
+        self.head = 0
+        self.dropped = 0
+        self.resync = False
+        self.lock = threading.Lock()
+
+    def write(self, i, rows):
+        n = len(rows)
+        p = i % self.cap
+        k = min(n, self.cap - p)
+        self.raw[p:p+k] = rows[:k]
+        if k < n:
+            self.raw[:n-k] = rows[k:]
+
+    def put(self, idx, rows):
+        with self.lock:
+            if idx < self.head:
+                rows = rows[self.head-idx:]
+                idx = self.head
+            if idx > self.head:
+                # Packets lost or skipped while paused, break the lines
+                if not self.resync:
+                    self.dropped += idx - self.head
+                i = max(self.head, idx - self.cap)
+                self.write(i, np.full((idx - i, self.nin), np.nan))
+            self.resync = False
+            self.write(idx, rows)
+            self.head = idx + len(rows)
+            self.reduce()
+
+    def reduce(self):
+        f = LOD_FACTOR
+        for k in range(1, self.levels+1):
+            n = len(self.mn[k])
+            end = self.head // f**k
+            b = max(self.done[k], end - n)
+            while b < end:
+                p = b % n
+                m = min(end - b, n - p)
+                lo = self.mn[k-1][p*f:(p+m)*f].reshape(m, f, self.nin)
+                hi = self.mx[k-1][p*f:(p+m)*f].reshape(m, f, self.nin)
+                self.mn[k][p:p+m] = np.fmin.reduce(lo, axis=1)
+                self.mx[k][p:p+m] = np.fmax.reduce(hi, axis=1)
+                b += m
+            self.done[k] = end
+
+    def rows(self, a, j0, j1):
+        n = len(a)
+        p0 = j0 % n
+        if p0 + j1 - j0 <= n:
+            return a[p0:p0+j1-j0].copy()
+        return np.concatenate((a[p0:], a[:(j1 - j0) - (n - p0)]))
+
+    def window(self, i0, i1, width):
+        # Samples i0..i1 reduced to min/max pairs of about width bins
+        with self.lock:
+            i0 = max(i0, self.head - self.cap, 0)
+            i1 = min(i1, self.head)
+            if i1 <= i0:
+                return None
+            width = max(width, 1)
+            k = 0
+            while k < self.levels and (i1 - i0) // LOD_FACTOR**(k+1) >= 2*width:
+                k += 1
+            s = LOD_FACTOR**k
+            j0 = i0 // s
+            j1 = min((i1 + s - 1) // s, self.done[k] if k else i1)
+            if j1 <= j0:
+                return None
+            lo = self.rows(self.mn[k], j0, j1)
+            hi = self.rows(self.mx[k], j0, j1) if k else lo
+
+        m = j1 - j0
+        if k == 0 and m <= 2*width:
+            return (np.arange(j0, j1), lo)
+
+        b = (m + width - 1) // width
+        nb = (m + b - 1) // b
+        pad = nb*b - m
+        if pad:
+            fill = np.full((pad, self.nin), np.nan)
+            lo = np.concatenate((lo, fill))
+            hi = np.concatenate((hi, fill))
+        lo = np.fmin.reduce(lo.reshape(nb, b, self.nin), axis=1)
+        hi = np.fmax.reduce(hi.reshape(nb, b, self.nin), axis=1)
+        y = np.empty((2*nb, self.nin))
+        y[0::2] = lo
+        y[1::2] = hi
+        x = np.repeat((j0 + np.arange(nb)*b) * s, 2)
+        return (x, y)
+
+    def trigger(self, ch, level, rising, length):
+        # Last crossing of level with a full window after it
+        with self.lock:
+            end = self.head - int(length*(1.0 - PRETRIGGER))
+            start = max(self.head - self.cap, end - 2*length, 0)
+            if end - start < 2:
+                return None
+            y = self.rows(self.raw, start, end)[:, ch]
+        if rising:
+            hit = (y[:-1] < level) & (y[1:] >= level)
+        else:
+            hit = (y[:-1] > level) & (y[1:] <= level)
+        n = np.flatnonzero(hit)
+        if len(n) == 0:
+            return None
+        return start + int(n[-1]) + 1
+
+
+class Receiver(threading.Thread):
+    """Reads the packets of the model, one message each, out of the GUI
+    thread. The numbers are viewed in the receive buffer, not converted
+    one by one. While paused the packets are read and thrown away, the
+    model never waits for the viewer."""
+    def __init__(self, sock, ring, packet_num):
+        super().__init__(daemon=True)
+        self.sock = sock
+        self.ring = ring
+        self.packet_num = packet_num
+        self.paused = False
+        self.closed = False
+        self.received = 0
+
+    def run(self):
+        nin = self.ring.nin
+        size = (1 + nin*self.packet_num) * DOUBLE_SIZE
+        buf = bytearray(size)
+        data = np.frombuffer(buf, dtype=np.float64)
+        while True:
+            try:
+                n = self.sock.recv_into(buf)
+            except OSError:
+                n = 0
+            if n == 0:
+                break
+            if n != size:
+                continue
+            self.received += self.packet_num
+            if self.paused:
+                self.ring.resync = True
+                continue
+            self.ring.put(int(data[0]), data[1:].reshape(self.packet_num, nin))
+        self.closed = True
+        self.sock.close()
+
+
+class Scope(QtWidgets.QWidget):
+    def __init__(self, ring, receiver, nin, dt, plot_len):
+        super().__init__()
+        self.ring = ring
+        self.receiver = receiver
+        self.dt = dt
+        self.plot_len = plot_len
+        self.window = None
+        self.lastCount = 0
+        self.lastTime = time.monotonic()
+
+        self.setWindowTitle('Scope')
+        self.resize(PLOT_WINDOM_SIZE[0], PLOT_WINDOM_SIZE[1])
+        layout = QtWidgets.QVBoxLayout(self)
+        bar = QtWidgets.QHBoxLayout()
+        layout.addLayout(bar)
+
+        self.pauseBtn = QtWidgets.QPushButton('Pause')
+        self.pauseBtn.setCheckable(True)
+        self.pauseBtn.toggled.connect(self.pause)
+        bar.addWidget(self.pauseBtn)
+
+        bar.addWidget(QtWidgets.QLabel('Trigger'))
+        self.trigMode = QtWidgets.QComboBox()
+        self.trigMode.addItems(['Free run', 'Rising edge', 'Falling edge'])
+        bar.addWidget(self.trigMode)
+        bar.addWidget(QtWidgets.QLabel('Input'))
+        self.trigCh = QtWidgets.QSpinBox()
+        self.trigCh.setRange(0, nin-1)
+        bar.addWidget(self.trigCh)
+        bar.addWidget(QtWidgets.QLabel('Level'))
+        self.trigLevel = QtWidgets.QDoubleSpinBox()
+        self.trigLevel.setRange(-1e9, 1e9)
+        self.trigLevel.setDecimals(4)
+        bar.addWidget(self.trigLevel)
+        bar.addStretch()
+        self.status = QtWidgets.QLabel('')
+        bar.addWidget(self.status)
+
+        self.plot = pg.PlotWidget()
+        self.plot.showGrid(x=True, y=True)
+        self.plot.setMouseEnabled(x=False, y=True)
+        self.plot.enableAutoRange(x=False, y=True)
+        self.plot.getViewBox().sigXRangeChanged.connect(self.rangeChanged)
+        layout.addWidget(self.plot)
+
+        self.curves = []
+        for i in range(nin):
+            c = PLOT_LINE_COLORS[i % len(PLOT_LINE_COLORS)]
+            self.curves.append(self.plot.plot(pen={'color':c, 'width' : PENWIDTH}))
+
+        self.timer = QtCore.QTimer()
+        self.timer.timeout.connect(self.update)
+        self.timer.start(TIMER_PERIOD)
+
+    def draw(self, i0, i1):
+        width = int(self.plot.getViewBox().width()) or PLOT_WINDOM_SIZE[0]
+        res = self.ring.window(i0, i1, width)
+        if res is None:
+            return
+        x, y = res
+        x = x * self.dt
+        for j, c in enumerate(self.curves):
+            c.setData(x, y[:, j], connect='finite')
+
+    def pause(self, on):
+        self.receiver.paused = on
+        self.plot.setMouseEnabled(x=on, y=True)
+        self.pauseBtn.setText('Run' if on else 'Pause')
+
+    def rangeChanged(self, vb, rng):
+        # Frozen data, draw what the zoom or pan shows
+        if self.receiver.paused:
+            self.draw(int(rng[0] / self.dt), int(rng[1] / self.dt) + 1)
+
+    def update(self):
+        now = time.monotonic()
+        if now - self.lastTime >= 1.0:
+            rate = (self.receiver.received - self.lastCount) / (now - self.lastTime)
+            self.lastCount = self.receiver.received
+            self.lastTime = now
+            txt = '%.0f samples/s' % rate
+            if self.ring.dropped:
+                txt += ', %d lost' % self.ring.dropped
+            if self.receiver.closed:
+                txt = 'Model stopped'
+            self.status.setText(txt)
+
+        if self.receiver.paused:
+            return
+
+        head = self.ring.head
+        mode = self.trigMode.currentIndex()
+        if mode == 0:
+            self.window = (head - self.plot_len, head)
+        else:
+            t = self.ring.trigger(self.trigCh.value(), self.trigLevel.value(),
+                                  mode == 1, self.plot_len)
+            if t is not None:
+                i0 = t - int(self.plot_len * PRETRIGGER)
+                self.window = (i0, i0 + self.plot_len)
+            elif self.window is None:
+                self.window = (head - self.plot_len, head)
+        i0, i1 = self.window
+        self.plot.setXRange(i0 * self.dt, i1 * self.dt, padding=0)
+        self.draw(i0, i1)
+
+
+def main():
+    sock_name = sys.argv[1]
+    packet_num = int(sys.argv[2])
+    nin = int(sys.argv[3])
+    dt = float(sys.argv[4])
+    plot_len = 2048
+    if dt != 1:
+        plot_len = int(20/dt)
+
+    # connect to model
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET)
+    for i in range(CONNECTION_TRIES):
+        try:
+            sock.connect(sock_name)
+            break;
+        except OSError as msg:
+            os.write(2, str.encode(str(msg)))
+
+    cap = max(plot_len, min(4*plot_len, RING_BYTES // (DOUBLE_SIZE*nin)))
+    ring = Ring(cap, nin)
+    receiver = Receiver(sock, ring, packet_num)
+
+    app = QtWidgets.QApplication([])
+    pg.setConfigOptions(antialias=False)
+    win = Scope(ring, receiver, nin, dt, plot_len)
+    win.show()
+    receiver.start()
+    app.exec_()
 
 if __name__ == "__main__":
-    import sys
-    if (1 != sys.flags.interactive) or not hasattr(QtCore, "PYQT_VERSION"):
-        QtWidgets.QApplication.instance().exec_()
+    main()
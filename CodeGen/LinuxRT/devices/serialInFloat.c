@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
 #include <termios.h>
 #include <unistd.h> 
 #include <pthread.h>
+#include <threadclass.h>
 
 static void * getData(void * p)
 {
@@ -33,6 +34,8 @@ static void * getData(void * p)
   double *y;
   float data[block->nout];
 
+  set_thread_class("io");
+
   maxlen = block->nout*sizeof(float);
 
   while(1){
@@ -17,6 +17,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
 */
 
 #include <pyblock.h>
+#include <blkinit.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <sys/socket.h>
@@ -26,6 +27,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
 #include <pthread.h>
 #include <signal.h>
 #include <unistd.h>
+#include <threadclass.h>
 
 double get_run_time();
 
@@ -37,6 +39,8 @@ void * reest_connection(void * p)
   char mysocket[80];
   python_block *block = (python_block *) p;
 
+  set_thread_class("io");
+
   while(1){
     if(block->intPar[0]==0){
       strcpy(mysocket,block->str);
@@ -52,6 +56,7 @@ void * reest_connection(void * p)
 	}
       }
       block->intPar[0] = sock;
+      if (sock) pysim_init_ready(block);
     }
     usleep(100000);
   }
@@ -82,6 +87,8 @@ static void initC(python_block *block)
   }
   block->intPar[0] = sock;
 
+  /* The loop may wait a little for the server */
+  if (!sock) pysim_init_pending(block);
   pthread_create(&thrd, NULL, reest_connection, (void *) block);
 }
 
@@ -146,6 +153,8 @@ void * est_connection(void * p)
     double val[block->nout];
   }values;
 
+  set_thread_class("io");
+
   strcpy(mysocket,block->str);
 
   unlink(mysocket);
@@ -190,6 +199,7 @@ void * est_connection(void * p)
     }
     block->intPar[0] = sock;
     block->intPar[1] = sc;
+    pysim_init_ready(block);
 
     while(sc){
       ret = recv(sc, &values, sizeof(values),0);
@@ -208,6 +218,7 @@ static void initS(python_block *block)
   double *y;
   
   pthread_t thrd;
+  pysim_init_pending(block);
   pthread_create(&thrd, NULL, est_connection, (void *) block);
 
 }
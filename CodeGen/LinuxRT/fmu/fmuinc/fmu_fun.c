@@ -201,6 +201,141 @@ void loadFMU(FMU * fmu, const char* fmuFileName) {
   free(tmpPath);
 }
 
+/* ------------------------------------------------------------------------- 
+ * Shared FMUs
+ *
+ * Blocks instantiating the same FMU share one unpacked copy, one parsed
+ * model description and one loaded library. FMUs are identified by the
+ * content hash of the .fmu file, the GUID is checked against other
+ * loaded FMUs to catch different binaries of one model.
+ * -------------------------------------------------------------------------*/
+
+typedef struct FMUShared {
+  FMU fmu;
+  char *tmpPath;                 /* Unpacked FMU */
+  unsigned long long hash;       /* FNV-1a of the .fmu file */
+  const char *guid;
+  int refcount;
+  struct FMUShared *next;
+} FMUShared;
+
+static FMUShared *sharedFMUs = NULL;
+
+static int hashFile(const char *fileName, unsigned long long *hash) {
+  unsigned char buf[4096];
+  unsigned long long h = 14695981039346656037ULL;
+  size_t n, i;
+  FILE *f = fopen(fileName, "rb");
+
+  if (!f) return 0;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    for (i = 0; i < n; i++) {
+      h ^= buf[i];
+      h *= 1099511628211ULL;
+    }
+  }
+  fclose(f);
+  *hash = h;
+  return 1;
+}
+
+FMU *acquireFMU(const char* fmuFileName) {
+  FMUShared *sh;
+  FMUShared *other;
+  unsigned long long hash;
+  char *basePath;
+  char *xmlPath;
+  char *dllPath;
+  const char *modelId;
+
+  if (!hashFile(fmuFileName, &hash)) {
+    printf("error: Could not read %s\n", fmuFileName);
+    exit(EXIT_FAILURE);
+  }
+
+  for (sh = sharedFMUs; sh; sh = sh->next) {
+    if (sh->hash == hash) {
+      sh->refcount++;
+      return &sh->fmu;
+    }
+  }
+
+  sh = (FMUShared *) calloc(1, sizeof(FMUShared));
+  if (!sh) exit(EXIT_FAILURE);
+  sh->hash = hash;
+
+  /* The hash keeps different files of the same name apart */
+
+  basePath = getTmpPath(fmuFileName);
+  sh->tmpPath = calloc(sizeof(char), strlen(basePath) + 18);
+  sprintf(sh->tmpPath, "%s-%016llx", basePath, hash);
+  free(basePath);
+  if (!unzip(fmuFileName, sh->tmpPath)) exit(EXIT_FAILURE);
+
+  xmlPath = calloc(sizeof(char), strlen(sh->tmpPath) + strlen(XML_FILE) + 2);
+  sprintf(xmlPath, "%s/%s", sh->tmpPath, XML_FILE);
+  sh->fmu.modelDescription = parse(xmlPath);
+  free(xmlPath);
+  if (!sh->fmu.modelDescription) exit(EXIT_FAILURE);
+
+  sh->guid = getAttributeValue((Element *)sh->fmu.modelDescription, att_guid);
+  for (other = sharedFMUs; other; other = other->next) {
+    if (sh->guid && other->guid && !strcmp(sh->guid, other->guid))
+      printf("warning: %s differs from an already loaded FMU with the same GUID\n",
+             fmuFileName);
+  }
+
+  modelId = getAttributeValue((Element *)getCoSimulation(sh->fmu.modelDescription),
+                              att_modelIdentifier);
+  dllPath = calloc(sizeof(char), strlen(sh->tmpPath) + strlen(DLL_DIR)
+                   + strlen(modelId) +  strlen(DLL_SUFFIX) + 3);
+  sprintf(dllPath, "%s/%s%s%s", sh->tmpPath, DLL_DIR, modelId, DLL_SUFFIX);
+  if (!loadDll(dllPath, &sh->fmu)) {
+    free(dllPath);
+    exit(EXIT_FAILURE);
+  }
+  free(dllPath);
+
+  sh->refcount = 1;
+  sh->next = sharedFMUs;
+  sharedFMUs = sh;
+  return &sh->fmu;
+}
+
+char *getSharedResourcesLocation(FMU *fmu) {
+  FMUShared *sh = (FMUShared *) fmu;
+  int len = snprintf(NULL, 0, "file:///%s/%s/", sh->tmpPath, RESOURCES_DIR) + 1;
+  char *resourcesLocation = (char *) calloc(sizeof(char), len);
+
+  snprintf(resourcesLocation, len, "file:///%s/%s/", sh->tmpPath, RESOURCES_DIR);
+  return resourcesLocation;
+}
+
+void releaseFMU(FMU *fmu) {
+  FMUShared *sh = (FMUShared *) fmu;
+  FMUShared **p;
+  char *cmd;
+
+  if (--sh->refcount > 0) return;
+
+  for (p = &sharedFMUs; *p; p = &(*p)->next) {
+    if (*p == sh) {
+      *p = sh->next;
+      break;
+    }
+  }
+
+  dlclose(sh->fmu.dllHandle);
+  freeModelDescription(sh->fmu.modelDescription);
+
+  cmd = (char *)calloc(15 + strlen(sh->tmpPath), sizeof(char));
+  sprintf(cmd, "rm -rf %s", sh->tmpPath);
+  system(cmd);
+  free(cmd);
+  free(sh->tmpPath);
+  free(sh);
+}
+
 void deleteUnzippedFiles(const char* fmuFileName) {
   char *fmuTempPath = getTmpPath(fmuFileName);
   char *cmd = (char *)calloc(15 + strlen(fmuTempPath), sizeof(char));
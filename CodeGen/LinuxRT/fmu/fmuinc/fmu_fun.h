@@ -8,4 +8,7 @@ char *getTempResourcesLocation(const char* fmuFileName);
 void *getAdr(int *success, HMODULE dllHandle, const char *functionName);
 void loadFMU(FMU * fmu, const char* fmuFileName);
 void deleteUnzippedFiles(const char* fmuFileName);
+FMU *acquireFMU(const char* fmuFileName);
+char *getSharedResourcesLocation(FMU *fmu);
+void releaseFMU(FMU *fmu);
 void fmuLogger(void *componentEnvironment, fmi2String instanceName, fmi2Status status, fmi2String category, fmi2String message, ...);
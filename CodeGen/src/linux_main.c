@@ -4,6 +4,10 @@
 #include <string.h>
 #include <signal.h>
 
+#ifdef PYSIM_REPLAY
+#include <iolog.h>
+#endif
+
 #define XNAME(x,y)  x##y
 #define NAME(x,y)   XNAME(x,y)
 
@@ -24,6 +28,11 @@ static int extclock = 0;
 static int wait = 0;
 double FinalTime = 0.0;
 
+#ifdef PYSIM_REPLAY
+extern const struct pysim_io_model NAME(MODEL, _io);
+static char *replay = NULL;
+#endif
+
 double get_run_time(void)
 {
   return(T);
@@ -34,6 +43,13 @@ double get_Tsamp(void)
   return(Tsamp);
 }
 
+/* Thread classes are handled by the LinuxRT main only */
+
+int set_thread_class(const char *name)
+{
+  return 0;
+}
+
 void endme(int n)
 {
   end = 1;
@@ -51,13 +67,16 @@ void print_usage(void)
 	 "  -e  external clock\n"
 	 "  -w  wait to start\n"
 	 "  -V  print version\n"
+#ifdef PYSIM_REPLAY
+	 "  -r <log> replay the device block outputs of a --io-record log\n"
+#endif
 	 "\n");
 }
 
 static void proc_opt(int argc, char *argv[])
 {
   int i;
-  while((i=getopt(argc,argv,"ef:hp:vVw"))!=-1){
+  while((i=getopt(argc,argv,"ef:hp:r:vVw"))!=-1){
     switch(i){
     case 'h':
       print_usage();
@@ -75,6 +94,11 @@ static void proc_opt(int argc, char *argv[])
     case 'w':
       wait = 1;
       break;
+#ifdef PYSIM_REPLAY
+    case 'r':
+      replay = optarg;
+      break;
+#endif
     case 'V':
       printf("Version %s\n",rtversion);
       exit(0);
@@ -102,6 +126,26 @@ int main(int argc,char** argv)
 
   T=0;
 
+#ifdef PYSIM_REPLAY
+  /* The steps are run on the logged times, as fast as possible */
+  if (replay == NULL) {
+    printf("Replay build, the log is given by -r\n");
+    exit(1);
+  }
+  if (pysim_io_replay_open(&NAME(MODEL, _io), replay) < 0)
+    exit(1);
+
+  NAME(MODEL,_init)();
+
+  while(!end && pysim_io_replay_next(&T)){
+    NAME(MODEL,_isr)(T);
+    if((FinalTime >0) && (T >= FinalTime)) break;
+  }
+  NAME(MODEL,_end)();
+  pysim_io_replay_close();
+  return(0);
+#endif
+
   NAME(MODEL,_init)();
 
   while(!end){
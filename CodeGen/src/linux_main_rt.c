@@ -1,5 +1,11 @@
+#define _GNU_SOURCE
 #include <platform.h>
 #include <pyblock.h>
+#include <blkinit.h>
+#include <flightrec.h>
+#include <iolog.h>
+#include <hotswap.h>
+#include <threadclass.h>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -13,6 +19,15 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <getopt.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <linux/gpio.h>
+#include <stdatomic.h>
+#include <malloc.h>
 
 #ifdef CG_WITH_IOPL
 #include <sys/io.h>
@@ -35,6 +50,15 @@ void canopen_synch(void);
 #define SHV_PASSWD_FLAG 1003
 #define SHV_PORT_FLAG   1004
 #define SHV_USER_FLAG   100
+#define RT_ENV_FLAG      1010
+#define RT_ENV_FILE_FLAG 1011
+#define INIT_TIMEOUT_FLAG 1012
+#define REC_FLAG         1013
+#define REC_RANGE_FLAG   1014
+#define IO_RECORD_FLAG   1015
+#define SWAP_FLAG        1016
+#define SWAP_BLEND_FLAG  1017
+#define SWAP_PROBATION_FLAG 1018
 
 static volatile int end = 0;
 static double T = 0.0;
@@ -45,18 +69,39 @@ static char rtversion[] = "0.9";
 static int prio = 99;
 static int verbose = 0;
 static int wait = 0;
-static int extclock = 0;
+static char *clockspec = "monotonic";
+static double init_timeout = 1.0;
+static double rec_seconds = 2.0;
+static char *rec_dir = ".";
+static char *rec_ranges[16];
+static int rec_nranges = 0;
+static char *io_record = NULL;
+static char *swap_module = NULL;
+static double swap_blend = 0.5;
+static double swap_probation = 5.0;
 double FinalTime = 0.0;
 
 static const struct option optargs[] =
 {
   {"benchmark", no_argument, 0, 'b'},
+  {"clock", required_argument, 0, 'c'},
   {"ext-clock", no_argument, 0, 'e'},
   {"final-time", required_argument, 0, 'f'},
   {"help", no_argument, 0, 'h'},
+  {"io-record", required_argument, 0, IO_RECORD_FLAG},
+  {"init-timeout", required_argument, 0, INIT_TIMEOUT_FLAG},
+  {"overrun", required_argument, 0, 'o'},
   {"prio", required_argument, 0, 'p'},
+  {"rec", required_argument, 0, REC_FLAG},
+  {"rec-range", required_argument, 0, REC_RANGE_FLAG},
+  {"rt-env", required_argument, 0, RT_ENV_FLAG},
+  {"rt-env-file", required_argument, 0, RT_ENV_FILE_FLAG},
+  {"swap", required_argument, 0, SWAP_FLAG},
+  {"swap-blend", required_argument, 0, SWAP_BLEND_FLAG},
+  {"swap-probation", required_argument, 0, SWAP_PROBATION_FLAG},
   {"verbose", no_argument, 0, 'v'},
   {"version", no_argument, 0, 'V'},
+  {"watchdog", required_argument, 0, 'W'},
 
   /* Let SHV parameters be only of the long type.
    * Let's keep basic letters reserved for stuff related more to the model.
@@ -95,6 +140,8 @@ struct pysim_platform_model_ctx NAME(MODEL, _pt_ctx);
 #ifdef CONF_SHV_USED
 static void shv_my_at_signlr(struct shv_con_ctx *ctx, enum shv_attention_reason r)
 {
+  (void) ctx;
+  (void) r;
 }
 #endif
 
@@ -109,113 +156,1098 @@ double get_Tsamp(void)
   return(Tsamp);
 }
 
+/* RT execution environment.
+ *
+ * The threads of the model belong to classes, each one with its
+ * scheduling policy, priority and CPUs:
+ *
+ * rt        the control loop
+ * watchdog  the step watchdog, above rt
+ * report    the event reporter
+ * com       communication threads (TCP, SHV)
+ * io        input threads of the blocks (serial, UDP, sockets)
+ * monitor   viewer processes started by the blocks (scope, led)
+ *
+ * A thread applies its class with set_thread_class(). The settings are
+ * given by --rt-env key=value or by lines of the same form in the
+ * --rt-env-file file, '#' starts a comment:
+ *
+ * <class>.policy = fifo | rr | other
+ * <class>.prio = <val>
+ * <class>.cpus = <list>              e.g. 0,2-3
+ * dma_latency = <us>                 held on /dev/cpu_dma_latency
+ * prefault_stack = <kB>              stack of the rt thread
+ * prefault_heap = <kB>               heap kept by malloc, never trimmed
+ * irq.<n> = <list>                   /proc/irq/<n>/smp_affinity_list
+ *
+ * Unset values keep the previous behaviour: rt runs SCHED_FIFO at the
+ * -p priority, com and io one below, watchdog one above. If rt.cpus is
+ * set the classes without cpus run on the other CPUs. What was applied
+ * is printed at the start.
+ */
+
+#define RT_CLASS_NUM    6
+#define RT_IRQ_MAX      16
+
+struct rt_class
+{
+  const char *name;
+  int policy;             /* -1 if not set */
+  int prio;               /* -1 if not set */
+  cpu_set_t cpus;
+  int cpus_set;
+};
+
+static struct rt_class rtclass[RT_CLASS_NUM] =
+{
+  {"rt", -1, -1, {{0}}, 0},
+  {"watchdog", -1, -1, {{0}}, 0},
+  {"report", -1, -1, {{0}}, 0},
+  {"com", -1, -1, {{0}}, 0},
+  {"io", -1, -1, {{0}}, 0},
+  {"monitor", -1, -1, {{0}}, 0},
+};
+
+static int dma_latency = -1;
+static int dma_latency_fd = -1;
+static long prefault_stack = 0;
+static long prefault_heap = 0;
+static int irq_num = 0;
+static int irq_list[RT_IRQ_MAX];
+static char *irq_cpus[RT_IRQ_MAX];
+
+static struct rt_class *find_class(const char *name, size_t len)
+{
+  int i;
+
+  for (i = 0; i < RT_CLASS_NUM; i++) {
+    if (strlen(rtclass[i].name) == len && !strncmp(rtclass[i].name, name, len))
+      return &rtclass[i];
+  }
+  return NULL;
+}
+
+static int parse_cpus(const char *list, cpu_set_t *set)
+{
+  char *s = strdup(list);
+  char *tok, *save;
+  int a, b, n;
+
+  CPU_ZERO(set);
+  for (tok = strtok_r(s, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+    n = sscanf(tok, "%d-%d", &a, &b);
+    if (n < 1 || a < 0 || a >= CPU_SETSIZE) {
+      free(s);
+      return -1;
+    }
+    if (n == 1)
+      b = a;
+    for (; a <= b && a < CPU_SETSIZE; a++)
+      CPU_SET(a, set);
+  }
+  free(s);
+  return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+static char *format_cpus(const cpu_set_t *set, char *buf, size_t len)
+{
+  int i, j, n = 0;
+
+  buf[0] = '\0';
+  for (i = 0; i < CPU_SETSIZE && n < (int) len; i++) {
+    if (!CPU_ISSET(i, set))
+      continue;
+    for (j = i; j + 1 < CPU_SETSIZE && CPU_ISSET(j + 1, set); j++)
+      ;
+    if (j > i)
+      n += snprintf(buf + n, len - n, "%s%d-%d", n ? "," : "", i, j);
+    else
+      n += snprintf(buf + n, len - n, "%s%d", n ? "," : "", i);
+    i = j;
+  }
+  return buf;
+}
+
+static char *trim(char *s)
+{
+  char *e;
+
+  while (*s == ' ' || *s == '\t')
+    s++;
+  e = s + strlen(s);
+  while (e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\n' || e[-1] == '\r'))
+    *--e = '\0';
+  return s;
+}
+
+static int rt_env_set(const char *setting)
+{
+  char *s = strdup(setting);
+  char *val = strchr(s, '=');
+  char *key, *dot;
+  struct rt_class *cls;
+  int ret = 0;
+
+  if (val == NULL) {
+    free(s);
+    return -1;
+  }
+  *val++ = '\0';
+  key = trim(s);
+  val = trim(val);
+  dot = strchr(key, '.');
+
+  if (!strcmp(key, "dma_latency")) {
+    dma_latency = atoi(val);
+  } else if (!strcmp(key, "prefault_stack")) {
+    prefault_stack = atol(val);
+  } else if (!strcmp(key, "prefault_heap")) {
+    prefault_heap = atol(val);
+  } else if (!strncmp(key, "irq.", 4) && irq_num < RT_IRQ_MAX) {
+    irq_list[irq_num] = atoi(key + 4);
+    irq_cpus[irq_num++] = strdup(val);
+  } else if (dot != NULL && (cls = find_class(key, dot - key)) != NULL) {
+    if (!strcmp(dot, ".prio")) {
+      cls->prio = atoi(val);
+      if (cls == &rtclass[0])
+        prio = cls->prio;
+    } else if (!strcmp(dot, ".policy")) {
+      if (!strcmp(val, "fifo"))
+        cls->policy = SCHED_FIFO;
+      else if (!strcmp(val, "rr"))
+        cls->policy = SCHED_RR;
+      else if (!strcmp(val, "other"))
+        cls->policy = SCHED_OTHER;
+      else
+        ret = -1;
+    } else if (!strcmp(dot, ".cpus")) {
+      ret = parse_cpus(val, &cls->cpus);
+      cls->cpus_set = ret == 0;
+    } else {
+      ret = -1;
+    }
+  } else {
+    ret = -1;
+  }
+
+  if (ret < 0)
+    fprintf(stderr, "Invalid RT environment setting: %s\n", setting);
+  free(s);
+  return ret;
+}
+
+static int rt_env_file(const char *fname)
+{
+  char line[256];
+  char *l, *c;
+  FILE *f = fopen(fname, "r");
+  int ret = 0;
+
+  if (f == NULL) {
+    perror(fname);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if ((c = strchr(line, '#')) != NULL)
+      *c = '\0';
+    l = trim(line);
+    if (*l != '\0' && rt_env_set(l) < 0)
+      ret = -1;
+  }
+  fclose(f);
+  return ret;
+}
+
+/* Defaults of the unset values, from -p and rt.cpus */
+
+static void rt_env_defaults(void)
+{
+  int max = sched_get_priority_max(SCHED_FIFO);
+  cpu_set_t all, others;
+  int i;
+
+  for (i = 0; i < RT_CLASS_NUM; i++) {
+    struct rt_class *cls = &rtclass[i];
+
+    if (!strcmp(cls->name, "rt")) {
+      if (cls->prio < 0)
+        cls->prio = prio;
+    } else if (!strcmp(cls->name, "watchdog")) {
+      if (cls->prio < 0 && prio >= 0)
+        cls->prio = prio < max ? prio + 1 : prio;
+    } else if (!strcmp(cls->name, "com") || !strcmp(cls->name, "io")) {
+      if (cls->prio < 0 && prio > 0)
+        cls->prio = prio - 1;
+    } else {
+      if (cls->policy < 0)
+        cls->policy = SCHED_OTHER;
+    }
+    if (cls->policy < 0)
+      cls->policy = cls->prio >= 0 ? SCHED_FIFO : SCHED_OTHER;
+    if (cls->policy == SCHED_OTHER)
+      cls->prio = 0;
+  }
+
+  if (!rtclass[0].cpus_set ||
+      sched_getaffinity(0, sizeof(all), &all) < 0)
+    return;
+  CPU_XOR(&others, &all, &rtclass[0].cpus);
+  CPU_AND(&others, &others, &all);
+  if (CPU_COUNT(&others) == 0)
+    return;
+  for (i = 1; i < RT_CLASS_NUM; i++) {
+    if (!rtclass[i].cpus_set) {
+      rtclass[i].cpus = others;
+      rtclass[i].cpus_set = 1;
+    }
+  }
+}
+
+/* Scheduling and CPUs of a class, for the calling thread. Called by the
+ * threads of the main and of the blocks, and by the viewer processes
+ * forked by the blocks. Unknown classes are handled as io.
+ */
+
+int set_thread_class(const char *name)
+{
+  struct rt_class *cls = find_class(name, strlen(name));
+  struct sched_param param;
+  int ret = 0;
+
+  if (cls == NULL)
+    cls = find_class("io", 2);
+
+  if (cls->prio >= 0 || cls->policy == SCHED_OTHER) {
+    param.sched_priority = cls->prio;
+    ret = pthread_setschedparam(pthread_self(), cls->policy, &param);
+    if (ret != 0)
+      fprintf(stderr, "%s thread: scheduling not set: %s\n", cls->name, strerror(ret));
+  }
+  if (cls->cpus_set && pthread_setaffinity_np(pthread_self(), sizeof(cls->cpus), &cls->cpus) != 0) {
+    fprintf(stderr, "%s thread: CPU affinity not set\n", cls->name);
+    ret = -1;
+  }
+  return ret;
+}
+
+/* Settings of the process, before the threads start */
+
+static void rt_env_apply(void)
+{
+  static const char *policies[] = {"other", "fifo", "rr"};
+  char path[64], buf[256];
+  int32_t lat;
+  FILE *f;
+  int i;
+
+  puts("RT environment:");
+  for (i = 0; i < RT_CLASS_NUM; i++) {
+    struct rt_class *cls = &rtclass[i];
+
+    printf("  %-8s %-5s prio %2d cpus %s\n", cls->name,
+           cls->policy >= 0 && cls->policy <= SCHED_RR ? policies[cls->policy] : "?",
+           cls->prio, cls->cpus_set ? format_cpus(&cls->cpus, buf, sizeof(buf)) : "all");
+  }
+
+  if (dma_latency >= 0) {
+    lat = dma_latency;
+    dma_latency_fd = open("/dev/cpu_dma_latency", O_WRONLY | O_CLOEXEC);
+    if (dma_latency_fd < 0 || write(dma_latency_fd, &lat, sizeof(lat)) != sizeof(lat)) {
+      printf("  DMA latency %d us: %s\n", dma_latency, strerror(errno));
+    } else {
+      printf("  DMA latency %d us\n", dma_latency);
+    }
+  }
+
+  for (i = 0; i < irq_num; i++) {
+    snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irq_list[i]);
+    f = fopen(path, "w");
+    if (f == NULL || fprintf(f, "%s\n", irq_cpus[i]) < 0 || fclose(f) != 0) {
+      printf("  IRQ %d cpus %s: %s\n", irq_list[i], irq_cpus[i], strerror(errno));
+      if (f != NULL)
+        fclose(f);
+    } else {
+      printf("  IRQ %d cpus %s\n", irq_list[i], irq_cpus[i]);
+    }
+  }
+
+  if (prefault_heap > 0) {
+    /* Keep the prefaulted heap in the process */
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    printf("  Heap prefault %ld kB\n", prefault_heap);
+  }
+  if (prefault_stack > 0) {
+    printf("  Stack prefault %ld kB\n", prefault_stack);
+  }
+}
+
+static void __attribute__((noinline)) touch_stack(long kb)
+{
+  volatile char buf[kb * 1024];
+  long i;
+
+  for (i = 0; i < kb * 1024; i += 4096)
+    buf[i] = 0;
+  (void) buf[0];
+}
+
+/* Memory of the rt thread, after mlockall */
+
+static void rt_prefault(void)
+{
+  char *p;
+  long i;
+
+  if (prefault_stack > 0)
+    touch_stack(prefault_stack);
+  if (prefault_heap > 0) {
+    p = malloc(prefault_heap * 1024);
+    if (p != NULL) {
+      for (i = 0; i < prefault_heap * 1024; i += 4096)
+        p[i] = 0;
+      free(p);
+    }
+  }
+}
+
 int get_priority_for_com(void)
 {
-  if (prio < 0)
+  struct rt_class *cls = find_class("com", 3);
+
+  if (cls->policy == SCHED_OTHER || cls->prio <= 0)
     {
       return -1;
     }
   else
     {
-      return prio - 1;
+      return cls->prio;
+    }
+}
+
+/* Clock sources of the control loop.
+ *
+ * monotonic            clock_nanosleep on CLOCK_MONOTONIC (default)
+ * timerfd              periodic timerfd, the kernel counts the missed ticks
+ * ptp[:/dev/ptpN]      ticks on the multiples of the period in the time of
+ *                      a PTP hardware clock, models on machines synchronized
+ *                      by ptp4l run in phase
+ * ext[:event]          a tick for each rt_clock_trigger() call
+ * ext:gpio:chip:line[:falling|both]
+ *                      edges of a GPIO line, chip is /dev/gpiochipN
+ * ext:uio:/dev/uioN    interrupts of an UIO device, e.g. end of conversion
+ *
+ * The times of the ticks are in ns, the model time is the time of the
+ * current tick from the start. An external tick is timed when it is
+ * received.
+ */
+
+#define RT_CLOCK_MONOTONIC  0
+#define RT_CLOCK_TIMERFD    1
+#define RT_CLOCK_PTP        2
+#define RT_CLOCK_EVENT      3
+#define RT_CLOCK_GPIO       4
+#define RT_CLOCK_UIO        5
+
+#define EXT_CLOCK_TIMEOUT   100    /* ms, to check for the end while waiting */
+
+#define FD_TO_CLOCKID(fd)   ((~(clockid_t) (fd) << 3) | 3)
+
+struct rt_clock
+{
+  int kind;
+  int fd;                  /* timerfd, PTP device, eventfd, GPIO or UIO fd */
+  clockid_t clkid;         /* Clock of the tick times */
+  int64_t period;          /* ns */
+  int64_t t0;              /* First tick */
+  int64_t tick;            /* Current tick */
+  int64_t late;            /* ns the last tick was late (monotonic) */
+  unsigned long skipped;   /* Ticks missed at the last wait */
+  unsigned long missed;    /* All the missed ticks */
+  uint32_t irqcount;       /* Last UIO interrupt count */
+};
+
+static struct rt_clock rtclk;
+static volatile int trigger_fd = -1;
+
+static inline int64_t ts2ns(struct timespec ts)
+{
+  return (int64_t) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static inline struct timespec ns2ts(int64_t ns)
+{
+  struct timespec ts;
+
+  ts.tv_sec = ns / NSEC_PER_SEC;
+  ts.tv_nsec = ns % NSEC_PER_SEC;
+  return ts;
+}
+
+static inline int64_t clock_ns(clockid_t clkid)
+{
+  struct timespec ts;
+
+  clock_gettime(clkid, &ts);
+  return ts2ns(ts);
+}
+
+/* Tick of an external source, to be called by the block or the thread
+ * which sees the event, with the ext or ext:event clock.
+ */
+
+int rt_clock_trigger(void)
+{
+  uint64_t one = 1;
+
+  if (trigger_fd < 0)
+    return -1;
+  return write(trigger_fd, &one, sizeof(one)) == sizeof(one) ? 0 : -1;
+}
+
+static int gpio_open(char *args)
+{
+  struct gpioevent_request req;
+  char *chip = strtok(args, ":");
+  char *line = strtok(NULL, ":");
+  char *edge = strtok(NULL, ":");
+  int fd, ret;
+
+  if (chip == NULL || line == NULL) {
+    fprintf(stderr, "GPIO clock needs ext:gpio:chip:line\n");
+    return -1;
+  }
+
+  memset(&req, 0, sizeof(req));
+  req.lineoffset = atoi(line);
+  req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+  req.eventflags = GPIOEVENT_REQUEST_RISING_EDGE;
+  if (edge != NULL && !strcmp(edge, "falling"))
+    req.eventflags = GPIOEVENT_REQUEST_FALLING_EDGE;
+  else if (edge != NULL && !strcmp(edge, "both"))
+    req.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+  strncpy(req.consumer_label, "pysimCoder clock", sizeof(req.consumer_label) - 1);
+
+  fd = open(chip, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    perror(chip);
+    return -1;
+  }
+  ret = ioctl(fd, GPIO_GET_LINEEVENT_IOCTL, &req);
+  close(fd);
+  if (ret < 0) {
+    perror("GPIO_GET_LINEEVENT_IOCTL");
+    return -1;
+  }
+  return req.fd;
+}
+
+static int rt_clock_open(struct rt_clock *clk, const char *spec)
+{
+  char *s = strdup(spec);
+  char *arg = strchr(s, ':');
+  int ret = 0;
+
+  if (arg != NULL)
+    *arg++ = '\0';
+
+  memset(clk, 0, sizeof(*clk));
+  clk->fd = -1;
+  clk->clkid = CLOCK_MONOTONIC;
+
+  if (!strcmp(s, "monotonic")) {
+    clk->kind = RT_CLOCK_MONOTONIC;
+  } else if (!strcmp(s, "timerfd")) {
+    clk->kind = RT_CLOCK_TIMERFD;
+    clk->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  } else if (!strcmp(s, "ptp")) {
+    clk->kind = RT_CLOCK_PTP;
+    clk->fd = open(arg != NULL ? arg : "/dev/ptp0", O_RDONLY | O_CLOEXEC);
+    clk->clkid = FD_TO_CLOCKID(clk->fd);
+  } else if (!strcmp(s, "ext") && (arg == NULL || !strcmp(arg, "event"))) {
+    clk->kind = RT_CLOCK_EVENT;
+    clk->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    trigger_fd = clk->fd;
+  } else if (!strcmp(s, "ext") && !strncmp(arg, "gpio:", 5)) {
+    clk->kind = RT_CLOCK_GPIO;
+    clk->fd = gpio_open(arg + 5);
+  } else if (!strcmp(s, "ext") && !strncmp(arg, "uio:", 4)) {
+    clk->kind = RT_CLOCK_UIO;
+    clk->fd = open(arg + 4, O_RDWR | O_CLOEXEC);
+  } else {
+    fprintf(stderr, "Unknown clock source %s\n", spec);
+    ret = -1;
+  }
+
+  if (ret == 0 && clk->kind != RT_CLOCK_MONOTONIC && clk->fd < 0) {
+    fprintf(stderr, "Clock source %s: %s\n", spec, strerror(errno));
+    ret = -1;
+  }
+  free(s);
+  return ret;
+}
+
+static void rt_clock_close(struct rt_clock *clk)
+{
+  if (clk->kind == RT_CLOCK_EVENT)
+    trigger_fd = -1;
+  if (clk->fd >= 0)
+    close(clk->fd);
+  clk->fd = -1;
+}
+
+/* Monotonic time of a deadline in the PTP clock, read between two reads
+ * of the monotonic clock. Computed again at each tick, so the drift
+ * between the two clocks does not add up.
+ */
+
+static int64_t ptp_to_monotonic(struct rt_clock *clk, int64_t t, int64_t *now)
+{
+  int64_t m1, m2, p;
+
+  m1 = clock_ns(CLOCK_MONOTONIC);
+  p = clock_ns(clk->clkid);
+  m2 = clock_ns(CLOCK_MONOTONIC);
+  *now = p;
+  return m1 + (m2 - m1) / 2 + (t - p);
+}
+
+static int rt_clock_start(struct rt_clock *clk, double tsamp)
+{
+  struct itimerspec its;
+  uint32_t enable = 1;
+  int64_t now;
+
+  clk->period = (int64_t)(1e9 * tsamp);
+  clk->missed = 0;
+  clk->skipped = 0;
+  clk->late = 0;
+
+  switch (clk->kind) {
+  case RT_CLOCK_TIMERFD:
+    clk->tick = clock_ns(CLOCK_MONOTONIC);
+    its.it_value = ns2ts(clk->tick + clk->period);
+    its.it_interval = ns2ts(clk->period);
+    if (timerfd_settime(clk->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+      return -1;
+    break;
+  case RT_CLOCK_PTP:
+    /* Start on the next multiple of the period in the PTP time scale */
+    now = clock_ns(clk->clkid);
+    if (now < 0 || clk->period <= 0)
+      return -1;
+    clk->tick = (now / clk->period + 2) * clk->period;
+    now = ptp_to_monotonic(clk, clk->tick, &now);
+    {
+      struct timespec ts = ns2ts(now);
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    break;
+  case RT_CLOCK_UIO:
+    if (read(clk->fd, &clk->irqcount, sizeof(clk->irqcount)) != sizeof(clk->irqcount))
+      clk->irqcount = 0;
+    if (write(clk->fd, &enable, sizeof(enable)) != sizeof(enable))
+      return -1;
+    clk->tick = clock_ns(CLOCK_MONOTONIC);
+    break;
+  default:
+    clk->tick = clock_ns(CLOCK_MONOTONIC);
+    break;
+  }
+  clk->t0 = clk->tick;
+  return 0;
+}
+
+/* Time of the current tick, from the start */
+
+static inline double rt_clock_time(struct rt_clock *clk)
+{
+  return 1e-9 * (clk->tick - clk->t0);
+}
+
+static int ext_wait(struct rt_clock *clk)
+{
+  struct pollfd pfd = { .fd = clk->fd, .events = POLLIN };
+  struct gpioevent_data ev[16];
+  uint64_t count;
+  uint32_t irqcount, enable = 1;
+  ssize_t n;
+  int ret;
+
+  ret = poll(&pfd, 1, EXT_CLOCK_TIMEOUT);
+  if (ret <= 0)
+    return ret < 0 && errno != EINTR ? -1 : 0;
+
+  switch (clk->kind) {
+  case RT_CLOCK_EVENT:
+    if (read(clk->fd, &count, sizeof(count)) != sizeof(count))
+      return errno == EAGAIN ? 0 : -1;
+    clk->skipped = count - 1;
+    break;
+  case RT_CLOCK_GPIO:
+    n = read(clk->fd, ev, sizeof(ev));
+    if (n < (ssize_t) sizeof(ev[0]))
+      return -1;
+    clk->skipped = n / sizeof(ev[0]) - 1;
+    break;
+  case RT_CLOCK_UIO:
+    if (read(clk->fd, &irqcount, sizeof(irqcount)) != sizeof(irqcount))
+      return -1;
+    clk->skipped = irqcount - clk->irqcount - 1;
+    clk->irqcount = irqcount;
+    if (write(clk->fd, &enable, sizeof(enable)) != sizeof(enable))
+      return -1;
+    break;
+  }
+  clk->tick = clock_ns(CLOCK_MONOTONIC);
+  return 1;
+}
+
+/* Wait for the next tick. Returns 1 on a tick, 0 if an external source
+ * gave none for EXT_CLOCK_TIMEOUT and -1 on error.
+ *
+ * The periodic sources stay on their grid: after an overrun the tick is
+ * the last one already due, late is how late the deadline was missed and
+ * skipped the number of ticks between, which were not run.
+ */
+
+static int rt_clock_wait(struct rt_clock *clk)
+{
+  struct timespec ts;
+  uint64_t count;
+  int64_t next, now;
+  int ret;
+
+  clk->skipped = 0;
+  clk->late = 0;
+  next = clk->tick + clk->period;
+
+  switch (clk->kind) {
+  case RT_CLOCK_MONOTONIC:
+    now = clock_ns(CLOCK_MONOTONIC);
+    if (now > next) {
+      clk->late = now - next;
+      clk->skipped = clk->late / clk->period;
+      next += clk->skipped * clk->period;
+    } else {
+      ts = ns2ts(next);
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    clk->tick = next;
+    break;
+
+  case RT_CLOCK_TIMERFD:
+    now = clock_ns(CLOCK_MONOTONIC);
+    if (now > next)
+      clk->late = now - next;
+    do {
+      ret = read(clk->fd, &count, sizeof(count));
+    } while (ret < 0 && errno == EINTR);
+    if (ret != sizeof(count))
+      return -1;
+    clk->tick += count * clk->period;
+    clk->skipped = count - 1;
+    break;
+
+  case RT_CLOCK_PTP:
+    ts = ns2ts(ptp_to_monotonic(clk, next, &now));
+    if (now > next) {
+      clk->late = now - next;
+      clk->skipped = clk->late / clk->period;
+      next += clk->skipped * clk->period;
+    } else {
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
     }
+    clk->tick = next;
+    break;
+
+  default:
+    ret = ext_wait(clk);
+    if (ret <= 0)
+      return ret;
+    break;
+  }
+  clk->missed += clk->skipped;
+  return 1;
+}
+
+/* Events of the control loop.
+ *
+ * The RT thread does not print, it puts the events in a single producer,
+ * single consumer queue and the reporter thread prints them. If the
+ * queue is full the event is only counted.
+ */
+
+#define RT_EV_OVERRUN     1   /* value: ns late, arg: ticks skipped */
+#define RT_EV_CATCHUP     2   /* arg: ticks run late */
+#define RT_EV_DEGRADED    3   /* arg: 1 entering, 0 leaving */
+#define RT_EV_SAFESTOP    4
+#define RT_EV_SWAP        5   /* arg: PYSIM_SWAP_SWITCHED or PYSIM_SWAP_ROLLBACK */
+
+#define RT_EVENT_QLEN     256   /* Power of two */
+#define REPORT_PERIOD     50    /* ms */
+
+struct rt_event
+{
+  int type;
+  double t;               /* Model time */
+  int64_t value;
+  unsigned long arg;
+};
+
+static struct rt_event evq[RT_EVENT_QLEN];
+static atomic_uint evq_head;      /* Written by the RT thread only */
+static atomic_uint evq_tail;      /* Written by the reporter only */
+static atomic_ulong evq_lost;
+static atomic_int report_end;
+
+static void rt_event(int type, int64_t value, unsigned long arg)
+{
+  unsigned int head = atomic_load_explicit(&evq_head, memory_order_relaxed);
+  unsigned int tail = atomic_load_explicit(&evq_tail, memory_order_acquire);
+  struct rt_event *ev;
+
+  if (head - tail >= RT_EVENT_QLEN) {
+    atomic_fetch_add_explicit(&evq_lost, 1, memory_order_relaxed);
+    return;
+  }
+  ev = &evq[head % RT_EVENT_QLEN];
+  ev->type = type;
+  ev->t = T;
+  ev->value = value;
+  ev->arg = arg;
+  atomic_store_explicit(&evq_head, head + 1, memory_order_release);
 }
 
-static inline void tsnorm(struct timespec *ts)
+static void print_event(const struct rt_event *ev)
 {
-  while (ts->tv_nsec >= NSEC_PER_SEC) {
-    ts->tv_nsec -= NSEC_PER_SEC;
-    ts->tv_sec++;
+  switch (ev->type) {
+  case RT_EV_OVERRUN:
+    fprintf(stderr, "T=%.6f Base rate overrun by %ld us, %lu ticks missed\n",
+            ev->t, (long)(ev->value / 1000), ev->arg);
+    break;
+  case RT_EV_CATCHUP:
+    fprintf(stderr, "T=%.6f %lu ticks run late\n", ev->t, ev->arg);
+    break;
+  case RT_EV_DEGRADED:
+    fprintf(stderr, "T=%.6f %s degraded mode\n", ev->t, ev->arg ? "Entering" : "Leaving");
+    break;
+  case RT_EV_SAFESTOP:
+    fprintf(stderr, "T=%.6f Overrun, safe stop\n", ev->t);
+    break;
+  case RT_EV_SWAP:
+    fprintf(stderr, "T=%.6f %s\n", ev->t, ev->arg == PYSIM_SWAP_SWITCHED ?
+            "Switched to the new model version" : "Overrun of the new model version, rolled back");
+    break;
   }
 }
 
-static inline double calcdiff(struct timespec t1, struct timespec t2)
+static void *reporter(void *p)
 {
-  long diff;
-  diff = USEC_PER_SEC * ((long) t1.tv_sec - (long) t2.tv_sec);
-  diff += ((int) t1.tv_nsec - (int) t2.tv_nsec) / 1000;
-  return (1e-6*diff);
+  struct timespec ts = ns2ts((int64_t) REPORT_PERIOD * 1000000);
+  unsigned int head, tail;
+  unsigned long lost, reported = 0;
+  int last;
+
+  (void) p;
+  set_thread_class("report");
+  do {
+    last = atomic_load(&report_end);
+    head = atomic_load_explicit(&evq_head, memory_order_acquire);
+    tail = atomic_load_explicit(&evq_tail, memory_order_relaxed);
+    while (tail != head) {
+      print_event(&evq[tail % RT_EVENT_QLEN]);
+      tail++;
+      atomic_store_explicit(&evq_tail, tail, memory_order_release);
+    }
+    lost = atomic_load_explicit(&evq_lost, memory_order_relaxed);
+    if (lost != reported) {
+      fprintf(stderr, "%lu events lost\n", lost - reported);
+      reported = lost;
+    }
+    if (!last)
+      nanosleep(&ts, NULL);
+  } while (!last);
+  return NULL;
 }
 
+/* Watchdog of the model step, off unless -W is given.
+ *
+ * The RT thread stores the start time of each _isr call. If one lasts
+ * more than the watchdog timeout the loop is asked to stop, so the end
+ * functions set the outputs to their safe values if the step returns.
+ * If it is still in the same step after one more timeout the model is
+ * hung and the process exits with status 3. The end functions cannot
+ * run beside the hung step, the outputs then keep their last values
+ * and the hardware has to bring them to a safe state on its own.
+ */
+
+static int watchdog_ms = 0;
+static atomic_llong isr_start;    /* Start of the running step, 0 if none */
+
+static void *watchdog(void *p)
+{
+  struct pysim_platform_model_ctx *mctx = (struct pysim_platform_model_ctx*) p;
+  int64_t timeout = (int64_t) watchdog_ms * 1000000;
+  struct timespec ts = ns2ts(timeout / 4);
+  struct timespec tw = ns2ts(timeout);
+  int64_t start;
+
+  set_thread_class("watchdog");
+  while (!end) {
+    nanosleep(&ts, NULL);
+    start = atomic_load(&isr_start);
+    if (start == 0 || clock_ns(CLOCK_MONOTONIC) - start < timeout)
+      continue;
+
+    fprintf(stderr, "Watchdog: model step running for more than %d ms, stopping\n",
+            watchdog_ms);
+    pysim_rec_trigger(PYSIM_REC_WATCHDOG);
+    end = 1;
+    mctx->ctrlloopend = 1;
+    nanosleep(&tw, NULL);
+    if (atomic_load(&isr_start) == start) {
+      fprintf(stderr, "Watchdog: model step hung, exit\n");
+      _exit(3);
+    }
+  }
+  return NULL;
+}
+
+/* Overrun policies
+ *
+ * skip       the missed ticks are not run, the loop goes on with the
+ *            last tick due, on the same time grid (default)
+ * catchup:N  up to N missed ticks are run back to back, with their own
+ *            times, before the current one, the others are skipped
+ * degrade    as skip, and the non-critical blocks (monitoring sinks) are
+ *            not run until DEGRADE_HOLD s pass without overrun
+ * stop       the loop ends at the first overrun, the end functions of
+ *            the blocks set the outputs to their safe values and the
+ *            process exits with status 2
+ */
+
+#define OVR_SKIP      0
+#define OVR_CATCHUP   1
+#define OVR_DEGRADE   2
+#define OVR_STOP      3
+
+#define CATCHUP_BURST 4
+#define DEGRADE_HOLD  1.0
+
+extern const struct pysim_io_model NAME(MODEL, _io);
+extern const struct pysim_swap_model NAME(MODEL, _swap);
+
+/* Running version of the model, it changes only between two samples
+ * (hotswap.h). The flight recorder follows it, the I/O log samples the
+ * version it was opened for. */
+
+static const struct pysim_swap_model *mdl = &NAME(MODEL, _swap);
+static const struct pysim_swap_model *io_mdl;
+
+static int overrun_policy = OVR_SKIP;
+static unsigned long catchup_burst = CATCHUP_BURST;
+static int exitcode = 0;
+
+static int parse_overrun(const char *arg)
+{
+  if (!strcmp(arg, "skip")) {
+    overrun_policy = OVR_SKIP;
+  } else if (!strncmp(arg, "catchup", 7) && (arg[7] == '\0' || arg[7] == ':')) {
+    overrun_policy = OVR_CATCHUP;
+    if (arg[7] == ':')
+      catchup_burst = atoi(arg + 8);
+  } else if (!strcmp(arg, "degrade")) {
+    overrun_policy = OVR_DEGRADE;
+  } else if (!strcmp(arg, "stop")) {
+    overrun_policy = OVR_STOP;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+static inline void model_step(double t)
+{
+  T = t;
+  atomic_store_explicit(&isr_start, clock_ns(CLOCK_MONOTONIC), memory_order_relaxed);
+  mdl->isr(T);
+  atomic_store_explicit(&isr_start, 0, memory_order_relaxed);
+  pysim_rec_sample(T);
+  if (io_mdl == mdl)
+    pysim_io_record(T);
+
+#ifdef CANOPEN
+  canopen_synch();
+#endif
+}
+
+/* Returns 1 if the loop has to stop */
+
+static int overrun(struct rt_clock *clk, double *lastovr)
+{
+  unsigned long n;
+  double t = rt_clock_time(clk);
+
+  if (clk->late <= 0 && clk->skipped == 0) {
+    if (*mdl->degraded && t - *lastovr >= DEGRADE_HOLD) {
+      *mdl->degraded = 0;
+      rt_event(RT_EV_DEGRADED, 0, 0);
+    }
+    return 0;
+  }
+
+  *lastovr = t;
+  rt_event(RT_EV_OVERRUN, clk->late, clk->skipped);
+  pysim_rec_trigger(PYSIM_REC_OVERRUN);
+
+  switch (overrun_policy) {
+  case OVR_CATCHUP:
+    n = clk->skipped < catchup_burst ? clk->skipped : catchup_burst;
+    if (n > 0) {
+      clk->missed -= n;
+      rt_event(RT_EV_CATCHUP, 0, n);
+    }
+    for (; n > 0; n--) {
+      model_step(t - n * Tsamp);
+    }
+    break;
+  case OVR_DEGRADE:
+    if (!*mdl->degraded) {
+      *mdl->degraded = 1;
+      rt_event(RT_EV_DEGRADED, 0, 1);
+    }
+    break;
+  case OVR_STOP:
+    rt_event(RT_EV_SAFESTOP, 0, 0);
+    exitcode = 2;
+    return 1;
+  }
+  return 0;
+}
+
+#ifdef CONF_SHV_USED
+extern struct pysim_model_ctx NAME(MODEL, _ctx);
+
+static void rec_command(struct pysim_platform_model_ctx *ctx)
+{
+  (void) ctx;
+  pysim_rec_trigger(PYSIM_REC_COMMAND);
+}
+#endif
+
 static void *rt_task(void *p)
 {
-  struct timespec t_next, t_current, t_isr, T0;
-  struct sched_param param;
   struct pysim_platform_model_ctx *mctx = (struct pysim_platform_model_ctx*) p;
+  double lastovr;
+  int ret, late;
   mctx->com_inited = false;
 
-  if (prio >= 0) {
-    param.sched_priority = prio;
-    if(sched_setscheduler(0, SCHED_FIFO, &param)==-1) {
-      perror("sched_setscheduler failed");
-      exit(-1);
-    }
+  if (set_thread_class("rt") != 0 && prio >= 0) {
+    fprintf(stderr, "RT scheduling failed\n");
+    exit(-1);
   }
 
   mlockall(MCL_CURRENT | MCL_FUTURE);
+  rt_prefault();
 
-  while (!end) {
-    Tsamp = NAME(MODEL,_get_tsamp)();
+  if (rt_clock_open(&rtclk, clockspec) < 0) {
+    exit(1);
+  }
+
+#ifndef PYSIM_NO_SWAP
+  pysim_swap_setup(&NAME(MODEL, _swap), swap_module, swap_blend, swap_probation);
+  mdl = pysim_swap_model();
+#endif
+  io_mdl = mdl;
 
-    t_isr.tv_sec =  0L;
-    t_isr.tv_nsec = (long)(1e9*Tsamp);
-    tsnorm(&t_isr);
+  if (pysim_rec_open(mdl->rec, mdl->get_tsamp(), rec_seconds, rec_dir) < 0)
+    fprintf(stderr, "Flight recorder: out of memory, running without it\n");
+  for (ret = 0; ret < rec_nranges; ret++) {
+    if (pysim_rec_range(rec_ranges[ret]) < 0)
+      exit(1);
+  }
+  if (io_record != NULL &&
+      pysim_io_record_open(&NAME(MODEL, _io), mdl->get_tsamp(), io_record) < 0) {
+    exit(1);
+  }
+
+  while (!end) {
+    Tsamp = mdl->get_tsamp();
 
     T=0;
 
-    NAME(MODEL,_init)();
+    mdl->init();
 
 #ifdef CONF_SHV_USED
     if (!mctx->com_inited) {
+      NAME(MODEL, _ctx).pt_ops.recdump = rec_command;
       if (NAME(MODEL, _com_init)(shv_my_at_signlr) == 0) {
         mctx->com_inited = true;
       }
     }
 #endif
-    /* Wait for connections a bit (so the first samples are not delayed) */
-    usleep(1000 * 1000);
+    /* Wait for the blocks still connecting (so the first samples are not
+     * lost), a fixed time if not all of them report their readiness */
+    if (pysim_init_settle())
+      usleep(1000 * 1000);
+    if (pysim_init_wait(init_timeout) > 0)
+      printf("Init timeout, starting without the blocks not ready\n");
+    pysim_init_report();
 #ifdef CANOPEN
     canopen_synch();
 #endif
 
-    /* get current time */
-    clock_gettime(CLOCK_MONOTONIC,&t_current);
-    T0 = t_current;
+    if (rt_clock_start(&rtclk, Tsamp) < 0) {
+      perror("Clock start failed");
+      end = 1;
+    }
+
+    lastovr = 0.0;
+    *mdl->degraded = 0;
 
     mctx->running_state = PYSIM_MODEL_CTRLLOOP_RUNNING;
     puts("CTRLLOOP START");
-    while (!mctx->ctrlloopend){
+    while (!mctx->ctrlloopend && !end){
 
       /* periodic task */
-      T = calcdiff(t_current,T0);
-      NAME(MODEL,_isr)(T);
-
-#ifdef CANOPEN
-      canopen_synch();
-#endif
+      model_step(rt_clock_time(&rtclk));
 
       if((FinalTime >0) && (T >= FinalTime)) {
         end = 1;
         break;
       }
 
-      t_next.tv_sec = t_current.tv_sec + t_isr.tv_sec;
-      t_next.tv_nsec = t_current.tv_nsec + t_isr.tv_nsec;
-      tsnorm(&t_next);
+      while ((ret = rt_clock_wait(&rtclk)) == 0 && !mctx->ctrlloopend && !end)
+        ;
+      if (ret < 0) {
+        perror("Clock wait failed");
+        end = 1;
+        break;
+      }
 
       /* Check if Overrun */
-      clock_gettime(CLOCK_MONOTONIC,&t_current);
-      if (t_current.tv_sec > t_next.tv_sec ||
-    (t_current.tv_sec == t_next.tv_sec && t_current.tv_nsec > t_next.tv_nsec)) {
-        int usec = (t_current.tv_sec - t_next.tv_sec) * 1000000 + (t_current.tv_nsec -
-                   t_next.tv_nsec)/1000;
-        fprintf(stderr, "Base rate overrun by %d us\n", usec);
-        t_next= t_current;
+      late = rtclk.late > 0 || rtclk.skipped > 0;
+      if (overrun(&rtclk, &lastovr)) {
+        end = 1;
+        break;
+      }
+
+#ifndef PYSIM_NO_SWAP
+      /* A new version of the model takes over at the sample boundary */
+      ret = pysim_swap_sample(late);
+      if (ret != PYSIM_SWAP_NONE) {
+        mdl = pysim_swap_model();
+        rt_event(RT_EV_SWAP, 0, ret);
       }
-      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t_next, NULL);
-      t_current = t_next;
+#else
+      (void) late;
+#endif
     }
-    NAME(MODEL,_end)();
+#ifndef PYSIM_NO_SWAP
+    pysim_swap_settle();
+#endif
+    mdl->end();
     mctx->running_state = PYSIM_MODEL_CTRLLOOP_NOTRUNNING;
     if (end) {
       break;
@@ -231,33 +1263,93 @@ static void *rt_task(void *p)
     NAME(MODEL, _com_end)();
   }
 #endif
+  if (rtclk.missed > 0) {
+    fprintf(stderr, "%lu ticks missed\n", rtclk.missed);
+  }
+#ifndef PYSIM_NO_SWAP
+  pysim_swap_close();
+#endif
+  pysim_rec_close();
+  pysim_io_record_close();
+  rt_clock_close(&rtclk);
   pthread_exit(0);
 }
 
 void endme(int n)
 {
+  (void) n;
   end = 1;
   NAME(MODEL, _pt_ctx).ctrlloopend = 1;
 }
 
+static void recme(int n)
+{
+  (void) n;
+  pysim_rec_trigger(PYSIM_REC_SIGNAL);
+}
+
+#ifndef PYSIM_NO_SWAP
+static void swapme(int n)
+{
+  (void) n;
+  pysim_swap_request();
+}
+#endif
+
 static void print_usage(void)
 {
   puts(
     "\nUsage:  'RT-model-name' [OPTIONS]\n"
     "\n"
     "OPTIONS:\n"
-    "  -e --ext-clock: external clock (what is this actually for?)\n"
+    "  -c --clock <source>: clock of the control loop\n"
+    "     monotonic: sleep on CLOCK_MONOTONIC (default)\n"
+    "     timerfd: periodic timerfd\n"
+    "     ptp[:/dev/ptpN]: period aligned to a PTP hardware clock\n"
+    "     ext[:event]: a tick for each rt_clock_trigger() of a block\n"
+    "     ext:gpio:/dev/gpiochipN:line[:falling|both]: GPIO edges\n"
+    "     ext:uio:/dev/uioN: UIO device interrupts\n"
+    "  -e --ext-clock: external clock, same as --clock ext\n"
     "  -f --final-time <val> set model's final time to val\n"
     "  -h --help: print usage\n"
+    " --init-timeout <s>: wait at most s for the blocks to connect (default 1),\n"
+    "     models with blocks not reporting it wait 1 s before\n"
+    " --io-record <file>: log the device block outputs for a replay build\n"
+    "  -o --overrun <policy>: what to do when a step misses its deadline\n"
+    "     skip: do not run the missed ticks, keep the time grid (default)\n"
+    "     catchup[:N]: run up to N (default " STRIFY(CATCHUP_BURST) ") missed ticks at once\n"
+    "     degrade: skip, and do not run the monitoring blocks until\n"
+    "              no overrun for " STRIFY(DEGRADE_HOLD) " s\n"
+    "     stop: end the model, outputs to their end values, exit status 2\n"
     "  -p --prio <val>: set rt task priority to val (default 99)\n"
+    " --rec <s>[:<dir>]: flight recorder length (default 2, 0 disables), the\n"
+    "     last s (at most 4 MiB) of all signals are written to dir (default .) on overrun,\n"
+    "     watchdog stop, range trigger, SHV dumprec or SIGUSR1\n"
+    " --rec-range <signal>=<min>:<max>: dump when the signal leaves the range,\n"
+    "     a signal is <block>.y<n>, min or max may be empty\n"
+    " --rt-env <key>=<val>: RT environment setting, see below\n"
+    " --rt-env-file <file>: RT environment settings, one per line\n"
+    " --swap <module>: new version of the model (make module), loaded and\n"
+    "     switched to on SIGHUP, states kept (not with SHV)\n"
+    " --swap-blend <s>: ramp of the device inputs to the new version (default 0.5)\n"
+    " --swap-probation <s>: switch back if the new version overruns within s\n"
+    "     (default 5)\n"
     "  -v --verbose: verbose output\n"
     "  -V --version: print version\n"
+    "  -W --watchdog <ms>: stop if a step lasts longer, exit status 3 if it\n"
+    "     does not return, the outputs are not reset then (default 0, off)\n"
     " --shv-devid <dev-id>: set the device's name in SHV\n"
     " --shv-ipaddr <ip>: set the broker's IPv4\n"
     " --shv-mount <mount>: device's mount point in SHV\n"
     " --shv-passwd <passwd>: password to access the broker\n"
     " --shv-port <port>: set the broker's port\n"
-    " --shv-user <user> user to access the broker");
+    " --shv-user <user> user to access the broker\n"
+    "\n"
+    "RT environment settings:\n"
+    "  <class>.policy = fifo|rr|other, <class>.prio = <val>,\n"
+    "  <class>.cpus = <list>, class is rt, watchdog, report, com, io or monitor\n"
+    "  dma_latency = <us>, prefault_stack = <kB>, prefault_heap = <kB>,\n"
+    "  irq.<n> = <cpu list>");
 }
 
 char *parse_string(char ** str, int parse_char)
@@ -285,20 +1377,33 @@ static void proc_opt(int argc, char *argv[])
   int i;
   char *t;
 
-  while((i=getopt_long(argc,argv,"ef:hp:vVw",optargs,NULL))!=-1){
+  while((i=getopt_long(argc,argv,"c:ef:ho:p:vVwW:",optargs,NULL))!=-1){
     switch(i){
     case 'h':
       print_usage();
       exit(0);
       break;
+    case 'o':
+      if (parse_overrun(optarg) < 0) {
+        printf("-> Invalid overrun policy.\n");
+        exit(1);
+      }
+      break;
     case 'p':
       prio = atoi(optarg);
+      rtclass[0].prio = prio;
+      break;
+    case 'W':
+      watchdog_ms = atoi(optarg);
       break;
     case 'v':
       verbose = 1;
       break;
+    case 'c':
+      clockspec = optarg;
+      break;
     case 'e':
-      extclock = 1;
+      clockspec = "ext";
       break;
     case 'w':
       wait = 1;
@@ -315,6 +1420,64 @@ static void proc_opt(int argc, char *argv[])
         exit(1);
       }
       break;
+    case INIT_TIMEOUT_FLAG:
+      if ((init_timeout = atof(optarg)) < 0.0) {
+        printf("-> Invalid init timeout.\n");
+        exit(1);
+      }
+      break;
+    case IO_RECORD_FLAG:
+      io_record = optarg;
+      break;
+    case REC_FLAG:
+      rec_seconds = atof(optarg);
+      if (strchr(optarg, ':') != NULL)
+        rec_dir = strchr(optarg, ':') + 1;
+      if (rec_seconds < 0.0 || *rec_dir == '\0') {
+        printf("-> Invalid flight recorder setting.\n");
+        exit(1);
+      }
+      break;
+    case REC_RANGE_FLAG:
+      if (rec_nranges == sizeof(rec_ranges) / sizeof(rec_ranges[0])) {
+        printf("-> Too many range triggers.\n");
+        exit(1);
+      }
+      rec_ranges[rec_nranges++] = optarg;
+      break;
+    case RT_ENV_FLAG:
+      if (rt_env_set(optarg) < 0)
+        exit(1);
+      break;
+    case RT_ENV_FILE_FLAG:
+      if (rt_env_file(optarg) < 0)
+        exit(1);
+      break;
+    case SWAP_FLAG:
+#ifdef CONF_SHV_USED
+      /* The SHV tree is bound to the nodes and blocks of the first version */
+      printf("-> Hot swap not available with SHV.\n");
+      exit(1);
+#endif
+#ifdef PYSIM_NO_SWAP
+      /* A static executable cannot load the module of a new version */
+      printf("-> Hot swap not available in this build.\n");
+      exit(1);
+#endif
+      swap_module = optarg;
+      break;
+    case SWAP_BLEND_FLAG:
+      if ((swap_blend = atof(optarg)) < 0.0) {
+        printf("-> Invalid swap blend time.\n");
+        exit(1);
+      }
+      break;
+    case SWAP_PROBATION_FLAG:
+      if ((swap_probation = atof(optarg)) < 0.0) {
+        printf("-> Invalid swap probation time.\n");
+        exit(1);
+      }
+      break;
     case SHV_DEVID_FLAG:
       printf("Setting here!");
       setenv("CONF_SHV_BROKER_DEV_ID", optarg, 1);
@@ -350,19 +1513,14 @@ static void proc_opt(int argc, char *argv[])
 
 double NAME(MODEL, _runtime)(struct pysim_platform_model_ctx *ctx)
 {
+  (void) ctx;
   return T;
 }
 
 int NAME(MODEL, _comprio)(struct pysim_platform_model_ctx *ctx)
 {
-  if (prio < 0)
-    {
-      return -1;
-    }
-  else
-    {
-      return prio - 1;
-    }
+  (void) ctx;
+  return get_priority_for_com();
 }
 
 void NAME(MODEL, _pausectrl)(struct pysim_platform_model_ctx *ctx)
@@ -420,7 +1578,7 @@ int shv_init_fwstable(struct pysim_platform_model_ctx *ctx,
 
 int main(int argc,char** argv)
 {
-  pthread_t thrd;
+  pthread_t thrd, rthrd, wthrd;
   int fd;
   int uid;
 
@@ -428,6 +1586,11 @@ int main(int argc,char** argv)
 
   signal(SIGINT,endme);
   signal(SIGKILL,endme);
+  signal(SIGUSR1,recme);
+#ifndef PYSIM_NO_SWAP
+  if (swap_module != NULL)
+    signal(SIGHUP,swapme);
+#endif
 
 #ifdef CG_WITH_NRT
   uid = geteuid();
@@ -445,9 +1608,23 @@ int main(int argc,char** argv)
   iopl(3);
 #endif /*CG_WITH_IOPL*/
 
+  rt_env_defaults();
+  rt_env_apply();
+
+  pthread_create(&rthrd,NULL,reporter,NULL);
+  if (watchdog_ms > 0) {
+    pthread_create(&wthrd,NULL,watchdog,&NAME(MODEL, _pt_ctx));
+  }
+
   pthread_create(&thrd,NULL,rt_task,&NAME(MODEL, _pt_ctx));
 
   pthread_join(thrd,NULL);
-  return(0);
+  end = 1;
+  if (watchdog_ms > 0) {
+    pthread_join(wthrd,NULL);
+  }
+  atomic_store(&report_end, 1);
+  pthread_join(rthrd,NULL);
+  return(exitcode);
 }
 
@@ -14,6 +14,7 @@
 
 #include <semaphore.h>
 #include <pyblock.h>
+#include <threadclass.h>
 
 #ifdef HAVE_MLOCK
 #include <sys/mman.h>
@@ -93,6 +94,13 @@ int get_priority_for_com(void)
     }
 }
 
+/* Thread classes are handled by the LinuxRT main only */
+
+int set_thread_class(const char *name)
+{
+  return 0;
+}
+
 static inline void tsnorm(struct timespec *ts)
 {
   while (ts->tv_nsec >= NSEC_PER_SEC) {
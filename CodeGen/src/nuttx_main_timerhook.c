@@ -53,6 +53,7 @@
 #include <nuttx/timers/timer.h>
 
 #include <pyblock.h>
+#include <threadclass.h>
 
 #ifdef HAVE_MLOCK
 #include <sys/mman.h>
@@ -596,6 +597,13 @@ int get_priority_for_com(void)
     }
 }
 
+/* Thread classes are handled by the LinuxRT main only */
+
+int set_thread_class(const char *name)
+{
+  return 0;
+}
+
 /* Staging change only, for now. The passed pointer is to be used
  * for future purposes, to get rid of global variables and to be generic.
  */
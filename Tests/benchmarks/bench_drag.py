@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+"""
+Benchmark of the block editor on large diagrams
+
+Builds diagrams of gain blocks connected in a chain, every tenth output
+also fans out to the block of the next row, and drives the editor with
+mouse events through the view:
+
+  hover   idle mouse moves along the connections, hit tests only
+  drag 1  drag of one block
+  drag G  drag of a selected group of blocks
+
+The times are per mouse move. After the drags the diagram is checked:
+the connections end on their ports and are found by the segment index
+at their new place, undo and redo restore the positions, and a save
+and load in diagram format 2 gives back the same netlist.
+
+  python3 bench_drag.py [-n 100,1000,5000] [--moves 50] [--group 20]
+
+Qt runs with the offscreen platform unless QT_QPA_PLATFORM is set. Run
+from the repository root or with toolbox/supsisim in PYTHONPATH, the
+editor needs PYSUPSICTRL like pysimCoder itself.
+"""
+
+import argparse
+import math
+import os
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', '..', 'toolbox', 'supsisim'))
+
+os.environ.setdefault('QT_QPA_PLATFORM', 'offscreen')
+os.environ.setdefault('PYSUPSICTRL', os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                  '..', '..'))
+
+from supsisim.qtvers import *
+from PyQt6.QtCore import QPoint
+from PyQt6.QtTest import QTest
+
+from supsisim.pyEdit import NewEditorMainWindow
+from supsisim.block import Block
+from supsisim.connection import Connection
+
+GAIN = {'name': 'Gain', 'inp': 1, 'outp': 1, 'inset': True, 'outset': True,
+        'icon': 'MULT', 'params': 'matmultBlk|Gains: 1:double', 'help': '',
+        'dims': [80, 60], 'flip': False}
+
+DX = 200.0
+DY = 120.0
+
+LEFT = Qt.MouseButton.LeftButton
+NOMOD = Qt.KeyboardModifier.NoModifier
+
+
+def route(blocks, src, dst, inp):
+    # Ports of a gain block are at half its width, two inputs at +-20.
+    # The connection turns right of the output, a connection to the next
+    # row runs in the free space above that row.
+    x1, y1 = blocks[src]['pos']
+    x2, y2 = blocks[dst]['pos']
+    pos1 = (x1 + 40, y1)
+    pos2 = (x2 - 40, y2 + (40 * inp - 20 if blocks[dst]['inp'] == 2 else 0))
+    if x2 > x1:
+        points = [(pos1[0] + 20, pos1[1]), (pos1[0] + 20, pos2[1])]
+    else:
+        ym = y2 - DY / 2
+        points = [(pos1[0] + 20, pos1[1]), (pos1[0] + 20, ym),
+                  (pos2[0] - 20, ym), (pos2[0] - 20, pos2[1])]
+    return {'pos1': pos1, 'pos2': pos2, 'points': points,
+            'src': (src, 0), 'dst': (dst, inp)}
+
+
+def diagram(n):
+    cols = int(math.ceil(math.sqrt(n)))
+    blocks = []
+    conns = []
+    for k in range(n):
+        b = dict(GAIN)
+        b['name'] = 'Gain%d' % k
+        b['id'] = k
+        b['pos'] = ((k % cols) * DX, (k // cols) * DY)
+        blocks.append(b)
+    # The chain feeds input 0, fan outs go to an extra input of the block
+    # below
+    fanout = range(0, n - cols, 10)
+    for k in fanout:
+        blocks[k + cols]['inp'] = 2
+    for k in range(1, n):
+        conns.append(route(blocks, k - 1, k, 0))
+    for k in fanout:
+        conns.append(route(blocks, k, k + cols, 1))
+    return {'blocks': blocks, 'connections': conns}
+
+
+def blocksOf(scene):
+    return [i for i in scene.items() if isinstance(i, Block)]
+
+
+def connsOf(scene):
+    return [i for i in scene.items() if isinstance(i, Connection)]
+
+
+def netlist(scene):
+    # Connections as (source block, output index, destination block, input
+    # index), blocks named by their position
+    net = set()
+    for c in connsOf(scene):
+        b1 = c.port1.parent
+        b2 = c.port2.parent
+        net.add(((b1.pos().x(), b1.pos().y()), b1.getPorts()[1].index(c.port1),
+                 (b2.pos().x(), b2.pos().y()), b2.getPorts()[0].index(c.port2)))
+    return net
+
+
+def drag(app, w, blk, moves, step):
+    # Press on the block, move and release, time per move
+    vp = w.view.viewport()
+    w.view.centerOn(blk)
+    app.processEvents()
+    p = w.view.mapFromScene(blk.scenePos())
+    QTest.mousePress(vp, LEFT, NOMOD, p)
+    t0 = time.perf_counter()
+    for i in range(1, moves + 1):
+        QTest.mouseMove(vp, p + QPoint(i * step, i * step // 2))
+    t = (time.perf_counter() - t0) / moves
+    QTest.mouseRelease(vp, LEFT, NOMOD, p + QPoint(moves * step, moves * step // 2))
+    app.processEvents()
+    return t
+
+
+def hover(app, w, conn, moves):
+    # Along the path of the connection
+    vp = w.view.viewport()
+    path = conn.path()
+    w.view.centerOn(path.pointAtPercent(0.5))
+    app.processEvents()
+    t0 = time.perf_counter()
+    hits = 0
+    for i in range(moves):
+        pt = path.pointAtPercent((i + 0.5) / moves)
+        QTest.mouseMove(vp, w.view.mapFromScene(pt))
+        if w.editor.findConnectionAt(pt) is not None:
+            hits += 1
+    return (time.perf_counter() - t0) / moves, hits == moves
+
+
+def connectionsOk(w, blocks):
+    # Ends of the connections of the blocks on their ports, each connection
+    # found by the index in the middle of its last segment
+    for b in blocks:
+        for p in b.childItems():
+            for c in getattr(p, 'connections', []):
+                if c.pos1 != c.gridPos(c.port1.scenePos()) or c.pos2 != c.gridPos(c.port2.scenePos()):
+                    return False
+                pts = [c.pos1] + c.connPoints + [c.pos2]
+                mid = (pts[-2] + pts[-1]) / 2
+                if c not in w.scene.connIndex.connectionsAt(mid):
+                    return False
+    return True
+
+
+def run(app, n, moves, group):
+    w = NewEditorMainWindow('untitled', '.', None)
+    w.resize(1200, 800)
+    w.show()
+    scene = w.scene
+    checks = []
+
+    t0 = time.perf_counter()
+    scene.DictToDgm(diagram(n))
+    app.processEvents()
+    t_build = time.perf_counter() - t0
+
+    blocks = sorted(blocksOf(scene), key=lambda b: (b.pos().y(), b.pos().x()))
+    checks.append(len(blocks) == n)
+
+    # A fan out connection in the middle of the diagram
+    conns = [c for c in connsOf(scene) if c.port2 is not c.port2.parent.getPorts()[0][0]]
+    conns.sort(key=lambda c: (c.pos1.y(), c.pos1.x()))
+    t_hover, ok = hover(app, w, conns[len(conns) // 2], moves)
+    checks.append(ok)
+
+    # One block in the middle of the diagram
+    blk = blocks[n // 2]
+    start = blk.pos()
+    t_drag1 = drag(app, w, blk, moves, 2)
+    moved = blk.pos()
+    checks.append(moved != start and connectionsOk(w, [blk]))
+
+    # Undo and redo of the drag, the block is loaded again by both
+    uid = blk.uid
+    t0 = time.perf_counter()
+    scene.undoDgm()
+    t_undo = time.perf_counter() - t0
+    blk = scene.undo.getBlock(uid)
+    checks.append(blk is not None and blk.pos() == start and connectionsOk(w, [blk]))
+    scene.redoDgm()
+    blk = scene.undo.getBlock(uid)
+    checks.append(blk is not None and blk.pos() == moved and connectionsOk(w, [blk]))
+
+    # A group of blocks, dragged by its first block
+    blocks = sorted(blocksOf(scene), key=lambda b: (b.pos().y(), b.pos().x()))
+    sel = blocks[:group]
+    for b in sel:
+        b.setSelected(True)
+    starts = [b.pos() for b in sel]
+    t_dragG = drag(app, w, sel[0], moves, 2)
+    checks.append(all(b.pos() != p for b, p in zip(sel, starts)) and connectionsOk(w, sel))
+
+    # Save and load in the current format
+    net = netlist(scene)
+    with tempfile.TemporaryDirectory() as tmp:
+        fname = os.path.join(tmp, 'bench.dgm')
+        t0 = time.perf_counter()
+        scene.saveDgm(fname)
+        scene.loadDgm(fname)
+        t_io = time.perf_counter() - t0
+    checks.append(netlist(scene) == net)
+
+    w.hide()
+    scene.clearDgm()
+    return t_build, t_hover, t_drag1, t_dragG, t_undo, t_io, checks
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Block editor benchmark')
+    parser.add_argument('-n', default='100,1000,5000',
+                        help='comma separated numbers of blocks')
+    parser.add_argument('--moves', type=int, default=50,
+                        help='mouse moves of each hover and drag')
+    parser.add_argument('--group', type=int, default=20,
+                        help='blocks of the dragged group')
+    args = parser.parse_args()
+
+    app = QApplication(sys.argv[:1])
+
+    failed = False
+    print('blocks     load    hover   drag 1   drag G     undo  save+load  checks')
+    for n in [int(x) for x in args.n.split(',')]:
+        t_build, t_hover, t_drag1, t_dragG, t_undo, t_io, checks = run(app, n, args.moves,
+                                                                       min(args.group, n))
+        ok = 'ok' if all(checks) else 'FAIL ' + ''.join('1' if c else '0' for c in checks)
+        failed = failed or not all(checks)
+        print('%6d %6.2f s %5.2f ms %5.2f ms %5.2f ms %5.0f ms %8.2f s  %s' %
+              (n, t_build, 1e3 * t_hover, 1e3 * t_drag1, 1e3 * t_dragG, 1e3 * t_undo,
+               t_io, ok))
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
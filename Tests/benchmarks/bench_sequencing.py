@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""
+Benchmark of the block sequencing of the code generator
+
+Times detBlkSeq() against the former rotating list implementation on
+synthetic diagrams and checks that both give the same block sequence.
+
+  python3 bench_sequencing.py [-n 1000,4000,10000] [--max-old 10000]
+                              [--gencode]
+
+Diagrams:
+  chain   feedthrough chain listed in reverse order, the worst case of
+          the rotating list
+  random  random feedthrough DAG with print sinks, shuffled
+
+Run from the repository root or with toolbox/supsisim in PYTHONPATH.
+"""
+
+import argparse
+import os
+import random
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', '..', 'toolbox', 'supsisim'))
+
+from supsisim.RCPblk import RCPblk, RcpParam
+from supsisim.RCPgen import detBlkSeq, genCode
+
+DOUBLE = RcpParam.Type.DOUBLE
+
+
+def detBlkSeqRotating(Nodes, blocks):
+    """detBlkSeq() before the linear time version, the reference order"""
+    blks = []
+    blks2order = []
+
+    block_in = [[] for n in range(Nodes + 1)]
+    block_out = [[] for n in range(Nodes + 1)]
+    for blk in blocks:
+        for n in blk.pin:
+            block_out[n].append(blk)
+        for n in blk.pout:
+            block_in[n].append(blk)
+
+    for blk in blocks:
+        if blk.uy == 0:
+            if len(blk.pin) == 0 and len(blk.pout) == 0:
+                blks.insert(0, blk)
+            else:
+                blks.append(blk)
+        else:
+            deps = [block_in[n][0] for n in blk.pin if block_in[n][0].uy == 1]
+            blks2order.append([blk, deps])
+
+    counter = 0
+    while len(blks2order) != counter:
+        item = blks2order.pop(0)
+        if len(item[1]) == 0:
+            blks.append(item[0])
+            counter = 0
+            for node in item[0].pout:
+                for bk in block_out[node]:
+                    el = [el for el in blks2order if el[0] == bk]
+                    try:
+                        el[0][1].remove(item[0])
+                    except (IndexError, ValueError):
+                        pass
+        else:
+            blks2order.append(item)
+            counter += 1
+
+    if len(blks2order) != 0:
+        raise ValueError('Algeabric loop!')
+
+    return blks
+
+
+def constant(node):
+    return RCPblk('constant', [], [node], [0, 0], 0, [RcpParam('Value', 1.0, DOUBLE)])
+
+
+def sum2(a, b, node):
+    return RCPblk('sum', [a, b], [node], [0, 0], 1,
+                  [RcpParam('Gains', [1.0, -1.0], DOUBLE, is_list=True)])
+
+
+def printer(a):
+    return RCPblk('print', [a], [], [0, 0], 1, [])
+
+
+def chainDiagram(n, seed):
+    rnd = random.Random(seed)
+    blks = [constant(1)]
+    for i in range(2, n + 1):
+        blks.append(sum2(i - 1, rnd.randint(max(1, i - 3), i - 1), i))
+    blks.reverse()
+    return n, blks
+
+
+def randomDiagram(n, seed):
+    rnd = random.Random(seed)
+    blks = [constant(1)]
+    nodes = 1
+    while len(blks) < n:
+        if rnd.random() < 0.2:
+            blks.append(printer(rnd.randint(1, nodes)))
+        else:
+            nodes += 1
+            blks.append(sum2(rnd.randint(1, nodes - 1), rnd.randint(1, nodes - 1), nodes))
+    rnd.shuffle(blks)
+    return nodes, blks
+
+
+def name(blocks):
+    for k, blk in enumerate(blocks):
+        blk.name = 'blk%d' % k
+    return blocks
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Block sequencing benchmark')
+    parser.add_argument('-n', default='1000,4000,10000',
+                        help='comma separated numbers of blocks')
+    parser.add_argument('--max-old', type=int, default=10000,
+                        help='largest diagram sequenced by the rotating list')
+    parser.add_argument('--gencode', action='store_true',
+                        help='time genCode() on the diagram as well')
+    args = parser.parse_args()
+
+    os.environ.setdefault('SHV_USED', 'False')
+    os.environ.setdefault('SHV_TREE_TYPE', 'GAVL')
+
+    print('diagram  blocks   rotating   detBlkSeq   genCode  same order')
+    for n in [int(x) for x in args.n.split(',')]:
+        for kind, diagram in (('chain', chainDiagram), ('random', randomDiagram)):
+            nodes, blocks = diagram(n, 1)
+            name(blocks)
+
+            t0 = time.perf_counter()
+            seq = detBlkSeq(nodes, blocks)
+            t_new = time.perf_counter() - t0
+
+            if n <= args.max_old:
+                t0 = time.perf_counter()
+                ref = detBlkSeqRotating(nodes, blocks)
+                t_old = '%8.3f s' % (time.perf_counter() - t0)
+                same = 'yes' if [b.name for b in seq] == [b.name for b in ref] else 'NO'
+            else:
+                t_old = '%10s' % '-'
+                same = '-'
+
+            t_gen = '%8s' % '-'
+            if args.gencode:
+                cwd = os.getcwd()
+                with tempfile.TemporaryDirectory() as tmp:
+                    os.chdir(tmp)
+                    try:
+                        t0 = time.perf_counter()
+                        genCode('bench', 0.01, name(diagram(n, 1)[1]), 'standard RK4')
+                        t_gen = '%6.3f s' % (time.perf_counter() - t0)
+                    finally:
+                        os.chdir(cwd)
+
+            print('%-7s %7d %s %9.3f s %s  %s' % (kind, n, t_old, t_new, t_gen, same))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+Check of the node pool of the memory planner
+
+Runs the blocks of small diagrams in the order of the generated code,
+algebraic loops solved in two passes at their first block, and checks
+that each pooled node still holds its own value when it is read.
+
+  python3 node_pool.py
+
+Run from the repository root or with toolbox/supsisim in PYTHONPATH.
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', '..', 'toolbox', 'supsisim'))
+
+from supsisim.RCPblk import RCPblk, RcpParam
+from supsisim.RCPgen import detBlkSeq, planNodes
+
+DOUBLE = RcpParam.Type.DOUBLE
+
+
+def constant(node):
+    return RCPblk('constant', [], [node], [0, 0], 0, [RcpParam('Value', 1.0, DOUBLE)])
+
+
+def sum2(a, b, node):
+    return RCPblk('sum', [a, b], [node], [0, 0], 1,
+                  [RcpParam('Gains', [1.0, -0.5], DOUBLE, is_list=True)])
+
+
+def gain(a, node):
+    return RCPblk('mxmult', [a], [node], [0, 0], 1,
+                  [RcpParam('Gains', [0.5], DOUBLE, is_list=True)])
+
+
+def printer(a):
+    return RCPblk('print', [a], [], [0, 0], 1, [])
+
+
+def loopChain():
+    """constant -> 3, loop sum(3, 7) -> 4 -> 8 -> 5 -> 6 -> 7 cut at 5"""
+    return 8, [constant(3), gain(8, 5), gain(5, 6), gain(6, 7),
+               sum2(3, 7, 4), gain(4, 8)]
+
+
+def loopReaders():
+    """Loop nodes read after the loop, a chain driven by the loop"""
+    return 9, [constant(1), sum2(1, 4, 2), gain(2, 3), gain(3, 4),
+               gain(3, 5), sum2(5, 1, 6), gain(6, 7), printer(2),
+               printer(7), constant(8), gain(8, 9), printer(9)]
+
+
+def twoLoops():
+    """Output of a loop feeding a second loop"""
+    return 8, [constant(1), sum2(1, 3, 2), gain(2, 3), gain(3, 4),
+               sum2(4, 6, 5), gain(5, 6), gain(6, 7), printer(7),
+               constant(8), printer(8)]
+
+
+def check(name, diagram):
+    nodes, blocks = diagram()
+    loops = []
+    Blocks = detBlkSeq(nodes, blocks, loops)
+    nodeSlot, poolSize = planNodes(nodes, Blocks, [()] * len(Blocks))
+
+    # Sequence of the CG_OUT calls, the solver of a loop iterates at the
+    # first block of the loop
+    trace = []
+    solved = set()
+    for blk in Blocks:
+        if blk.loop is None:
+            trace.append(blk)
+        elif blk.loop not in solved:
+            solved.add(blk.loop)
+            trace += 2 * [b for b in Blocks if b.loop == blk.loop]
+
+    holder = {}
+    errors = []
+    for blk in trace:
+        for n in blk.pin:
+            if n in nodeSlot and holder.get(nodeSlot[n]) != n:
+                errors.append('node %d read by %s holds node %s' %
+                              (n, blk.fcn, holder.get(nodeSlot[n])))
+        for n in blk.pout:
+            if n in nodeSlot:
+                holder[nodeSlot[n]] = n
+
+    print('%-12s loops %d  pool %d/%d nodes  %s' %
+          (name, len(loops), poolSize, len(nodeSlot), 'ok' if not errors else 'FAILED'))
+    for e in errors:
+        print('  ' + e)
+    return not errors
+
+
+def main():
+    os.environ.setdefault('SHV_USED', 'False')
+    os.environ.setdefault('SHV_TREE_TYPE', 'GAVL')
+
+    ok = True
+    for name, diagram in (('loop chain', loopChain), ('loop readers', loopReaders),
+                          ('two loops', twoLoops)):
+        ok = check(name, diagram) and ok
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,224 @@
+/*
+  COPYRIGHT (C) 2026  pysimCoder developers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+*/
+
+/* Equivalence of the float and Q16.16 block variants (typed_f32.c,
+ * typed_q16.c) with the double blocks of common_dev.
+ *
+ * Each block runs side by side in the three types on the same input
+ * signals for STEPS samples. The inputs are rounded to the type of the
+ * variant and the outputs converted back to double the same way the
+ * generated cnv blocks do, the parameters the way the code generator
+ * writes typedPar. The largest absolute difference from the double
+ * output is printed for each block, the program fails if it is over
+ * the limit of the type.
+ */
+
+#include <pyblock.h>
+#include <pysim_num.h>
+#include <math.h>
+#include <stdio.h>
+
+#define STEPS    5000
+#define MAXIO    4
+#define MAXPAR   32
+
+#define TOL_F32  1e-5
+#define TOL_Q16  5e-4
+
+void mxmult(int flag, python_block *block);
+void sum(int flag, python_block *block);
+void saturation(int flag, python_block *block);
+void lut(int flag, python_block *block);
+void trigo(int flag, python_block *block);
+void discretePID(int flag, python_block *block);
+void dss(int flag, python_block *block);
+
+void mxmult_f32(int flag, python_block *block);
+void sum_f32(int flag, python_block *block);
+void saturation_f32(int flag, python_block *block);
+void lut_f32(int flag, python_block *block);
+void trigo_f32(int flag, python_block *block);
+void discretePID_f32(int flag, python_block *block);
+void dss_f32(int flag, python_block *block);
+
+void mxmult_q16(int flag, python_block *block);
+void sum_q16(int flag, python_block *block);
+void saturation_q16(int flag, python_block *block);
+void lut_q16(int flag, python_block *block);
+void trigo_q16(int flag, python_block *block);
+void discretePID_q16(int flag, python_block *block);
+void dss_q16(int flag, python_block *block);
+
+typedef void (*block_fcn)(int flag, python_block *block);
+
+struct equiv_case {
+  const char *name;
+  block_fcn fcn_d;
+  block_fcn fcn_f;
+  block_fcn fcn_q;
+  int nin;
+  int nout;
+  int stupd;                 /* Block has a state update */
+  int npar;
+  double par[MAXPAR];        /* realPar including the states */
+  int nint;
+  int ipar[MAXPAR];
+  double amp;                /* Amplitude of the input signals */
+  double tol_q16;            /* Limit for Q16.16 if not TOL_Q16 */
+};
+
+static const struct equiv_case cases[] = {
+  {"mxmult", mxmult, mxmult_f32, mxmult_q16, 2, 2, 0,
+   4, {1.5, -0.25, 0.75, 2.0}, 0, {0}, 1.0, 0},
+  {"sum", sum, sum_f32, sum_q16, 2, 1, 0,
+   2, {1.0, -0.5}, 0, {0}, 1.0, 0},
+  {"saturation", saturation, saturation_f32, saturation_q16, 1, 1, 0,
+   2, {0.5, -0.3}, 0, {0}, 1.0, 0},
+  {"lut", lut, lut_f32, lut_q16, 1, 1, 0,
+   4, {0.2, -0.5, 1.0, 0.1}, 1, {4}, 1.0, 0},
+  {"trigo sin", trigo, trigo_f32, trigo_q16, 1, 1, 0,
+   0, {0}, 1, {1}, 1.5, 0},
+  {"trigo cos", trigo, trigo_f32, trigo_q16, 1, 1, 0,
+   0, {0}, 1, {2}, 1.5, 0},
+
+  /* Ki = 0.01 is 655/65536 in Q16.16, the integral drifts from the double
+   * one with the relative error of Ki (6e-4) plus the rounding of the
+   * increments (2e-4 over the run).
+   */
+
+  {"discretePID", discretePID, discretePID_f32, discretePID_q16, 1, 1, 0,
+   7, {2.0, 0.01, 0.5, -5.0, 5.0, 0.0, 0.0}, 0, {0}, 1.0, 5e-3},
+  {"dss", dss, dss_f32, dss_q16, 1, 1, 1,
+
+   /* A 2x2, B 2x1, C 1x2, D 1x1, X 2 */
+
+   11, {0.9, 0.1, -0.1, 0.9, 0.1, 0.05, 1.0, 0.0, 0.01, 0.0, 0.0},
+   8, {2, 1, 1, 0, 4, 6, 8, 9}, 1.0, 0},
+};
+
+/* Input i of the block at step k, a sine and a slower triangle */
+
+static double input(const struct equiv_case *c, int i, int k)
+{
+  double t = k * 0.001;
+  double tri = fmod(t * 0.7 + i * 0.3, 2.0);
+
+  if (i % 2 == 0)
+    return c->amp * sin(2 * M_PI * (1.0 + i) * t);
+  return c->amp * (tri < 1.0 ? 2.0 * tri - 1.0 : 3.0 - 2.0 * tri);
+}
+
+static int run_case(const struct equiv_case *c)
+{
+  double par_d[MAXPAR];
+  float par_f[MAXPAR];
+  pysim_q16 par_q[MAXPAR];
+  int ipar[MAXPAR];
+  double u_d[MAXIO], y_d[MAXIO];
+  float u_f[MAXIO], y_f[MAXIO];
+  pysim_q16 u_q[MAXIO], y_q[MAXIO];
+  void *up_d[MAXIO], *yp_d[MAXIO];
+  void *up_f[MAXIO], *yp_f[MAXIO];
+  void *up_q[MAXIO], *yp_q[MAXIO];
+  python_block b_d = {0}, b_f = {0}, b_q = {0};
+  double err_f = 0.0, err_q = 0.0;
+  int fail;
+  int i, k;
+
+  for (i = 0; i < c->npar; i++)
+    {
+      par_d[i] = c->par[i];
+      par_f[i] = (float) c->par[i];
+      par_q[i] = q16_from_double(c->par[i]);
+    }
+  for (i = 0; i < c->nint; i++)
+    {
+      ipar[i] = c->ipar[i];
+    }
+  for (i = 0; i < MAXIO; i++)
+    {
+      up_d[i] = &u_d[i];
+      yp_d[i] = &y_d[i];
+      up_f[i] = &u_f[i];
+      yp_f[i] = &y_f[i];
+      up_q[i] = &u_q[i];
+      yp_q[i] = &y_q[i];
+    }
+
+  b_d.nin = b_f.nin = b_q.nin = c->nin;
+  b_d.nout = b_f.nout = b_q.nout = c->nout;
+  b_d.intPar = b_f.intPar = b_q.intPar = ipar;
+  b_d.intParNum = b_f.intParNum = b_q.intParNum = c->nint;
+  b_d.realPar = par_d;
+  b_d.realParNum = c->npar;
+  b_f.ptrPar = par_f;
+  b_q.ptrPar = par_q;
+  b_d.u = up_d;
+  b_d.y = yp_d;
+  b_f.u = up_f;
+  b_f.y = yp_f;
+  b_q.u = up_q;
+  b_q.y = yp_q;
+
+  for (k = 0; k < STEPS; k++)
+    {
+      for (i = 0; i < c->nin; i++)
+        {
+          u_d[i] = input(c, i, k);
+          u_f[i] = (float) u_d[i];
+          u_q[i] = q16_from_double(u_d[i]);
+        }
+
+      c->fcn_d(CG_OUT, &b_d);
+      c->fcn_f(CG_OUT, &b_f);
+      c->fcn_q(CG_OUT, &b_q);
+
+      for (i = 0; i < c->nout; i++)
+        {
+          err_f = fmax(err_f, fabs((double) y_f[i] - y_d[i]));
+          err_q = fmax(err_q, fabs(q16_to_double(y_q[i]) - y_d[i]));
+        }
+
+      if (c->stupd)
+        {
+          c->fcn_d(CG_STUPD, &b_d);
+          c->fcn_f(CG_STUPD, &b_f);
+          c->fcn_q(CG_STUPD, &b_q);
+        }
+    }
+
+  fail = err_f > TOL_F32 || err_q > (c->tol_q16 > 0 ? c->tol_q16 : TOL_Q16);
+  printf("%-12s %12.3e %12.3e  %s\n", c->name, err_f, err_q, fail ? "FAIL" : "ok");
+  return fail;
+}
+
+int main(void)
+{
+  int failed = 0;
+  unsigned int i;
+
+  printf("%d samples, limits float %.0e, Q16.16 %.0e\n", STEPS, TOL_F32, TOL_Q16);
+  printf("%-12s %12s %12s\n", "block", "float", "Q16.16");
+
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+      failed += run_case(&cases[i]);
+    }
+
+  return failed != 0;
+}
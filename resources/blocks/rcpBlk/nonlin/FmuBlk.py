@@ -39,6 +39,10 @@ def FmuBlk(*args):
 
     ft = params[-1].value
     params.pop(-1)
+
+    # Diagrams saved before the step budget parameter was introduced
+    if len(params) == 5:
+        params.append(RcpParam("Step budget", 0.0, RcpParam.Type.DOUBLE))
     params.append(RcpParam("Inputs Size", np.size(pin), RcpParam.Type.INT))
     params.append(RcpParam("Outputs Size", np.size(pin), RcpParam.Type.INT))
 
@@ -0,0 +1,25 @@
+from supsisim.RCPblk import RCPblk, RcpParam
+from numpy import size
+
+
+def enableBlk(pin: list[int]) -> RCPblk:
+    """
+    Call:   enableBlk(pin)
+
+    Parameters
+    ----------
+       pin: connected input port
+
+       The other blocks of the same subsystem are executed only while
+       the input is positive
+
+    Returns
+    -------
+      Block's reprezentation RCPblk
+    """
+
+    if (nin := size(pin)) != 1:
+        raise ValueError("Block should have 1 input port; received %i." % nin)
+
+    params = [RcpParam("Active", 0, RcpParam.Type.INT)]
+    return RCPblk("enable_port", pin, [], [0, 0], 1, params)
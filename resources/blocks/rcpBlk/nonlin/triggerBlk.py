@@ -0,0 +1,28 @@
+from supsisim.RCPblk import RCPblk, RcpParam
+from numpy import size
+
+
+def triggerBlk(pin: list[int], params: RcpParam) -> RCPblk:
+    """
+    Call:   triggerBlk(pin, params)
+
+    Parameters
+    ----------
+       pin: connected input port
+       params: block's parameters
+
+       The other blocks of the same subsystem are executed only in the
+       samples where the input crosses zero in the direction given by
+       the Edge parameter (1 rising, 2 falling, 3 both)
+
+    Returns
+    -------
+      Block's reprezentation RCPblk
+    """
+
+    if (nin := size(pin)) != 1:
+        raise ValueError("Block should have 1 input port; received %i." % nin)
+
+    params.insert(0, RcpParam("Active", 0, RcpParam.Type.INT))
+    params.append(RcpParam("Previous Input", 0.0, RcpParam.Type.DOUBLE))
+    return RCPblk("trigger_port", pin, [], [0, 0], 1, params)
@@ -0,0 +1,108 @@
+"""
+This is a procedural interface to the flight recorder dumps of the
+LinuxRT models (--rec option of the model executable)
+
+The following commands are provided:
+    load_rec   -  Load a dump into NumPy arrays
+    print_rec  -  Print a summary of a dump
+
+"""
+
+import sys
+import numpy as np
+
+REC_TYPES = {'d': 'f8', 'f': 'f4', 'q': 'i4'}
+
+def load_rec(fname):
+    """Load a flight recorder dump
+
+    Call:
+    info, data = load_rec(fname)
+
+    Parameters
+    ----------
+    fname : file written by the model, <model>-<date>-<time>-<n>.rec
+
+    Returns
+    -------
+    info  : dictionary with model, tsamp, reason, trigger (index of the
+            frame of the trigger), frames and signals (names in the file
+            order)
+    data  : dictionary signal name -> array, 't' is the model time, a
+            vector signal gives an array of shape (frames, n)
+
+    Fixed point signals are converted to float.
+
+    """
+
+    with open(fname, 'rb') as f:
+        raw = f.read()
+
+    info = {'signals': []}
+    names, formats, offsets = [], [], []
+    pos = 0
+    while True:
+        end = raw.index(b'\n', pos)
+        line = raw[pos:end].decode()
+        pos = end + 1
+        if line == 'data':
+            break
+        if line.startswith('pysimCoder flight recorder'):
+            info['version'] = int(line.split()[-1])
+            continue
+        key, _, val = line.partition(' ')
+        if key == 'signal':
+            t, off, n, name = val.split(' ', 3)
+            fmt = REC_TYPES[t]
+            names.append(name)
+            formats.append((fmt, (int(n),)) if int(n) > 1 else fmt)
+            offsets.append(int(off))
+            info['signals'].append(name)
+            if t == 'q':
+                info.setdefault('fixed', []).append(name)
+        elif key == 'tsamp':
+            info[key] = float(val)
+        elif key in ('trigger', 'frames', 'framesize'):
+            info[key] = int(val)
+        else:
+            info[key] = val
+
+    order = '<' if info.get('endian', 'little') == 'little' else '>'
+    dt = np.dtype({'names': names,
+                   'formats': formats,
+                   'offsets': offsets,
+                   'itemsize': info['framesize']}).newbyteorder(order)
+    frames = np.frombuffer(raw, dtype=dt, count=info['frames'], offset=pos)
+
+    data = {}
+    for name in names:
+        val = np.array(frames[name])
+        if name in info.get('fixed', []):
+            val = val / 65536.0
+        data[name] = val
+    return info, data
+
+def print_rec(fname):
+    """Print the trigger and the range of the signals of a dump
+
+    Call:
+    print_rec(fname)
+
+    """
+
+    info, data = load_rec(fname)
+    trig = info['trigger']
+    t = data['t']
+    print('%s: model %s, %d frames of %g s, trigger %s at t=%g' %
+          (fname, info['model'], info['frames'], info['tsamp'], info['reason'],
+           t[trig] if info['frames'] > 0 else 0.0))
+    for name in info['signals'][1:]:
+        val = data[name]
+        if val.size == 0:
+            continue
+        print('  %-30s min %-12g max %-12g at trigger %s' %
+              (name, val.min(), val.max(), val[trig]))
+
+if __name__ == '__main__':
+    for fname in sys.argv[1:]:
+        print_rec(fname)
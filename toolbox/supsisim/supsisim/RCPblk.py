@@ -6,6 +6,7 @@ michallenc@seznam.cz
 """
 
 from numpy import array, ones
+from os import environ
 import enum
 from typing_extensions import Self  # from typing import Self for 3.11+
 
@@ -50,7 +51,9 @@ class RcpParam:
         The parameter generates a SHV signal if its value is changed. The
         signal is generated as chng on method get. The parameter has to
         be visible to generate the signal. This is currently not supported
-        in C implementation of SHV tree in pysimCoder.
+        for parameters in C implementation of SHV tree in pysimCoder. Block
+        outputs can be streamed as chng signals by calling method subscribe
+        on their nodes (dynamic GAVL and GSA trees only).
         """
 
     def __init__(
@@ -70,6 +73,16 @@ class RcpParam:
     def __lt__(self, other: Self) -> bool:
         return self.type < other.type
 
+    def is_tunable(self) -> bool:
+        """The parameter can be modified while the model runs.
+
+        Only parameters editable over SHV can change, the others are
+        constant for the generated code.
+        """
+        return (environ.get("SHV_USED") == "True") and (
+            RcpParam.ShvFlag.EDITABLE in self.shv_flags
+        )
+
     def __str__(self) -> str:
         """String representation of the parameter"""
         str = (
@@ -104,6 +117,10 @@ class RCPblk:
         self.uy = array(uy)
         self.sysPath = ""
         self.no_fcn_call = False
+        self.folded = False  # Output computed once in the init function
+        self.ctype = 'double'  # C type of the outputs, see typeBlocks
+        self.loop = None  # Index of the algebraic loop, see detBlkSeq
+        self.critical = True  # False: skipped in degraded mode, see genCode
         self.params_list = params
 
     def __str__(self):
@@ -15,14 +15,119 @@ The following commands are provided:
   sch2blks       - Generate block list fron schematic
   
 """
-from numpy import  nonzero, ones, asmatrix, size, array, zeros
+from numpy import  nonzero, ones, asmatrix, size, array, zeros, eye
+from numpy.linalg import matrix_rank
 from os import environ
 import copy
 import sys
+from collections import deque
+from heapq import heapify, heappush, heappop
+from zlib import crc32
 from supsisim.RCPblk import RCPblk, RcpParam
 from .shv import ShvTreeGenerator
 
-def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel = 1e-6, rkstep = 10):
+# Blocks without side effects, optBlocks() removes them if nothing
+# observes their outputs
+PURE_FCNS = {
+    'absV', 'antideadzone', 'forward_clarke', 'inverse_clarke', 'constant', 'css',
+    'deadzone', 'der', 'discretePID', 'Div', 'dss', 'getTimer', 'integral', 'lut',
+    'minFromNInputs', 'maxFromNInputs', 'pysim_modulo', 'mxmult', 'forward_park',
+    'inverse_park', 'prod', 'rel', 'saturation', 'sinus', 'squareSignal', 'step',
+    'sum', 'sweep', 'switcher', 'switch_output', 'toNull', 'triangle', 'trigo',
+    'unitDelay', 'upow',
+}
+
+# Stateless blocks with direct feedthrough, constant inputs give constant outputs
+STATELESS_FCNS = {
+    'absV', 'forward_clarke', 'inverse_clarke', 'deadzone', 'Div', 'lut', 'pysim_modulo',
+    'mxmult', 'forward_park', 'inverse_park', 'prod', 'rel', 'saturation', 'sum', 'trigo',
+}
+
+# Blocks which never write their parameters and set all their outputs in
+# each CG_OUT, the memory planner puts their tables into flash and lets
+# their output nodes share storage
+PARAM_RO_FCNS = STATELESS_FCNS | {
+    'antideadzone', 'constant', 'minFromNInputs', 'maxFromNInputs', 'sinus',
+    'squareSignal', 'step', 'sweep', 'triangle', 'upow',
+}
+
+# Feedthrough blocks which can be evaluated several times in a sample, the
+# only ones allowed in algebraic loops
+LOOP_FCNS = STATELESS_FCNS | {'css', 'css_implicit', 'dss'}
+
+# Ports of conditionally executed subsystems
+PORT_FCNS = {'enable_port', 'trigger_port'}
+
+# Blocks with single precision and fixed point variants in common_dev
+TYPED_FCNS = {
+    'discretePID', 'dss', 'lut', 'mxmult', 'saturation', 'sum', 'trigo',
+}
+
+# Numeric types: function suffix, C type, conversions from and to double
+NUM_TYPES = {
+    'float': ('_f32', 'float', 'cnv_d2f', 'cnv_f2d'),
+    'fixed': ('_q16', 'pysim_q16', 'cnv_d2q', 'cnv_q2d'),
+}
+
+# Blocks with continuous states, integrated by the generated code
+CONT_FCNS = {'css', 'css_implicit', 'integral'}
+
+# Diagonal coefficient of the SDIRK2 stages, 1 - 1/sqrt(2)
+SDIRK2_GAMMA = 0.29289321881345248
+
+# Monitoring sinks, not needed by the control loop. With the degrade
+# overrun policy they are skipped while <model>_degraded is set, as the
+# blocks with critical = False (unchecked Critical Block in the editor).
+MONITOR_FCNS = {'led', 'logger', 'plot', 'plotJuggler', 'print', 'scope', 'toFile'}
+
+# Blocks with a slow CG_INIT (viewer start, socket connection) touching
+# only their own data, initialized on worker threads by pysim_init_run.
+# FMU, TCP and comedi blocks share static data or call gethostbyname and
+# are not in the set.
+PARALLEL_INIT_FCNS = {'led', 'scope', 'unixsockC', 'unixsockS'}
+
+# Blocks reporting their readiness to pysim_init_wait. The other device
+# blocks keep the fixed settle time of the platform at the start, see
+# pysim_init_settle.
+READY_FCNS = {'unixsockC', 'unixsockS'}
+
+# Device blocks (hardware and communication I/O). The outputs of those
+# with outputs are logged by the I/O record mode, a PYSIM_REPLAY build
+# calls pysim_io_replay_blk instead of all of them, see iolog.h
+DEVICE_FCNS = {
+    'comedi_analog_input', 'comedi_analog_output', 'comedi_digital_input',
+    'comedi_digital_output', 'comedi_encoder', 'comedi_pwm_generator', 'ImuAcc',
+    'ImuGyro', 'init_epos_Mot', 'mz_apo_DCmot', 'mz_apo_ENC', 'P3M_spi', 'pi_AD',
+    'pwm', 'serialIn', 'serialInFloat', 'serialOut', 'serialOutFloat', 'shmemIn',
+    'shmemOut', 'TCPsocketAsync', 'TCPsocketTxRx', 'UDPsocketRx', 'UDPsocketTx',
+    'unixsockC', 'unixsockS', 'zynq_3pmdrv1',
+}
+
+# The tables of the flight recorder, the I/O log and the hot swap are
+# generated inside #ifdef PYSIM_RT_TOOLS, defined by the templates of the
+# Linux mains only. Other targets do not link them.
+
+# Blocks keeping more states at the end of realPar than given by nx,
+# moved to a new version of the model by the hot swap
+STATE_PARS = {'compFilt': 2, 'der': 3, 'discretePID': 2}
+
+# Zero crossing functions of the memoryless blocks with discontinuities,
+# {u<i>} and {p<i>} stand for the inputs and the real parameters, a
+# function of {u} is repeated for each input
+ZC_FCNS = {
+    'absV': ['{u}'],
+    'deadzone': ['{u0} - {p0}', '{u0} - {p1}'],
+    'rel': ['{u0} - {u1}'],
+    'saturation': ['{u0} - {p0}', '{u0} - {p1}'],
+}
+
+# Target sizes used by the footprint report
+SIZEOF_DOUBLE = 8
+SIZEOF_INT = 4
+SIZEOF_PTR = 4
+
+def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel = 1e-6, rkstep = 10,
+            optimize = False, numType = 'double', loopIter = 10, loopTol = 1e-9):
     """Generate C-Code
 
     Call: genCode(model, Tsamp, Blocks, rkstep)
@@ -32,8 +137,16 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
     model     : Model name
     Tsamp     : Sampling Time
     Blocks    : Block list
-    rkMethod  : Numerical integration algoritm
+    rkMethod  : Numerical integration algoritm, 'standard RK4', 'implicit SDIRK2',
+                'variable step' or a GSL stepper. 'implicit SDIRK2' is implicit
+                in the A of each css block only, coupled blocks are not solved
+                as one system, see implicitBlock
     rkstep    : step division pro sample time for fixed step solverM
+    optimize  : Remove unused blocks, compute constant subgraphs at init
+                and plan the signal memory
+    numType   : Numeric type of the core blocks ('double', 'float', 'fixed')
+    loopIter  : Max. Newton iterations per sample of each algebraic loop
+    loopTol   : Tolerance of the algebraic loop solver
 
     Returns
     -------
@@ -57,23 +170,88 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
             else:
                 raise ValueError('Problem in diagram: outputs connected together!')
 
-    Blocks = detBlkSeq(maxNode, blocks)
+    if optimize:
+        blocks = optBlocks(maxNode, blocks)
+
+    # The SHV tree and its streams access the nodes and the parameters as
+    # doubles
+    if numType != 'double' and environ['SHV_USED'] == 'True':
+        print('Warning: numeric type %s ignored, SHV needs double nodes' % numType)
+        numType = 'double'
+    if numType != 'double':
+        blocks, maxNode = typeBlocks(maxNode, blocks, numType)
+
+    loops = []
+    Blocks = detBlkSeq(maxNode, blocks, loops)
     if size(Blocks) == 0:
         raise ValueError('No possible to determine the block sequence')
 
-    gslFlag = (rkMethod != 'standard RK4')
+    if rkMethod == 'implicit SDIRK2':
+        Blocks = [implicitBlock(blk, Tsamp / rkstep) for blk in Blocks]
+
+    vsFlag = (rkMethod == 'variable step')
+    gslFlag = rkMethod not in ('standard RK4', 'implicit SDIRK2', 'variable step')
     fn = model + '.c'
     f=open(fn,'w')
     strLn = '#include <pyblock.h>\n#include <stdio.h>\n#include <stdlib.h>\n'
     f.write(strLn)
+    if numType == 'fixed':
+        f.write('#include <pysim_num.h>\n')
+    if loops:
+        f.write('#include <algloop.h>\n')
+    parInit = any(blk.fcn in PARALLEL_INIT_FCNS for blk in Blocks)
+    if parInit:
+        f.write('#include <blkinit.h>\n')
+    f.write('#ifdef PYSIM_RT_TOOLS\n')
+    f.write('#include <flightrec.h>\n')
+    f.write('#include <iolog.h>\n')
+    f.write('#include <hotswap.h>\n')
+    f.write('#endif\n')
+    f.write('#include <stddef.h>\n')
     if gslFlag:
         f.write('#include <string.h>\n#include <gsl/gsl_odeiv2.h>\n#include <matop.h>\n\n')
+    elif vsFlag:
+        f.write('#include <string.h>\n#include <varstep.h>\n#include <matop.h>\n\n')
     else:
         f.write('\n')
 
 
     N = size(Blocks)
 
+    # Number of real and integer parameters of each block
+    nReal = [sum(param.type == RcpParam.Type.DOUBLE for param in blk.params_list) for blk in Blocks]
+    nInt = [sum(param.type == RcpParam.Type.INT for param in blk.params_list) for blk in Blocks]
+
+    contIntg = any(blk.fcn in CONT_FCNS for blk in Blocks)
+
+    # Conditions of the CG_OUT and CG_STUPD calls of each block
+    condOut, condUpd = [], []
+    for blk, conds in zip(Blocks, execConds(maxNode, Blocks)[0]):
+        out, upd = [], []
+        for c, kind in conds:
+            if kind == 'port':
+                expr = 'block_' + model + '[' + str(c) + '].intPar[0]'
+                upd.append(expr)
+                if blk.uy == 1:
+                    out.append(expr)
+            else:
+                out.append('switcher_select(&block_' + model + '[' + str(c) + ']) == ' + str(kind))
+        if not blk.critical or blk.fcn in MONITOR_FCNS:
+            out.append('!' + model + '_degraded')
+            upd.append('!' + model + '_degraded')
+        condOut.append(tuple(out))
+        condUpd.append(tuple(upd))
+
+    # Memory planner, parameters edited over SHV must stay in RAM and the
+    # SHV tree reads the nodes at any time
+    plan = optimize and environ['SHV_USED'] != 'True'
+    # Typed blocks keep their own copy of the parameters in ptrPar
+    constPar = [plan and (blk.fcn in PARAM_RO_FCNS or blk.ctype != 'double') for blk in Blocks]
+    if plan and not contIntg:
+        nodeSlot, poolSize = planNodes(maxNode, Blocks, condOut)
+    else:
+        nodeSlot, poolSize = {}, 0
+
     shv_generator = ShvTreeGenerator(f, model, Blocks)
     shv_generator.generate_header()
 
@@ -83,6 +261,13 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
     mctx += 'extern struct pysim_platform_model_ctx ' + model + '_pt_ctx;\n\n'
     f.write(mctx)
 
+    devFcns = sorted(set(blk.fcn for blk in Blocks if blk.fcn in DEVICE_FCNS))
+    if devFcns:
+        f.write('/* Device blocks, replaced by the I/O log in replay builds */\n')
+        f.write('#ifdef PYSIM_REPLAY\n')
+        f.writelines('#define ' + fcn + ' pysim_io_replay_blk\n' for fcn in devFcns)
+        f.write('#endif\n\n')
+
     # Generate the model's function prototypes
     f.write('/* Function prototypes */\n\n')
     prototypes  = "void " + model + "_init(void);\n"
@@ -104,6 +289,8 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
 
     for blk in Blocks:
         prototypes.append('void ' + blk.fcn + '(int Flag, python_block *block);\n')
+    if any(blk.fcn == 'switcher' for blk in Blocks):
+        prototypes.append('int switcher_select(python_block *block);\n')
     setProto = set(prototypes)
     for el in setProto:
         f.write(el)
@@ -119,9 +306,36 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
     strLn = 'python_block block_' + model + '[' + str(N) + '];\n\n'
     f.write(strLn)
 
+    devBlocks = [n for n in range(N) if Blocks[n].fcn in DEVICE_FCNS and len(Blocks[n].pout) != 0]
+    f.write('/* Device blocks with outputs, see iolog.h */\n')
+    f.write('#ifdef PYSIM_RT_TOOLS\n')
+    if devBlocks:
+        f.write('static python_block *const io_blocks_' + model + '[] = {' +
+                ', '.join('&block_' + model + '[' + str(n) + ']' for n in devBlocks) + '};\n')
+        f.write('static const char *const io_names_' + model + '[] = {' +
+                ', '.join('"' + cString(str(Blocks[n].name)) + '"' for n in devBlocks) + '};\n')
+        f.write('static const int io_nout_' + model + '[] = {' +
+                ', '.join(str(len(Blocks[n].pout)) for n in devBlocks) + '};\n')
+        f.write('const struct pysim_io_model ' + model + '_io = {"' + model + '", io_blocks_' +
+                model + ', io_names_' + model + ', io_nout_' + model + ', ' + str(len(devBlocks)) + '};\n')
+    else:
+        f.write('const struct pysim_io_model ' + model + '_io = {"' + model + '", NULL, NULL, NULL, 0};\n')
+    f.write('#endif\n\n')
+
+    f.write('/* Set by the platform to skip the non-critical blocks */\n')
+    f.write('int ' + model + '_degraded = 0;\n\n')
+
+    f.write('/* Set by the hot swap, called around the device blocks, see hotswap.h */\n')
+    f.write('#ifdef PYSIM_RT_TOOLS\n')
+    f.write('int (*' + model + '_swap_hook)(int flag, python_block *block) = NULL;\n')
+    f.write('#else\n')
+    f.write('#define ' + model + '_swap_hook ((int (*)(int flag, python_block *block)) NULL)\n')
+    f.write('#endif\n\n')
+    hook = '(' + model + '_swap_hook == NULL || !' + model + '_swap_hook('
+
     for n in range(N):
         blk: RCPblk = Blocks[n]
-        if sum(param.type == RcpParam.Type.DOUBLE for param in blk.params_list) != 0:
+        if nReal[n] != 0:
             values: str = ""
             names: str = ""
             values_num: int = 0
@@ -141,12 +355,23 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
                 names = ""
                 for i in range(values_num):
                     names += f'"double{i}", '
-            strLn = "static double realPar_" + str(n) +"[] = {"
+            if constPar[n]:
+                strLn = "static const double realPar_" + str(n) +"[] = {"
+            else:
+                strLn = "static double realPar_" + str(n) +"[] = {"
             strLn += values + "};\n"
-            strLn += "static char *realParNames_" + str(n) + "[] = {"
+            if constPar[n]:
+                strLn += "static char * const realParNames_" + str(n) + "[] = {"
+            else:
+                strLn += "static char *realParNames_" + str(n) + "[] = {"
             strLn += names + "};\n"
             f.write(strLn)
-        if sum(param.type == RcpParam.Type.INT for param in blk.params_list) != 0:
+            if environ['SHV_USED'] == 'True':
+                nPars = nReal[n] - stateSlots(blk, nReal[n])
+                if nPars > 0:
+                    f.write(shv_generator.generate_parset(n, ', '.join(values.split(', ')[:nPars]),
+                                                          nPars))
+        if nInt[n] != 0:
             values: str = ""
             names: str = ""
             values_num: int = 0
@@ -164,22 +389,45 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
                 names = ""
                 for i in range(values_num):
                     names += f'"int{i}", '
-            strLn = "static int intPar_" + str(n) +"[] = {"
+            if constPar[n]:
+                strLn = "static const int intPar_" + str(n) +"[] = {"
+            else:
+                strLn = "static int intPar_" + str(n) +"[] = {"
             strLn += values + "};\n"
-            strLn += "static char *intParNames_" + str(n) + "[] = {"
+            if constPar[n]:
+                strLn += "static char * const intParNames_" + str(n) + "[] = {"
+            else:
+                strLn += "static char *intParNames_" + str(n) + "[] = {"
             strLn += names + "};\n"
             f.write(strLn)
-        strLn = 'static int nx_' + str(n) +'[] = {'
+        if constPar[n]:
+            strLn = 'static const int nx_' + str(n) +'[] = {'
+        else:
+            strLn = 'static int nx_' + str(n) +'[] = {'
         strLn += str(asmatrix(blk.nx).tolist())[2:-2] + '};\n'
         f.write(strLn)
+        if blk.ctype != 'double' and nReal[n] != 0:
+            f.write('static ' + blk.ctype + ' typedPar_' + str(n) + '[] = {' +
+                    typedValues(blk) + '};\n')
     f.write('\n')
 
-    f.write('/* Nodes */\n')
-    for n in range(1,maxNode+1):
-        strLn = 'static double Node_' + str(n) + '[] = {0.0};\n'
-        f.write(strLn)
-
-    f.write('\n')
+    f.write('/* Nodes, in one block copied each sample by the flight recorder */\n')
+    usedNodes = set()
+    nodeType = {}
+    for blk in Blocks:
+        usedNodes.update(blk.pin)
+        usedNodes.update(blk.pout)
+        nodeType.update((n, blk.ctype) for n in blk.pout)
+    ownNodes = [n for n in range(1,maxNode+1) if n in usedNodes and n not in nodeSlot]
+    f.write('static struct ' + model + '_nodes {\n')
+    f.writelines('  ' + nodeType.get(n, 'double') + ' Node_' + str(n) + '[1];\n' for n in ownNodes)
+    if poolSize != 0:
+        f.write('  double NodePool[' + str(poolSize) + '];\n')
+    if not ownNodes and poolSize == 0:
+        f.write('  double none;\n')
+    f.write('} nodes_' + model + ';\n\n')
+
+    genRecorder(f, model, Blocks, ownNodes, nodeType, nReal, constPar)
 
     f.write('/* Input and outputs */\n')
     for n in range(0,N):
@@ -189,13 +437,13 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
         if (nin!=0):
             strLn = 'static void *inptr_' + str(n) + '[]  = {'
             for m in range(0,nin):
-                strLn += '&Node_' + str(blk.pin[m]) + ','
+                strLn += nodeRef(model, blk.pin[m], nodeSlot) + ','
             strLn = strLn[0:-1] + '};\n'
             f.write(strLn)
         if (nout!=0):
             strLn = 'static void *outptr_' + str(n) + '[] = {'
             for m in range(0,nout):
-                strLn += '&Node_' + str(blk.pout[m]) + ','
+                strLn += nodeRef(model, blk.pout[m], nodeSlot) + ','
             strLn = strLn[0:-1] + '};\n'
             f.write(strLn)
 
@@ -208,6 +456,22 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
         shv_generator.generate_init()
         shv_generator.generate_end()
 
+    if loops:
+        genLoops(f, model, Blocks, loops)
+
+    vsFlag = vsFlag and contIntg
+    if vsFlag:
+        genVarStep(f, model, Blocks, condOut, condUpd)
+
+    if parInit:
+        f.write('/* CG_INIT calls, see pysim_init_run */\n\n')
+        f.write('static struct pysim_init_job init_' + model + '[' + str(N) + '] = {\n')
+        f.writelines('  {' + Blocks[n].fcn + ', &block_' + model + '[' + str(n) + '], "' +
+                     cString(str(Blocks[n].name)) + '", ' +
+                     str(int(Blocks[n].fcn in PARALLEL_INIT_FCNS)) + ', ' +
+                     initConnect(Blocks[n]) + '},\n' for n in range(0,N))
+        f.write('};\n\n')
+
     f.write('/* Initialization function */\n\n')
     strLn = 'void ' + model + '_init(void)\n'
     strLn += '{\n'
@@ -223,7 +487,10 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
         strLn =  '  block_' + model + '[' + str(n) + '].nin  = ' + str(nin) + ';\n'
         strLn += '  block_' + model + '[' + str(n) + '].nout = ' + str(nout) + ';\n'
 
-        port = 'nx_' + str(n)
+        if constPar[n]:
+            port = '(int *) nx_' + str(n)
+        else:
+            port = 'nx_' + str(n)
         strLn += '  block_' + model + '[' + str(n) + '].nx   = ' + port + ';\n'
 
         if (nin == 0):
@@ -236,10 +503,14 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
         else:
             port = 'outptr_' + str(n)
         strLn += '  block_' + model + '[' + str(n) + '].y    = ' + port + ';\n'
-        if sum(param.type == RcpParam.Type.DOUBLE for param in blk.params_list) != 0:
+        if nReal[n] != 0 and constPar[n]:
+            par = '(double *) realPar_' + str(n)
+            parNames = '(char **) realParNames_' + str(n)
+            num = nReal[n]
+        elif nReal[n] != 0:
             par = 'realPar_' + str(n)
             parNames = 'realParNames_' + str(n)
-            num = sum(param.type == RcpParam.Type.DOUBLE for param in blk.params_list)
+            num = nReal[n]
         else:
             par = 'NULL'
             parNames = 'NULL'
@@ -247,10 +518,14 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
         strLn += '  block_' + model + '[' + str(n) + '].realPar = ' + par + ';\n'
         strLn += '  block_' + model + '[' + str(n) + '].realParNum = ' + str(num) + ';\n'
         strLn += '  block_' + model + '[' + str(n) + '].realParNames = ' + parNames + ';\n'
-        if sum(param.type == RcpParam.Type.INT for param in blk.params_list) != 0:
+        if nInt[n] != 0 and constPar[n]:
+            par = '(int *) intPar_' + str(n)
+            parNames = '(char **) intParNames_' + str(n)
+            num = nInt[n]
+        elif nInt[n] != 0:
             par = 'intPar_' + str(n)
             parNames = 'intParNames_' + str(n)
-            num = sum(param.type == RcpParam.Type.INT for param in blk.params_list)
+            num = nInt[n]
         else:
             par = 'NULL'
             parNames = 'NULL'
@@ -264,7 +539,10 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
                 str_param = param.value
                 break
         strLn += '  block_' + model + '[' + str(n) + '].str = ' + '"' + str_param + '"' + ';\n'
-        strLn += '  block_' + model + '[' + str(n) + '].ptrPar = NULL;\n'
+        if blk.ctype != 'double' and nReal[n] != 0:
+            strLn += '  block_' + model + '[' + str(n) + '].ptrPar = typedPar_' + str(n) + ';\n'
+        else:
+            strLn += '  block_' + model + '[' + str(n) + '].ptrPar = NULL;\n'
         f.write(strLn)
         f.write('\n')
     f.write('\n')
@@ -274,10 +552,37 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
 
     f.write('/* Set initial outputs */\n\n')
 
-    for n in range(0,N):
-        blk = Blocks[n]
-        strLn = '  ' + blk.fcn + '(CG_INIT, &block_' + model + '[' + str(n) + ']);\n'
-        f.write(strLn)
+    if parInit:
+        for n in range(0,N):
+            if Blocks[n].fcn in DEVICE_FCNS:
+                f.write('  init_' + model + '[' + str(n) + '].fcn = ' + hook + 'CG_INIT, &block_' +
+                        model + '[' + str(n) + '])) ? ' + Blocks[n].fcn + ' : NULL;\n')
+        f.write('  pysim_init_run(init_' + model + ', ' + str(N) + ');\n')
+    else:
+        for n in range(0,N):
+            call = Blocks[n].fcn + '(CG_INIT, &block_' + model + '[' + str(n) + ']);\n'
+            if Blocks[n].fcn in DEVICE_FCNS:
+                f.write('  if ' + hook + 'CG_INIT, &block_' + model + '[' + str(n) + ']))\n    ' + call)
+            else:
+                f.write('  ' + call)
+
+    if any(blk.folded for blk in Blocks):
+        f.write('\n/* Constant subgraphs */\n\n')
+        f.writelines('  ' + Blocks[n].fcn + '(CG_OUT, &block_' + model + '[' + str(n) + ']);\n'
+                     for n in range(0,N) if Blocks[n].folded)
+
+    if vsFlag:
+        f.write('\n  if (pysim_vstep_init(&' + model + '_vs, ' + model + '_VS_NX, ' + model + '_VS_NZC, ' +
+                str(epsAbs) + ', ' + str(epsRel) + ', ' + model + '_get_tsamp(), ' + model +
+                '_vs_fcn, NULL) < 0)\n')
+        f.write('    fprintf(stderr, "Variable step solver: out of memory\\n");\n')
+
+    for k, cut in enumerate(loops):
+        name = 'loop' + str(k) + ': ' + ' '.join(str(blk.name) for blk in Blocks if blk.loop == k)
+        f.write('\n  if (pysim_algloop_init(&' + model + '_loop[' + str(k) + '], "' + name + '", ' +
+                str(len(cut)) + ', ' + str(loopIter) + ', ' + str(loopTol) + ', ' + model + '_loop' +
+                str(k) + '_fcn, NULL) < 0)\n')
+        f.write('    fprintf(stderr, "Algebraic loop solver: out of memory\\n");\n')
     f.write('}\n\n')
 
     f.write('/* ISR function */\n\n')
@@ -285,13 +590,7 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
     strLn += '{\n'
     f.write(strLn)
 
-    contIntg = False
-    for n in range(0,N):
-        blk = Blocks[n]
-        if blk.fcn in ['css', 'integral']:
-            contIntg = True
-
-    if contIntg:
+    if contIntg and not vsFlag:
         f.write('int i;\n')
         f.write('double h;\n')
 
@@ -302,19 +601,26 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
 
     f.write('\n')
 
-    for n in range(0,N):
-        blk = Blocks[n]
-        strLn = '  ' + blk.fcn + '(CG_OUT, &block_' + model + '[' + str(n) + ']);\n'
-        f.write(strLn)
+    if environ['SHV_USED'] == 'True':
+        shv_generator.generate_parset_apply()
+
+    writeCalls(f, model, Blocks, [n for n in range(0,N) if not Blocks[n].folded],
+               'CG_OUT', condOut, '  ', model + '_swap_hook')
     f.write('\n')
 
-    if contIntg:
+    if vsFlag:
+        strLn = '  ' + model + '_vs_gather(' + model + '_vs.x);\n'
+        strLn += '  pysim_vstep_advance(&' + model + '_vs, t, t + ' + model + '_get_tsamp());\n'
+        strLn += '  ' + model + '_vs_scatter(' + model + '_vs.x);\n\n'
+        f.write(strLn)
+
+    if contIntg and not vsFlag:
         strLn = '  h = ' + model + '_get_tsamp()/' + str(rkstep) + ';\n\n'
         f.write(strLn)
 
         for n in range(0,N):
             blk = Blocks[n]
-            if blk.fcn in ['css', 'integral']:
+            if blk.fcn in CONT_FCNS:
                 if gslFlag:
                     nStates = blk.nx[0]
                     strLn = '  gsl_odeiv2_system sys' + str(n) + ' = {' + blk.fcn +'Func, NULL, ' + \
@@ -343,15 +649,13 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
 
         strLn = '  for(i=0;i<' + str(rkstep) + ';i++){\n'
         f.write(strLn)
-        for n in range(0,N):
-            blk = Blocks[n]
-            if blk.fcn in ['css', 'integral'] or (len(blk.pout) != 0 and blk.uy == 1):
-                strLn = '    ' + blk.fcn + '(CG_OUT, &block_' + model + '[' + str(n) + ']);\n'
-                f.write(strLn)
+        writeCalls(f, model, Blocks, [n for n in range(0,N) if Blocks[n].fcn in CONT_FCNS or
+                                      (len(Blocks[n].pout) != 0 and Blocks[n].uy == 1 and not Blocks[n].folded)],
+                   'CG_OUT', condOut, '    ')
 
         for n in range(0,N):
             blk = Blocks[n]
-            if blk.fcn in ['css', 'integral']:
+            if blk.fcn in CONT_FCNS:
                 if gslFlag:
                     nStates = blk.nx[0]
                     strLn = '    t0 = 0.0;\n'
@@ -370,17 +674,16 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
                     str(pos) + ']), y_' + str(n) + ', ' + str(nStates) + '*sizeof(double));\n'
                     f.write(strLn)
                 else:
-                    strLn = '    ' + blk.fcn + '(CG_STUPD, &block_' + model + '[' + str(n) + ']);\n'
-                    f.write(strLn)
+                    writeCalls(f, model, Blocks, [n], 'CG_STUPD', condUpd, '    ')
 
         strLn = '  }\n'
         f.write(strLn)
 
-    for n in range(0,N):
-        blk = Blocks[n]
-        if blk.nx[1] != 0:
-            strLn = '  ' + blk.fcn + '(CG_STUPD, &block_' + model + '[' + str(n) + ']);\n'
-            f.write(strLn)
+    writeCalls(f, model, Blocks, [n for n in range(0,N) if Blocks[n].nx[1] != 0],
+               'CG_STUPD', condUpd, '  ')
+
+    if environ['SHV_USED'] == 'True':
+        shv_generator.generate_stream_sample()
 
 
     f.write('}\n\n')
@@ -396,20 +699,40 @@ def genCode(model, Tsamp, blocks, rkMethod='standard_RK4', epsAbs = 1e-6, epsRel
 
     for n in range(0,N):
         blk = Blocks[n]
-        if blk.fcn in ['css', 'integral']:
+        if blk.fcn in CONT_FCNS:
             if gslFlag:
                 strLn = '  driver = (gsl_odeiv2_driver *) block_' + model + '[' + str(n) + '].ptrPar;\n'
                 strLn += '  gsl_odeiv2_driver_free(driver);\n'
             else:
                 strLn = '  ' + blk.fcn + '(CG_END, &block_' + model + '[' + str(n) + ']);\n'
             f.write(strLn)
+        elif blk.fcn in DEVICE_FCNS:
+            strLn = '  if ' + hook + 'CG_END, &block_' + model + '[' + str(n) + ']))\n'
+            strLn += '    ' + blk.fcn + '(CG_END, &block_' + model + '[' + str(n) + ']);\n'
+            f.write(strLn)
         else:
             strLn = '  ' + blk.fcn + '(CG_END, &block_' + model + '[' + str(n) + ']);\n'
             f.write(strLn)
 
+    if vsFlag:
+        strLn = '  fprintf(stderr, "Variable step solver: %lu steps, %lu rejected, %lu events, %lu evaluations\\n",\n'
+        strLn += '          ' + model + '_vs.steps, ' + model + '_vs.rejected, ' + model + '_vs.events, ' + \
+                 model + '_vs.fevals);\n'
+        strLn += '  pysim_vstep_end(&' + model + '_vs);\n'
+        f.write(strLn)
+
+    for k in range(len(loops)):
+        f.write('  pysim_algloop_report(&' + model + '_loop[' + str(k) + ']);\n')
+        f.write('  pysim_algloop_end(&' + model + '_loop[' + str(k) + ']);\n')
+
     f.write('}\n\n')
+
+    genSwap(f, model, Blocks, nReal)
     f.close()
 
+    if plan:
+        memReport(Blocks, nReal, nInt, constPar, nodeSlot, poolSize)
+
 def genMake(model, template, addObj = '', addCDefs = ''):
     """Generate the Makefile
 
@@ -445,10 +768,10 @@ def genMake(model, template, addObj = '', addCDefs = ''):
     f.write(mf)
     f.close()
 
-def detBlkSeq(Nodes, blocks):
-    """Generate the Block sequence for simulation and RT
+def optBlocks(Nodes, blocks):
+    """Remove unused blocks and find constant subgraphs
 
-    Call: detBlkSeq(Nodes, Blocks)
+    Call: optBlocks(Nodes, Blocks)
 
     Parameters
     ----------
@@ -457,106 +780,832 @@ def detBlkSeq(Nodes, blocks):
 
     Returns
     -------
-    Blocks    : List with the ordered blocks
+    Blocks    : List with the used blocks
 
+    Blocks outside PURE_FCNS have side effects and are kept together with
+    everything they depend on, the rest is dropped. Blocks driven only by
+    constants get the folded flag, their outputs are computed once at init.
+    Blocks with tunable parameters are never folded. The returned blocks
+    are copies, the blocks passed in are left as they are.
 """
-    class blkDep:
-        def __init__(self, block, blkL, nodeL):
-            self.block = block
-            self.block_in = []
-
-            if len(block.pin) != 0:
-                for node in block.pin:
-                    if nodeL[node].block_in[0].uy == 1:
-                        self.block_in.append(nodeL[node].block_in[0])
-
-
-        def __str__(self):
-            txt  = 'Block: ' + self.block.fcn.__str__() + '\n'
-            txt += 'Inputs\n'
-            for item in self.block_in:
-                txt += item.fcn + '\n'
-            txt += '\n'
-            return txt
-
-    class nodeClass:
-        def __init__(self, N):
-            self.PN = N
-            self.block_in = []
-            self.block_out = []
-
-        def __str__(self):
-            txt  = 'Node: ' + self.PN.__str__() + '\n'
-            txt += ' Blocks in:\n'
-            for item in self.block_in:
-                try:
-                    txt += item.fcn + '\n'
-                except:
-                    txt += 'None\n'
-            txt += ' Blocks out:\n'
-            for item in self.block_out:
-                try:
-                    txt += item.fcn + '\n'
-                except:
-                    txt += 'None\n'
-            return txt
-
-    def fillNodeList(nN,blks):
-        nL = []
-        nL.append(nodeClass(0))
-        for n in range(1, nN+1):
-            node = nodeClass(n)
-            nL.append(node)
-        for blk in blks:
-            for n in blk.pin:
-                nL[n].block_out.append(blk)
-            for n in blk.pout:
-                nL[n].block_in.append(blk)
-        return nL
+    driver = [None] * (Nodes + 1)
+    for i, blk in enumerate(blocks):
+        for n in blk.pout:
+            driver[n] = i
+
+    # Mark blocks observable from the blocks with side effects
+    used = [False] * len(blocks)
+    stack = [i for i, blk in enumerate(blocks) if blk.fcn not in PURE_FCNS]
+    for i in stack:
+        used[i] = True
+    while stack:
+        i = stack.pop()
+        for n in blocks[i].pin:
+            d = driver[n]
+            if d is not None and not used[d]:
+                used[d] = True
+                stack.append(d)
+
+    # Copies get the folded flag, the caller's blocks are not changed
+    kept = [copy.copy(blk) for i, blk in enumerate(blocks) if used[i]]
+    driver = [None] * (Nodes + 1)
+    for i, blk in enumerate(kept):
+        blk.folded = False
+        for n in blk.pout:
+            driver[n] = i
+
+    # Fold in a topological order, drivers of a block are decided first
+    folded = 0
+    for blk in detBlkSeq(Nodes, kept, []):
+        if any(param.is_tunable() for param in blk.params_list):
+            continue
+        if blk.fcn == 'constant':
+            blk.folded = True
+        elif blk.fcn in STATELESS_FCNS and len(blk.pin) != 0:
+            blk.folded = all(driver[n] is not None and kept[driver[n]].folded
+                             for n in blk.pin)
+        folded += blk.folded
+
+    print('Optimizer: %d unused blocks removed, %d blocks computed at init'
+          % (len(blocks) - len(kept), folded))
+    return kept
+
+def typeBlocks(Nodes, blocks, numType):
+    """Switch the core blocks to another numeric type
+
+    Call: typeBlocks(Nodes, Blocks, numType)
 
-    blks = []
-    blks2order = []
+    Parameters
+    ----------
+    Nodes     : Number of total nodes in diagram
+    blocks    : List with the unordered blocks
+    numType   : Key of NUM_TYPES
 
-    nodes = fillNodeList(Nodes, blocks)
+    Returns
+    -------
+    Blocks    : List with the typed blocks and the conversion blocks
+    Nodes     : Number of total nodes including the new ones
 
-    # First search block with no input and no output
+    Blocks from TYPED_FCNS are replaced by their typed variant unless they
+    have tunable parameters. A conversion block is inserted on each node
+    read by a block of another type than its driver.
+"""
+    suffix, ctype, toTyped, fromTyped = NUM_TYPES[numType]
 
+    Blocks = []
     for blk in blocks:
+        if blk.fcn in TYPED_FCNS and not any(param.is_tunable() for param in blk.params_list):
+            blk = copy.copy(blk)
+            blk.fcn += suffix
+            blk.ctype = ctype
+        Blocks.append(blk)
+
+    driverType = {}
+    for blk in Blocks:
+        driverType.update((n, blk.ctype) for n in blk.pout)
+
+    # One conversion per node and target type
+    cnvNode = {}
+    cnvBlocks = []
+    for i, blk in enumerate(Blocks):
+        pin = list(blk.pin)
+        for m, n in enumerate(pin):
+            if n not in driverType or driverType[n] == blk.ctype:
+                continue
+            if (n, blk.ctype) not in cnvNode:
+                Nodes += 1
+                cnv = RCPblk(toTyped if blk.ctype == ctype else fromTyped,
+                             [n], [Nodes], [0, 0], 1, [])
+                cnv.ctype = blk.ctype
+                cnv.name = 'cnv_' + str(n)
+                cnvNode[(n, blk.ctype)] = Nodes
+                cnvBlocks.append(cnv)
+            pin[m] = cnvNode[(n, blk.ctype)]
+        if pin != list(blk.pin):
+            blk = copy.copy(blk)
+            blk.pin = array(pin)
+            Blocks[i] = blk
+
+    typed = sum(blk.ctype != 'double' for blk in Blocks)
+    print('Numeric type %s: %d typed blocks, %d conversions'
+          % (numType, typed, len(cnvBlocks)))
+    return Blocks + cnvBlocks, Nodes
+
+def typedValues(blk):
+    """Initializer of the typed copy of the real parameters"""
+    values = []
+    for param in blk.params_list:
+        if param.type == RcpParam.Type.DOUBLE:
+            if param.is_list:
+                for row in asmatrix(param.value).tolist():
+                    values += row
+            else:
+                values.append(param.value)
+
+    strLn = ''
+    for v in values:
+        if blk.ctype == 'float':
+            s = '%.9g' % v
+            if '.' not in s and 'e' not in s:
+                s += '.0'
+            strLn += s + 'f, '
+            continue
+        q = int(round(v * 65536))
+        if q > 0x7fffffff or q < -0x80000000:
+            print('Warning: %s parameter %g out of the fixed point range' % (blk.name, v))
+            q = max(min(q, 0x7fffffff), -0x80000000)
+        strLn += str(q) + ', '
+    return strLn[:-2]
+
+def nodeRef(model, node, nodeSlot):
+    """Address of a node buffer in the generated code"""
+    if node in nodeSlot:
+        return '&nodes_' + model + '.NodePool[' + str(nodeSlot[node]) + ']'
+    return '&nodes_' + model + '.Node_' + str(node)
+
+def genRecorder(f, model, Blocks, ownNodes, nodeType, nReal, constPar):
+    """Generate the description of the model data for the flight recorder
+
+    Call: genRecorder(f, model, Blocks, ownNodes, nodeType, nReal, constPar)
+
+    The recorder copies the node block and the parameters of the blocks
+    with states (where the blocks keep them) each sample, see flightrec.h.
+    A signal is named after its driver block and output port. The nodes
+    of the pool share their buffers and are not recorded.
+"""
+    recType = {'double': 'd', 'float': 'f', 'pysim_q16': 'q'}
+    driver = {}
+    for blk in Blocks:
+        driver.update((n, str(blk.name) + '.y' + str(i)) for i, n in enumerate(blk.pout))
+
+    regions = ['{&nodes_' + model + ', sizeof(nodes_' + model + ')}']
+    signals = []
+    for n in ownNodes:
+        name = driver.get(n, 'Node_' + str(n))
+        signals.append('{"' + cString(name) + '", 0, offsetof(struct ' + model + '_nodes, Node_' +
+                       str(n) + '), \'' + recType.get(nodeType.get(n, 'double'), 'd') + '\', 1}')
+    for n, blk in enumerate(Blocks):
+        if (blk.nx[0] != 0 or blk.nx[1] != 0) and nReal[n] != 0 and not constPar[n] \
+           and blk.ctype == 'double':
+            signals.append('{"' + cString(str(blk.name) + '.realPar') + '", ' + str(len(regions)) +
+                           ', 0, \'d\', ' + str(nReal[n]) + '}')
+            regions.append('{realPar_' + str(n) + ', sizeof(realPar_' + str(n) + ')}')
+
+    f.write('/* Flight recorder */\n')
+    f.write('#ifdef PYSIM_RT_TOOLS\n')
+    f.write('static const struct pysim_rec_region rec_regions_' + model + '[] = {\n')
+    f.writelines('  ' + reg + ',\n' for reg in regions)
+    f.write('};\n')
+    f.write('static const struct pysim_rec_signal rec_signals_' + model + '[] = {\n')
+    f.writelines('  ' + sig + ',\n' for sig in signals)
+    if not signals:
+        f.write('  {NULL, 0, 0, 0, 0},\n')
+    f.write('};\n')
+    f.write('const struct pysim_rec_model ' + model + '_rec = {"' + model + '", ' +
+            'rec_regions_' + model + ', ' + str(len(regions)) +
+            ', rec_signals_' + model + ', ' + str(len(signals)) + '};\n')
+    f.write('#endif\n\n')
+
+def genSwap(f, model, Blocks, nReal):
+    """Generate the description of the model for the hot swap
+
+    Call: genSwap(f, model, Blocks, nReal)
+
+    A block keeps its states at the end of realPar, nx or STATE_PARS
+    give how many. The typed blocks work on a copy of the parameters and
+    their states are not transferred. The CRC of the parameters tells if
+    a device block can be taken over by a new version, see hotswap.h.
+"""
+    f.write('/* Hot swap */\n')
+    f.write('#ifdef PYSIM_RT_TOOLS\n')
+    f.write('static const struct pysim_swap_block swap_blocks_' + model + '[] = {\n')
+    for n, blk in enumerate(Blocks):
+        nstate = stateSlots(blk, nReal[n]) if blk.ctype == 'double' else 0
+        pars = repr([(p.name, p.type, p.value) for p in blk.params_list])
+        f.write('  {"' + cString(str(blk.name)) + '", "' + blk.fcn + '", &block_' + model + '[' +
+                str(n) + '], ' + str(nstate) + ', ' + str(int(blk.fcn in DEVICE_FCNS)) + ', ' +
+                hex(crc32(pars.encode())) + '},\n')
+    if not Blocks:
+        f.write('  {NULL, NULL, NULL, 0, 0, 0},\n')
+    f.write('};\n')
+    f.write('const struct pysim_swap_model ' + model + '_swap = {"' + model + '", swap_blocks_' +
+            model + ', ' + str(len(Blocks)) + ',\n')
+    f.write('  ' + model + '_init, ' + model + '_isr, ' + model + '_end, ' + model + '_get_tsamp, &' +
+            model + '_degraded,\n')
+    f.write('  &' + model + '_swap_hook, &' + model + '_rec};\n')
+    f.write('#endif\n')
+
+def stateSlots(blk, nReal):
+    """Number of states the block keeps at the end of its realPar
+
+    Call: stateSlots(blk, nReal)
+"""
+    nstate = STATE_PARS.get(blk.fcn, blk.nx[0] + blk.nx[1])
+    return nstate if nstate <= nReal else 0
+
+def cString(s):
+    """Text as the content of a C string literal"""
+    return s.replace('\\', '\\\\').replace('"', '\\"')
+
+def initConnect(blk):
+    """Connection of the block in the init table, see blkinit.h"""
+    if blk.fcn in READY_FCNS:
+        return 'PYSIM_INIT_REPORTS'
+    if blk.fcn in DEVICE_FCNS:
+        return 'PYSIM_INIT_SETTLE'
+    return 'PYSIM_INIT_LOCAL'
+
+def planNodes(Nodes, Blocks, condOut):
+    """Overlay node buffers with disjoint lifetimes
+
+    Call: planNodes(Nodes, Blocks, condOut)
+
+    Parameters
+    ----------
+    Nodes     : Number of total nodes in diagram
+    Blocks    : Blocks in the execution order given by detBlkSeq
+    condOut   : Conditions of the CG_OUT calls, see execConds
+
+    Returns
+    -------
+    nodeSlot  : Dictionary node -> slot in NodePool
+    poolSize  : Number of slots in NodePool
+
+    A node lives from the CG_OUT of its driver up to its last reader in the
+    same sample. Only nodes written unconditionally by PARAM_RO_FCNS blocks
+    and read by known blocks after their driver qualify, a reader with
+    discrete states keeps the node alive up to the state update at the end
+    of the sample. Other nodes keep their value between samples and get
+    their own buffer.
+
+    The solver of an algebraic loop evaluates all its blocks at the first of
+    them, as often as needed: the nodes read by the loop live up to its last
+    block and the nodes written by the loop get their own buffer, the cut
+    nodes start the next sample from their last value.
+"""
+    N = len(Blocks)
+    start = [None] * (Nodes + 1)
+    end = [None] * (Nodes + 1)
+    last = {}
+    for p, blk in enumerate(Blocks):
+        if blk.loop is not None:
+            last[blk.loop] = p
+        if blk.fcn in PARAM_RO_FCNS and not blk.folded and not condOut[p] and blk.loop is None:
+            for n in blk.pout:
+                start[n] = p
+                end[n] = p
+
+    for p, blk in enumerate(Blocks):
+        reader = blk.fcn in PURE_FCNS or blk.fcn == 'print'
+        for n in blk.pin:
+            if start[n] is None:
+                continue
+            if not reader or p <= start[n]:
+                start[n] = None
+            elif blk.nx[1] != 0:
+                end[n] = N
+            else:
+                end[n] = max(end[n], last.get(blk.loop, p))
+
+    # Greedy assignment in the order of the drivers, a slot is reused only
+    # after its last reader so a block never gets the same buffer for an
+    # input and an output
+    nodeSlot = {}
+    freeAt = []
+    for n in sorted((n for n in range(1, Nodes + 1) if start[n] is not None),
+                    key=lambda n: start[n]):
+        for k in range(len(freeAt)):
+            if freeAt[k] < start[n]:
+                break
+        else:
+            k = len(freeAt)
+            freeAt.append(0)
+        freeAt[k] = end[n]
+        nodeSlot[n] = k
+
+    return nodeSlot, len(freeAt)
+
+def memReport(Blocks, nReal, nInt, constPar, nodeSlot, poolSize):
+    """Print the RAM and flash footprint of the generated model
+
+    Call: memReport(Blocks, nReal, nInt, constPar, nodeSlot, poolSize)
+
+    Sizes are given for a 32 bit target, the block structures and the
+    code of the block functions are not included.
+"""
+    print('Memory: %-20s %-16s %8s %8s' % ('Block', 'Function', 'RAM', 'Flash'))
+    totRam = 0
+    totFlash = 0
+    for n, blk in enumerate(Blocks):
+        ptrs = (len(blk.pin) + len(blk.pout)) * SIZEOF_PTR
+        nodes = sum(m not in nodeSlot for m in blk.pout) * \
+                (SIZEOF_DOUBLE if blk.ctype == 'double' else SIZEOF_INT)
+        pars = nReal[n] * (SIZEOF_DOUBLE + SIZEOF_PTR) + \
+               (nInt[n] + len(blk.nx)) * SIZEOF_INT + nInt[n] * SIZEOF_PTR
+        ram = ptrs + nodes
+        if blk.ctype != 'double':
+            ram += nReal[n] * SIZEOF_INT
+        flash = 0
+        if constPar[n]:
+            flash += pars
+        else:
+            ram += pars
+        print('Memory: %-20s %-16s %8d %8d' % (blk.name, blk.fcn, ram, flash))
+        totRam += ram
+        totFlash += flash
+
+    totRam += poolSize * SIZEOF_DOUBLE
+    print('Memory: node pool %d slots for %d nodes, %d bytes saved'
+          % (poolSize, len(nodeSlot), (len(nodeSlot) - poolSize) * SIZEOF_DOUBLE))
+    print('Memory: total %d bytes RAM, %d bytes flash' % (totRam, totFlash))
+
+def implicitBlock(blk, h):
+    """Copy of a css block which integrates with the implicit SDIRK2 step
+
+    Call: implicitBlock(blk, h)
+
+    The continuous blocks are stepped one after the other with their inputs
+    held, each css block keeps the factorization of its own A matrix. The
+    blocks are not solved as one coupled system: stiffness coming from
+    feedback between css blocks, or through the blocks around them, is
+    still integrated explicitly.
+
+    The step h is stored in the block for the factorization at init, a
+    singular iteration matrix I - h*gamma*A is rejected here.
+"""
+    if blk.fcn != 'css':
+        return blk
+
+    intPar = {param.name: param.value for param in blk.params_list
+              if param.type == RcpParam.Type.INT}
+    nx = intPar['nx']
+    orig = [param for param in blk.params_list if param.type == RcpParam.Type.DOUBLE][0]
+    values = array(orig.value, dtype=float).reshape(-1)
+    a = values[intPar['indA']:intPar['indA'] + nx * nx].reshape(nx, nx)
+    if matrix_rank(eye(nx) - h * SDIRK2_GAMMA * a) < nx:
+        raise ValueError('Block ' + str(blk.name) + ': singular iteration matrix I - h*gamma*A')
+
+    blk = copy.copy(blk)
+    blk.fcn = 'css_implicit'
+    par = copy.copy(orig)
+    par.value = orig.value.copy()
+    par.value.flat[0] = h
+    blk.params_list = [par if param is orig else param for param in blk.params_list]
+    return blk
+
+def contStates(blk):
+    """Number of continuous states and their position in realPar"""
+    nStates = blk.nx[0]
+    realPar = [param for param in blk.params_list if param.type == RcpParam.Type.DOUBLE]
+    if len(realPar) == 1:
+        nrp = size(realPar[0].value[0])
+    else:
+        nrp = len(realPar)
+    return nStates, nrp - nStates
+
+def genVarStep(f, model, Blocks, condOut, condUpd):
+    """Generate the model functions used by the variable step solver
+
+    The derivatives are computed from the states of the css and integral
+    blocks through the memoryless feedthrough blocks they drive. All
+    other blocks keep their outputs between two sample hits.
+"""
+    N = len(Blocks)
+    blkRef = '&block_' + model + '['
+    cont = [n for n in range(N) if Blocks[n].fcn in CONT_FCNS]
+
+    consumers = {}
+    for n, blk in enumerate(Blocks):
+        for node in blk.pin:
+            consumers.setdefault(node, []).append(n)
+    cone = set()
+    stack = list(cont)
+    while stack:
+        n = stack.pop()
+        for node in Blocks[n].pout:
+            for c in consumers.get(node, []):
+                if c not in cone and branchBlock(Blocks[c]):
+                    cone.add(c)
+                    stack.append(c)
+
+    f.write('/* Variable step solver */\n\n')
+    f.write('static struct pysim_vstep ' + model + '_vs;\n\n')
+
+    scatter, gather = '', ''
+    pos = 0
+    for n in cont:
+        nStates, par = contStates(Blocks[n])
+        blkPar = 'block_' + model + '[' + str(n) + '].realPar[' + str(par) + ']'
+        scatter += '  memcpy(&' + blkPar + ', &x[' + str(pos) + '], ' + str(nStates) + '*sizeof(double));\n'
+        gather += '  memcpy(&x[' + str(pos) + '], &' + blkPar + ', ' + str(nStates) + '*sizeof(double));\n'
+        pos += nStates
+    nx = pos
+
+    zc = []
+    for n in sorted(cone):
+        blk = Blocks[n]
+        u = ['((double *) block_' + model + '[' + str(n) + '].u[' + str(i) + '])[0]'
+             for i in range(len(blk.pin))]
+        fields = {'u' + str(i): u[i] for i in range(len(u))}
+        for i in range(2):
+            fields['p' + str(i)] = 'block_' + model + '[' + str(n) + '].realPar[' + str(i) + ']'
+        for expr in ZC_FCNS.get(blk.fcn, []):
+            for ui in (u if '{u}' in expr else [None]):
+                zc.append('  g[' + str(len(zc)) + '] = ' + expr.format(u=ui, **fields) + ';\n')
+
+    strLn = '#define ' + model + '_VS_NX  ' + str(nx) + '\n'
+    strLn += '#define ' + model + '_VS_NZC ' + str(len(zc)) + '\n\n'
+    strLn += 'static void ' + model + '_vs_scatter(const double *x)\n{\n' + scatter + '}\n\n'
+    strLn += 'static void ' + model + '_vs_gather(double *x)\n{\n' + gather + '}\n\n'
+    strLn += 'static void ' + model + '_vs_fcn(double t, const double *x, double *dx, double *g, void *arg)\n{\n'
+    strLn += '  ' + model + '_vs_scatter(x);\n'
+    f.write(strLn)
+
+    writeCalls(f, model, Blocks, [n for n in range(N) if n in cone or
+                                  (n in cont and not Blocks[n].folded)], 'CG_OUT', condOut, '  ')
+
+    f.write('\n  if (dx != NULL) {\n')
+    pos = 0
+    for n in cont:
+        nStates = contStates(Blocks[n])[0]
+        strLn = '    ' + Blocks[n].fcn + 'Func(t, &x[' + str(pos) + '], &dx[' + str(pos) + '], ' + \
+                blkRef + str(n) + ']);\n'
+        if condUpd[n]:
+            strLn = '    if (' + ' && '.join(condUpd[n]) + ')\n  ' + strLn
+            strLn += '    else\n      memset(&dx[' + str(pos) + '], 0, ' + str(nStates) + '*sizeof(double));\n'
+        f.write(strLn)
+        pos += nStates
+    f.write('  }\n')
+
+    if zc:
+        f.write('\n  if (g != NULL) {\n')
+        f.writelines('  ' + z for z in zc)
+        f.write('  }\n')
+    f.write('}\n\n')
+
+def genLoops(f, model, Blocks, loops):
+    """Generate the model functions of the algebraic loops
+
+    The function of a loop writes the guesses to the cut nodes, calls the
+    blocks of the loop in their sequence and returns the new values of the
+    cut nodes, see algloop.h.
+"""
+    f.write('/* Algebraic loops */\n\n')
+    f.write('struct pysim_algloop ' + model + '_loop[' + str(len(loops)) + '];\n\n')
+    for k, cut in enumerate(loops):
+        strLn = 'static void ' + model + '_loop' + str(k) + \
+                '_fcn(const double *z, double *gz, void *arg)\n{\n'
+        for i, n in enumerate(cut):
+            strLn += '  nodes_' + model + '.Node_' + str(n) + '[0] = z[' + str(i) + '];\n'
+        for n, blk in enumerate(Blocks):
+            if blk.loop == k:
+                strLn += '  ' + blk.fcn + '(CG_OUT, &block_' + model + '[' + str(n) + ']);\n'
+        for i, n in enumerate(cut):
+            strLn += '  gz[' + str(i) + '] = nodes_' + model + '.Node_' + str(n) + '[0];\n'
+        strLn += '}\n\n'
+        f.write(strLn)
+
+def writeCalls(f, model, Blocks, idx, flag, cond, indent, hook=None):
+    """Write the calls of the blocks idx with the given flag
+
+    Consecutive blocks with the same conditions share one if statement.
+    The outputs of the blocks of an algebraic loop are computed by its
+    solver, called in place of the first of them. The hook, if given, is
+    called before the device blocks with inputs.
+"""
+    last = ()
+    solved = set()
+    for n in idx:
+        loop = Blocks[n].loop
+        if flag == 'CG_OUT' and loop is not None:
+            if loop in solved:
+                continue
+            solved.add(loop)
+        if cond[n] != last:
+            if last:
+                f.write(indent + '}\n')
+            if cond[n]:
+                f.write(indent + 'if (' + ' && '.join(cond[n]) + ') {\n')
+            last = cond[n]
+        if flag == 'CG_OUT' and loop is not None:
+            f.write(indent + ('  ' if last else '') + 'pysim_algloop_solve(&' + model + '_loop[' +
+                    str(loop) + ']);\n')
+        else:
+            ind = indent + ('  ' if last else '')
+            if hook and Blocks[n].fcn in DEVICE_FCNS and len(Blocks[n].pin) != 0:
+                f.write(ind + 'if (' + hook + ' != NULL)\n')
+                f.write(ind + '  ' + hook + '(' + flag + ', &block_' + model + '[' + str(n) + ']);\n')
+            f.write(ind + Blocks[n].fcn + '(' + flag + ', &block_' + model + '[' + str(n) + ']);\n')
+    if last:
+        f.write(indent + '}\n')
+
+def branchBlock(blk):
+    """True for blocks which can be skipped while a switch ignores them"""
+    fcn = blk.fcn
+    if blk.ctype != 'double':
+        fcn = fcn.rsplit('_', 1)[0]
+    return blk.uy == 1 and not blk.folded and (fcn in PARAM_RO_FCNS or fcn == 'cnv')
+
+def execConds(Nodes, blocks):
+    """Find the conditionally executed blocks
+
+    Call: execConds(Nodes, Blocks)
+
+    Parameters
+    ----------
+    Nodes     : Number of total nodes in diagram
+    blocks    : List of blocks
+
+    Returns
+    -------
+    conds     : For each block a list of (index, kind), the block runs when
+                the enable or trigger port at index is active (kind 'port')
+                or when the switcher at index selects input kind (0 or 1)
+    edges     : List of (before, after) pairs for the block sequence
+
+    Blocks with the sysPath of an enable or trigger port, or in a
+    subsystem nested in it, belong to its subsystem. A switch branch is the set of stateless blocks whose outputs
+    are read only by one data input of a switcher, directly or through
+    other blocks of the branch.
+"""
+    conds = [[] for blk in blocks]
+    edges = []
+
+    for i, blk in enumerate(blocks):
+        if blk.fcn in PORT_FCNS:
+            if blk.sysPath == '':
+                print('Warning: %s is not in a subsystem' % blk.name)
+                continue
+            for j, other in enumerate(blocks):
+                inside = other.sysPath == blk.sysPath or other.sysPath.startswith(blk.sysPath + '/')
+                if inside and other.fcn not in PORT_FCNS:
+                    conds[j].append((i, 'port'))
+                    if other.uy == 1:
+                        edges.append((i, j))
+
+    if not any(blk.fcn == 'switcher' for blk in blocks):
+        return conds, edges
+
+    driver = [None] * (Nodes + 1)
+    consumers = [[] for n in range(Nodes + 1)]
+    for i, blk in enumerate(blocks):
+        for n in blk.pout:
+            driver[n] = i
+        for n in blk.pin:
+            consumers[n].append(i)
+
+    for s, sw in enumerate(blocks):
+        if sw.fcn != 'switcher':
+            continue
+        ctrl = driver[sw.pin[2]]
+        for k in (0, 1):
+            # Grow the branch up to a fixpoint, a block joins once all
+            # readers of its outputs are in the branch
+            branch = set()
+            cand = [driver[sw.pin[k]]]
+            while cand:
+                grown = False
+                for d in cand:
+                    if d is None or d in branch or d == s or not branchBlock(blocks[d]):
+                        continue
+                    if all(c in branch or (c == s and n == sw.pin[k] and
+                                           list(sw.pin).count(n) == 1)
+                           for n in blocks[d].pout for c in consumers[n]):
+                        branch.add(d)
+                        grown = True
+                if not grown:
+                    break
+                cand = [driver[n] for d in branch for n in blocks[d].pin]
+            for d in branch:
+                conds[d].append((s, k))
+                if ctrl is not None and blocks[ctrl].uy == 1:
+                    edges.append((ctrl, d))
+
+    return conds, edges
+
+def detBlkSeq(Nodes, blocks, loops=None):
+    """Generate the Block sequence for simulation and RT
+
+    Call: detBlkSeq(Nodes, Blocks, loops)
+
+    Parameters
+    ----------
+    Nodes     : Number of total nodes in diagram
+    blocks    : List with the unordered blocks
+    loops     : List receiving the cut nodes of each algebraic loop, with
+                None an algebraic loop raises ValueError
+
+    Returns
+    -------
+    Blocks    : List with the ordered blocks
+
+    Blocks without direct feedthrough come first, they only need their
+    state. The remaining blocks are grouped into the strongly connected
+    components of their dependencies (Tarjan's algorithm) and the components
+    are sorted topologically (Kahn's algorithm): a component is scheduled
+    once all feedthrough blocks driving its inputs are scheduled. Ready
+    components are taken in the order of the former rotating list, so
+    the generated sequence does not change.
+    Conditionally executed blocks also wait for the block deciding about
+    their execution, see execConds.
+
+    A component with more than one block, or a block reading its own
+    output, is an algebraic loop. Its blocks are replaced by copies with
+    loop set to the index of the loop and ordered as if some of their
+    output nodes were cut, see cutLoop.
+"""
+    # Driving block and consumers of each node, by block index
+    driver = [None] * (Nodes + 1)
+    consumers = [[] for n in range(Nodes + 1)]
+    for i, blk in enumerate(blocks):
+        for n in blk.pout:
+            driver[n] = i
+        for n in blk.pin:
+            consumers[n].append(i)
+
+    blks = []
+    nosink = []
+    feed = []
+    for i, blk in enumerate(blocks):
         if blk.uy == 0:
             if len(blk.pin) == 0 and len(blk.pout) == 0:
-                blks.insert(0, blk)
-            else:
                 blks.append(blk)
+            else:
+                nosink.append(blk)
         else:
-            block = blkDep(blk, blocks, nodes)
-            blks2order.append(block)
-
-    # Order the remaining blocks
-    counter = 0
-    while len(blks2order) != counter:
-        blk = blks2order.pop(0)
-        if len(blk.block_in) == 0:
-            blks.append(blk.block)
-            counter = 0
-
-            try:
-                for node in blk.block.pout:
-                    for bk in nodes[node].block_out:
-                        el=[el for el in blks2order if el.block == bk]
-                        try:
-                            el[0].block_in.remove(blk.block)
-                        except:
-                            pass
-            except:
-                pass
+            feed.append(i)
+
+    # Blocks without inputs and outputs first, in reverse order
+    blks.reverse()
+    blks += nosink
+
+    # Dependencies between the feedthrough blocks, one entry per input
+    succ = {i: [] for i in feed}
+    for i in feed:
+        for n in blocks[i].pout:
+            succ[i] += [c for c in consumers[n] if blocks[c].uy != 0]
+    for i, j in execConds(Nodes, blocks)[1]:
+        if i in succ and j in succ:
+            succ[i].append(j)
+
+    comps = sccComps(feed, succ)
+    comp = {}
+    for k, members in enumerate(comps):
+        for i in members:
+            comp[i] = k
+
+    order = []
+    loopOf = {}
+    for k, members in enumerate(comps):
+        if len(members) == 1 and members[0] not in succ[members[0]]:
+            order.append(members)
+            continue
+        if loops is None or any(blocks[i].fcn not in LOOP_FCNS or blocks[i].ctype != 'double'
+                                for i in members):
+            for i in members:
+                print(blocks[i])
+            raise ValueError('Algeabric loop!')
+        seq, cut = cutLoop(blocks, members, consumers)
+        order.append(seq)
+        loopOf[k] = len(loops)
+        loops.append(cut)
+
+    indeg = [0] * len(comps)
+    for i in feed:
+        for c in succ[i]:
+            if comp[c] != comp[i]:
+                indeg[comp[c]] += 1
+
+    # Same order as the former rotating list of blocks: the next component
+    # is the first ready one after the last scheduled, wrapping around to
+    # the start of the list
+    pos = {i: p for p, i in enumerate(feed)}
+    first = [min(pos[i] for i in members) for members in comps]
+    ahead = [(first[k], k) for k in range(len(comps)) if indeg[k] == 0]
+    heapify(ahead)
+    behind = []
+    while ahead or behind:
+        if not ahead:
+            ahead, behind = behind, ahead
+        p, k = heappop(ahead)
+        if k in loopOf:
+            for i in order[k]:
+                blk = copy.copy(blocks[i])
+                blk.loop = loopOf[k]
+                blks.append(blk)
         else:
-            blks2order.append(blk)
-            counter += 1
-
-    # Check if remain blocks in blks2order -> Algeabric loop!
-    if len(blks2order) != 0:
-        for item in blks2order:
-            print(item.block)
-        raise ValueError('Algeabric loop!')
+            blks.append(blocks[order[k][0]])
+        for i in order[k]:
+            for c in succ[i]:
+                if comp[c] != k:
+                    indeg[comp[c]] -= 1
+                    if indeg[comp[c]] == 0:
+                        heappush(ahead if first[comp[c]] > p else behind,
+                                 (first[comp[c]], comp[c]))
 
     return blks
+
+def sccComps(nodes, succ):
+    """Strongly connected components of a graph (Tarjan's algorithm)
+
+    Call: sccComps(nodes, succ)
+
+    The graph is given by the successors succ[i] of each node i, the
+    recursion runs on an explicit stack.
+"""
+    index = {}
+    low = {}
+    onStack = set()
+    stack = []
+    comps = []
+    for root in nodes:
+        if root in index:
+            continue
+        work = [(root, 0)]
+        while work:
+            v, k = work.pop()
+            if k == 0:
+                index[v] = low[v] = len(index)
+                stack.append(v)
+                onStack.add(v)
+            for k in range(k, len(succ[v])):
+                w = succ[v][k]
+                if w not in index:
+                    work.append((v, k + 1))
+                    work.append((w, 0))
+                    break
+                if w in onStack:
+                    low[v] = min(low[v], index[w])
+            else:
+                if low[v] == index[v]:
+                    members = []
+                    while True:
+                        w = stack.pop()
+                        onStack.discard(w)
+                        members.append(w)
+                        if w == v:
+                            break
+                    comps.append(sorted(members))
+                if work:
+                    u = work[-1][0]
+                    low[u] = min(low[u], low[v])
+    return comps
+
+def cutLoop(blocks, members, consumers):
+    """Order the blocks of an algebraic loop
+
+    Call: cutLoop(blocks, members, consumers)
+
+    Returns
+    -------
+    seq       : Block indices in execution order
+    cut       : Cut nodes, their readers run before their driver
+
+    The blocks are sorted topologically inside the loop. When no block is
+    ready the output node read by most of the waiting blocks is cut, so a
+    loop usually needs only one cut node.
+"""
+    inside = set(members)
+    indeg = dict.fromkeys(members, 0)
+    for i in members:
+        for n in blocks[i].pout:
+            for c in consumers[n]:
+                if c in inside:
+                    indeg[c] += 1
+
+    seq = []
+    cut = []
+    done = set()
+    ready = deque(i for i in members if indeg[i] == 0)
+    while len(seq) < len(members):
+        if not ready:
+            best = None
+            for i in members:
+                if i in done:
+                    continue
+                for n in blocks[i].pout:
+                    if n in cut:
+                        continue
+                    waiting = sum(c in inside and c not in done for c in consumers[n])
+                    if waiting and (best is None or waiting > best[0]):
+                        best = (waiting, n)
+            cut.append(best[1])
+            for c in consumers[best[1]]:
+                if c in inside and c not in done:
+                    indeg[c] -= 1
+                    if indeg[c] == 0:
+                        ready.append(c)
+            continue
+
+        i = ready.popleft()
+        seq.append(i)
+        done.add(i)
+        for n in blocks[i].pout:
+            if n in cut:
+                continue
+            for c in consumers[n]:
+                if c in inside and c not in done:
+                    indeg[c] -= 1
+                    if indeg[c] == 0:
+                        ready.append(c)
+    return seq, cut
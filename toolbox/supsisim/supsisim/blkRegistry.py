@@ -0,0 +1,80 @@
+from supsisim.const import respath
+
+import importlib
+import os
+import sys
+
+class BlockRegistry:
+    """Names exported by the RCP block modules.
+
+    Every .py file in the subdirectories of resources/blocks/rcpBlk is
+    imported once, the names it exports are merged as "from X import *"
+    would do. On the next use only the files whose mtime changed are
+    imported again and new files are added, so editing or adding a custom
+    block needs no restart.
+    """
+    def __init__(self, path):
+        self.path = path
+        self.modules = {}
+        self.stamp = None
+        self.names = {}
+
+    def scan(self):
+        files = []
+        for el in sorted(os.listdir(self.path)):
+            d = os.path.join(self.path, el)
+            if not os.path.isdir(d):
+                continue
+            for f in sorted(os.listdir(d)):
+                if f.endswith('.py') and not f.startswith('__'):
+                    fn = os.path.join(d, f)
+                    files.append((el + '.' + f[:-3], os.stat(fn).st_mtime))
+        return files
+
+    def load(self, name, mtime):
+        try:
+            if name in self.modules:
+                mod = importlib.reload(self.modules[name][1])
+            else:
+                mod = importlib.import_module(name)
+        except Exception as e:
+            print('Import of block module ' + name + ' failed: ' + str(e))
+            self.modules.pop(name, None)
+            return
+        self.modules[name] = (mtime, mod)
+
+    def update(self):
+        files = self.scan()
+        if files == self.stamp:
+            return
+
+        importlib.invalidate_caches()
+        for name, mtime in files:
+            if self.modules.get(name, (None,))[0] != mtime:
+                self.load(name, mtime)
+
+        names = {}
+        for name, mtime in files:
+            if name not in self.modules:
+                continue
+            mod = self.modules[name][1]
+            pub = getattr(mod, '__all__', None)
+            if pub is None:
+                pub = [n for n in vars(mod) if not n.startswith('_')]
+            for n in pub:
+                names[n] = getattr(mod, n)
+        self.names = names
+        self.stamp = files
+
+    def namespace(self):
+        # Copy of the merged names, for the execution of a model script
+        self.update()
+        return dict(self.names)
+
+    def lookup(self, fcn):
+        # RCP function called by a block, from the first field of params
+        self.update()
+        f = self.names.get(fcn)
+        return f if callable(f) else None
+
+registry = BlockRegistry(respath + 'blocks/rcpBlk')
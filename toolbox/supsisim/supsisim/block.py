@@ -49,6 +49,7 @@ class Block(QGraphicsPathItem):
         self.scene.addItem(self)
         self.syspath = ''
         self.ident = -1
+        self.critical = True    # False: skipped in degraded mode, see RCPgen
 
         self.roundedBlocks = True
         
@@ -86,6 +87,7 @@ class Block(QGraphicsPathItem):
                 
         try:
             self.scene.blocks.add(self)
+            self.scene.labels[self.label.toPlainText()] += 1
         except:
             pass
             
@@ -197,6 +199,7 @@ class Block(QGraphicsPathItem):
 
     def remove(self):
         self.scene.blocks.remove(self)
+        self.scene.labels[self.label.toPlainText()] -= 1
         for thing in self.childItems():
             try:
                 thing.remove()
@@ -216,6 +219,7 @@ class Block(QGraphicsPathItem):
     def clone(self, pt):
         b = Block(None, self.scene, self.name, self.inp, self.outp, 
                       self.insetble, self.outsetble, self.icon, self.params, self.helpTxt, self.dims, self.flip)
+        b.critical = self.critical
         b.setPos(self.scenePos().__add__(pt))
 
     def setFlip(self, flip=None):
@@ -239,18 +243,17 @@ class Block(QGraphicsPathItem):
         self.flipLabel()
 
     def setLabel(self, p):
-        labels = set()
+        # The scene counts the labels of its blocks, the new block is
+        # added after its label is set
         try:
-            for b in self.scene.blocks:
-                if b != self:
-                    labels.add(b.label.toPlainText())
+            labels = self.scene.labels
             name = self.name
-            if name in labels:
+            if labels[name] > 0:
                 cnt = 0
                 while name and name[-1] in '0123456789':
                     name = name[:-1]
                 base = name
-                while name in labels:
+                while labels[name] > 0:
                     name = base + str(cnt)
                     cnt += 1
             self.name = name
@@ -277,7 +280,10 @@ class Block(QGraphicsPathItem):
         vals = [self.name, self.inp, self.outp, self.insetble, self.outsetble, 
                 self.icon, self.params, self.helpTxt, self.dims, self.flip, pos]
         keys = ['name', 'inp', 'outp', 'inset', 'outset', 'icon', 'params', 'help', 'dims', 'flip', 'pos']
-        return dict(zip(keys, vals))
+        blk = dict(zip(keys, vals))
+        if not self.critical:
+            blk['critical'] = False
+        return blk
 
     def getPorts(self):
         InP = []
@@ -300,6 +306,7 @@ class Block(QGraphicsPathItem):
                       self.insetble, self.outsetble, self.icon, self.params,
                       self.helpTxt, self.dims, self.flip)
         b.name = self.name
+        b.critical = self.critical
 
         inp1, outp1 = self.getPorts()
         inp2, outp2 = b.getPorts()
@@ -348,7 +355,8 @@ class Block(QGraphicsPathItem):
         return QPointF(x,y)
 
     def setSysPath(self,basepath):
-        self.syspath = f"{basepath}/{self.name}"
+        # Path of the subsystem holding the block, '' at the top level
+        self.syspath = basepath
 
     def getCodeName(self):
         return self.name + '_' + str(self.ident)
@@ -428,8 +436,9 @@ class Block(QGraphicsPathItem):
             py = p1.y() + dExt + dSpc*n
             p.setPos(px, py)
         try:        
-            self.scene.mainw.editor.redrawSelectedItems()
-            self.scene.mainw.editor.redrawNodes()
+            editor = self.scene.mainw.editor
+            editor.redrawSelectedItems()
+            editor.redrawNodes(editor.connectedPorts([self]))
         except:
             pass
         
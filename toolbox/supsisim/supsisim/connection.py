@@ -202,6 +202,25 @@ class Connection(QGraphicsPathItem):
             pass        
         self.update_path()
 
+    def setPath(self, path):
+        super(Connection, self).setPath(path)
+        sc = super(Connection, self).scene()
+        if sc is not None:
+            sc.connIndex.update(self)
+
+    def itemChange(self, change, value):
+        # Keep the connection index of the scene holding the item up to
+        # date, subsystems move connections between scenes
+        if change == QGraphicsItem.GraphicsItemChange.ItemSceneChange:
+            sc = super(Connection, self).scene()
+            if sc is not None:
+                sc.connIndex.remove(self)
+        elif change == QGraphicsItem.GraphicsItemChange.ItemSceneHasChanged:
+            sc = super(Connection, self).scene()
+            if sc is not None:
+                sc.connIndex.update(self)
+        return super(Connection, self).itemChange(change, value)
+
     def update_path(self):
         p = QPainterPath()
         p.moveTo(self.pos1)
@@ -443,7 +462,9 @@ class Connection(QGraphicsPathItem):
             else:
                 self.connPoints.remove(errPos[0])
         
-    def save(self):
+    def save(self, ids = None):
+        # ids maps the blocks to their IDs in the saved diagram, the
+        # ports are then stored as (block ID, port index)
         self.cleanPts()
         try:
             pos1 = (self.pos1.x(), self.pos1.y())
@@ -455,11 +476,17 @@ class Connection(QGraphicsPathItem):
             keys = ['pos1', 'pos2', 'points']
             vals = [pos1, pos2, points]
             
-            return dict(zip(keys, vals))
+            conn = dict(zip(keys, vals))
+            if ids is not None and self.port1.parent in ids and self.port2.parent in ids:
+                conn['src'] = (ids[self.port1.parent], self.port1.parent.getPorts()[1].index(self.port1))
+                conn['dst'] = (ids[self.port2.parent], self.port2.parent.getPorts()[0].index(self.port2))
+            return conn
         except:
             pass
 
-    def load(self, item, dx = 0.0, dy = 0.0):
+    def load(self, item, dx = 0.0, dy = 0.0, blocks = None):
+        # blocks maps the block IDs of the loaded diagram to the new blocks,
+        # connections without port references are matched by position
         try:
             pt1 = QPointF(item['pos1'][0], item['pos1'][1])
             pt2 = QPointF(item['pos2'][0], item['pos2'][1])
@@ -471,7 +498,14 @@ class Connection(QGraphicsPathItem):
                 pt = QPointF(el[0], el[1])+dpt
                 self.connPoints.append(pt)
             self.cleanPts()
-            self.update_ports_from_pos()
+            if blocks is not None and 'src' in item and 'dst' in item:
+                self.port1 = blocks[item['src'][0]].getPorts()[1][item['src'][1]]
+                self.port2 = blocks[item['dst'][0]].getPorts()[0][item['dst'][1]]
+                self.port1.connections.append(self)
+                self.port2.connections.append(self)
+                self.update_path()
+            else:
+                self.update_ports_from_pos()
         except:
             pass
             
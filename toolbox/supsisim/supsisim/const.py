@@ -16,6 +16,13 @@ DB = 4
 
 VERSION = 0.95
 
+# Version of the .dgm layout: 1 connections located by position only,
+# 2 block IDs and a netlist of port references
+DGM_FORMAT = 2
+
+# Edits kept in the undo history of a diagram
+UNDO_LEVELS = 200
+
 path = os.environ.get('PYSUPSICTRL') + '/'
 respath = path+'resources/'
 pycmd = 'jupyter qtconsole &'
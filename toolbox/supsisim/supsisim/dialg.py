@@ -97,6 +97,17 @@ class RTgenDlg(QDialog):
         self.epsAbs = QLineEdit('1e-6')
         self.epsRel = QLineEdit('1e-6')
 
+        self.optimize = QCheckBox('Optimize')
+        self.optimize.setToolTip('Remove unused blocks and compute constant subgraphs at init')
+
+        self.numType = QComboBox()
+        self.numType.addItems(['double', 'float', 'fixed'])
+        self.numType.setToolTip('Numeric type of the core blocks, fixed is Q16.16, double with SHV')
+
+        self.lab12 = QLabel('          loop iter')
+        self.loopIter = QLineEdit('10')
+        self.loopIter.setToolTip('Max. iterations per sample of the algebraic loop solver')
+
         pbOK = QPushButton('OK')
         pbCANCEL = QPushButton('CANCEL')
         grid = QGridLayout()
@@ -130,9 +141,13 @@ class RTgenDlg(QDialog):
 
         grid.addWidget(lab8, 7, 0)
         grid.addWidget(self.Ts, 7, 1)
+        grid.addWidget(self.optimize, 7, 2)
 
         grid.addWidget(lab9, 8, 0)
         grid.addWidget(self.Tf, 8, 1)
+        grid.addWidget(self.numType, 8, 2)
+        grid.addWidget(self.lab12, 7, 3)
+        grid.addWidget(self.loopIter, 8, 3)
 
         grid.addWidget(pbOK, 9, 0)
         grid.addWidget(pbCANCEL, 9, 1)
@@ -202,7 +217,7 @@ class SHVDlg(QDialog):
         self.SHVmount = QLineEdit('')
         lab9 = QLabel('SHV Tree Type')
         self.SHVtree = QComboBox()
-        self.SHVtree.addItems(['GAVL', 'GSA', 'GSA_STATIC'])
+        self.SHVtree.addItems(['GAVL', 'GAVL_LAZY', 'GSA', 'GSA_STATIC'])
 
         pbOK = QPushButton('OK')
         pbCANCEL = QPushButton('CANCEL')
@@ -51,6 +51,8 @@ class Editor(QObject):
         copyBlkAction = self.menuIOBlk.addAction('Copy Block')
         deleteBlkAction = self.menuIOBlk.addAction('Delete Block')
         shvBlkAction = self.menuIOBlk.addAction('Tune parameters')
+        self.criticalBlkAction = self.menuIOBlk.addAction('Critical Block')
+        self.criticalBlkAction.setCheckable(True)
         
         self.menuSubsBlk = QMenu()
         opensubsBlkAction = self.menuSubsBlk.addAction('Open subsystem')
@@ -73,6 +75,7 @@ class Editor(QObject):
         namesubBlkAction.triggered.connect(self.nameBlock)
         deletesubBlkAction.triggered.connect(self.deleteBlock)
         shvBlkAction.triggered.connect(self.shvAction)
+        self.criticalBlkAction.triggered.connect(self.criticalBlock)
         
         self.subMenuConn = QMenu()
         connAddAction = self.subMenuConn.addAction('Add connection')
@@ -124,26 +127,34 @@ class Editor(QObject):
     # Menu actions for blocks and subblocks
     
     def parBlock(self):
-        self.scene.DgmToUndo()
+        self.scene.DgmToUndo([self.scene.item])
         ok = self.scene.mainw.parBlock()
         if not ok:
             self.scene.clearLastUndo()
     
     def flipBlock(self):
-        self.scene.DgmToUndo()
+        self.scene.DgmToUndo([self.scene.item])
         item = self.scene.item
         item.flip = not item.flip
         item.setFlip()
         
+    def criticalBlock(self):
+        # Non-critical blocks are skipped by the degrade overrun policy
+        self.scene.DgmToUndo([self.scene.item])
+        item = self.scene.item
+        item.critical = not item.critical
+
     def nameBlock(self):
-        self.scene.DgmToUndo()
+        self.scene.DgmToUndo([self.scene.item])
         item = self.scene.item
         dialog = BlockName_Dialog(self.scene.mainw)
         dialog.name.setText(item.name)
         res = dialog.exec()
         if res == 1:
+            self.scene.labels[item.label.toPlainText()] -= 1
             item.name = str(dialog.name.text())
             item.label.setPlainText(item.name)
+            self.scene.labels[item.name] += 1
             w = item.label.boundingRect().width()
             item.label.setPos(-w/2, item.h/2+5)
         else:
@@ -165,7 +176,7 @@ class Editor(QObject):
             pars = exec(cmd)
 
         except:
-            self.scene.DgmToUndo()
+            self.scene.DgmToUndo([item])
             pars = pDlg.parsDialog(item.params, item.helpTxt)
 
             if pars != item.params:
@@ -174,7 +185,7 @@ class Editor(QObject):
                 self.scene.clearLastUndo()
             
     def cloneBlock(self):
-        self.scene.DgmToUndo()
+        self.scene.DgmToUndo([])
         item = self.scene.item
         item.clone(QPointF(DP, DP))
 
@@ -185,7 +196,7 @@ class Editor(QObject):
         self.mainw.copyAct()
 
     def pasteBlock(self):
-        self.scene.DgmToUndo()
+        self.scene.DgmToUndo([])
         try:
             msg = QApplication.clipboard().text()
             data = json.loads(msg)
@@ -213,7 +224,7 @@ class Editor(QObject):
             pass
        
     def deleteBlock(self):
-        self.scene.DgmToUndo()
+        self.scene.DgmToUndo([self.scene.item])
         item = self.scene.item
         item.remove()
         self.removeNodes()
@@ -291,6 +302,7 @@ class Editor(QObject):
                 params = pars
                 items = params.split('|')
 
+                connection.begin_parameters()
                 for i in range(1,len(items)):
                     par = items[i].split(':')
                     parameter = par[1]
@@ -303,13 +315,14 @@ class Editor(QObject):
                     else:
                         continue
                     connection.set_parameter_value(par[0], name, parameter)
+                connection.commit_parameters()
             else:
                 self.scene.clearLastUndo()
     
     # Subsystems
 
     def createSubsystem(self):
-        self.scene.DgmToUndo()
+        self.scene.DgmToUndo(self.scene.selectedItems())
         # Create subsystem Block        
                 
         blocks = []
@@ -369,7 +382,8 @@ class Editor(QObject):
  
     def deleteConn(self):
         try:
-            self.scene.DgmToUndo()
+            c = self.scene.item
+            self.scene.DgmToUndo([c.port1.parent, c.port2.parent])
             self.scene.item.remove()
             self.removeNodes()
             self.redrawNodes()
@@ -377,8 +391,8 @@ class Editor(QObject):
             pass
         
     def addConn(self):
-        self.scene.DgmToUndo()
         c = self.scene.item
+        self.scene.DgmToUndo([c.port1.parent])
         posMouse = self.gridPos(self.scene.evpos)
         self.conn = Connection(None, self.scene)
         self.conn.port1 = c.port1
@@ -479,6 +493,11 @@ class Editor(QObject):
         items =  self.scene.items(rect)
         return items
 
+    def itemsNear(self, pos):
+        # Hit test through the BSP index of the scene, callers looking for
+        # several kinds of items at one position share the result
+        return self.scene.items(QRectF(pos-QPointF(DB,DB), QSizeF(2*DB,2*DB)))
+
     def itemByDraw(self, pos):
         rect = QRectF(pos-QPointF(DB,DB), QSizeF(2*DB,2*DB))
         items =  self.scene.items(QRectF(pos-QPointF(DB,DB), QSizeF(2*DB,2*DB)))
@@ -489,22 +508,25 @@ class Editor(QObject):
 #                 return item
         return None
     
-    def findInPortAt(self, pos):
-        items =  self.scene.items(QRectF(pos-QPointF(DB,DB), QSizeF(2*DB,2*DB)))
+    def findInPortAt(self, pos, items = None):
+        if items is None:
+            items = self.itemsNear(pos)
         for el in items:
             if isinstance(el, InPort):
                 return el
         return None
 
-    def findOutPortAt(self, pos):
-        items =  self.scene.items(QRectF(pos-QPointF(DB,DB), QSizeF(2*DB,2*DB)))
+    def findOutPortAt(self, pos, items = None):
+        if items is None:
+            items = self.itemsNear(pos)
         for el in items:
             if isinstance(el, OutPort):
                 return el
         return None
 
-    def findBlockAt(self, pos):
-        items =  self.scene.items(QRectF(pos-QPointF(DB,DB), QSizeF(2*DB,2*DB)))
+    def findBlockAt(self, pos, items = None):
+        if items is None:
+            items = self.itemsNear(pos)
         for el in items:
             if isinstance(el, Block):
                 return el
@@ -517,38 +539,31 @@ class Editor(QObject):
         pt2Y = max(p1.y(), p2.y())+delta
         return QRectF(QPointF(pt1X,pt1Y), QPointF(pt2X, pt2Y))
             
+    def connectionHit(self, c, pos):
+        points = [c.pos1]
+        for el in c.connPoints:
+            points.append(el)
+        points.append(c.pos2)
+        N = len(points)
+        for n in range(0,N-1):
+            p1 = points[n]
+            p2 = points[n+1]
+            rect = self.setRect(p1, p2, DB)
+            if rect.contains(pos):
+                return True
+        return False
+
     def findConnectionAt(self, pos):
-        items =  self.scene.items(QRectF(pos-QPointF(DB,DB), QSizeF(2*DB,2*DB)))
-        for c in items:
-            if isinstance(c, Connection):
-                points = [c.pos1]
-                for el in c.connPoints:
-                    points.append(el)
-                points.append(c.pos2)
-                N = len(points)
-                for n in range(0,N-1):
-                    p1 = points[n]
-                    p2 = points[n+1]
-                    rect = self.setRect(p1, p2, DB)
-                    if rect.contains(pos):
-                        return c
+        # Candidates from the segment grid of the scene
+        for c in self.scene.connIndex.connectionsAt(pos):
+            if self.connectionHit(c, pos):
+                return c
         return None
     
     def findOtherConnectionAt(self, pos, orig_c):
-        items =  self.scene.items(QRectF(pos-QPointF(DB,DB), QSizeF(2*DB,2*DB)))
-        for c in items:
-            if isinstance(c, Connection) and isinstance(c.port1, OutPort):
-                points = [c.pos1]
-                for el in c.connPoints:
-                    points.append(el)
-                points.append(c.pos2)
-                N = len(points)
-                for n in range(0,N-1):
-                    p1 = points[n]
-                    p2 = points[n+1]
-                    rect = self.setRect(p1, p2, DB)
-                    if rect.contains(pos):
-                        return c               
+        for c in self.scene.connIndex.connectionsAt(pos):
+            if isinstance(c.port1, OutPort) and self.connectionHit(c, pos):
+                return c
         return None
 
     def deleteSelected(self):
@@ -558,14 +573,18 @@ class Editor(QObject):
         dgmSubsystems = []                
         
         items = self.scene.selectedItems()
+        blocks = list(items)
+        for item in items:
+            if isinstance(item, Connection):
+                blocks += [item.port1.parent, item.port2.parent]
+        self.scene.DgmToUndo(blocks)
         for item in items:
             if isinstance(item, subsBlock):
                 dgmSubsystems.append(item)
             elif isinstance(item, Block):
                 dgmBlocks.append(item)
             elif isinstance(item, Connection):
-                self.scene.item = item
-                self.deleteConn()
+                item.remove()
             else:
                 pass
         for item in dgmBlocks:
@@ -630,13 +649,15 @@ class Editor(QObject):
             
             node = Node(None, self.scene)
             node.setPos(pos)
+            return node
         except:
-            pass
+            return None
 
     def redrawNodesFromPort(self, p):
+        nodes = []
         N = len(p.connections)
         for n in range(0,N):
-            if p.connections[n].port2.parent in self.scene.items():
+            if QGraphicsItem.scene(p.connections[n].port2.parent) is self.scene:
                 pts1 = [p.connections[n].pos1]
                 for el in p.connections[n].connPoints:
                     pts1.append(el)
@@ -647,22 +668,46 @@ class Editor(QObject):
                         pts2.append(el)
                     pts2.append(p.connections[m].pos2)
                 try:
-                    self.setNode(pts1, pts2)
+                    node = self.setNode(pts1, pts2)
+                    if node is not None:
+                        nodes.append(node)
                 except:
                     pass
-               
-    def redrawNodes(self):
-        self.removeNodes()
-        for item in self.scene.items():
+        if nodes:
+            self.scene.nodes[p] = nodes
+
+    def connectedPorts(self, blocks):
+        # Output ports driving the connections of the blocks, only their
+        # nodes change when the blocks move
+        ports = set()
+        for item in blocks:
             if isinstance(item, Block):
                 for p in item.childItems():
-                    if isinstance(p, OutPort):
-                        if len(p.connections) > 1:
-                            self.redrawNodesFromPort(p) 
+                    if isinstance(p, Port):
+                        for c in p.connections:
+                            if isinstance(c.port1, OutPort):
+                                ports.add(c.port1)
+        return ports
+
+    def redrawNodes(self, ports = None):
+        # Recompute the nodes of the given output ports, or all of them
+        self.removeNodes(ports)
+        if ports is None:
+            ports = []
+            for item in self.scene.items():
+                if isinstance(item, Block):
+                    for p in item.childItems():
+                        if isinstance(p, OutPort):
+                            ports.append(p)
+        for p in ports:
+            if len(p.connections) > 1:
+                self.redrawNodesFromPort(p)
                                             
-    def removeNodes(self):
-        for el in self.scene.items():
-            if isinstance(el, Node):
+    def removeNodes(self, ports = None):
+        if ports is None:
+            ports = list(self.scene.nodes.keys())
+        for p in ports:
+            for el in self.scene.nodes.pop(p, []):
                 el.remove()
                 
     # Positions functions
@@ -677,9 +722,10 @@ class Editor(QObject):
                 
     def setMouseInitDraw(self, pos):
         pointer = Qt.CursorShape.ArrowCursor
-        itemB = self.findBlockAt(pos)
-        itemOP = self.findOutPortAt(pos)
-        itemIP = self.findInPortAt(pos)
+        items = self.itemsNear(pos)
+        itemB = self.findBlockAt(pos, items)
+        itemOP = self.findOutPortAt(pos, items)
+        itemIP = self.findInPortAt(pos, items)
         itemC = self.findConnectionAt(pos)
         if isinstance(itemB, Block):
             pointer = Qt.CursorShape.ArrowCursor
@@ -723,22 +769,23 @@ class Editor(QObject):
                 item.setSelected(True)
             except:
                 pass
-        self.scene.updateDgm()
+        self.scene.updateDgm(self.scene.selectedItems())
  
     def P01(self, obj, event):                                     
         # IDLE, ITEMSELECTED + LEFTMOUSEPRESSED
         # Look for connections and ports and begin drawing from them
         item = self.findConnectionAt(event.scenePos())
+        items = self.itemsNear(event.scenePos())
         if item != None:
             self.scene.currentItem = item
             self.currentPos = event.scenePos()
             self.deselect_all()
-            self.scene.DgmToUndo()
+            self.scene.DgmToUndo([item.port2.parent])
             self.state = MOVECONN
 
-        elif self.findOutPortAt(event.scenePos()) != None:
-            item = self.findOutPortAt(event.scenePos())
-            self.scene.DgmToUndo()
+        elif self.findOutPortAt(event.scenePos(), items) != None:
+            item = self.findOutPortAt(event.scenePos(), items)
+            self.scene.DgmToUndo([item.parent])
             self.state = DRAWFROMOUTPORT
             self.conn = Connection(None, self.scene)
             self.mainw.view.setDragMode(QGraphicsView.DragMode.NoDrag)
@@ -747,9 +794,9 @@ class Editor(QObject):
             self.conn.pos2 = self.gridPos(item.scenePos())
             self.firstTime = True
             
-        elif self.findInPortAt(event.scenePos()) != None:
-            item = self.findInPortAt(event.scenePos())
-            self.scene.DgmToUndo()
+        elif self.findInPortAt(event.scenePos(), items) != None:
+            item = self.findInPortAt(event.scenePos(), items)
+            self.scene.DgmToUndo([item.parent])
             self.state = DRAWFROMINPORT
             self.conn = Connection(None, self.scene)
             self.mainw.view.setDragMode(QGraphicsView.DragMode.NoDrag)
@@ -759,6 +806,10 @@ class Editor(QObject):
             self.firstTime = True
             
         else:
+            # The selected blocks may be dragged, the moves are undoable
+            blocks = self.scene.selectedItems()
+            blocks.append(self.findBlockAt(event.scenePos(), items))
+            self.scene.undo.begin(blocks)
             self.state = LEFTMOUSEPRESSED
             
     def P02(self, obj, event):                                     
@@ -782,6 +833,7 @@ class Editor(QObject):
             if isinstance(item, subsBlock):
                 self.menuSubsBlk.exec(event.screenPos())
             else:
+                self.criticalBlkAction.setChecked(item.critical)
                 self.menuIOBlk.exec(event.screenPos())
                 
         elif conn:                
@@ -832,12 +884,13 @@ class Editor(QObject):
     def P06(self, obj, event):                                     
         # LEFTMOUSEPRESSED + MOUSEMOVE
         self.redrawSelectedItems()
-        self.removeNodes()
+        self.removeNodes(self.connectedPorts(self.scene.selectedItems()))
                         
     def P07(self, obj, event):                                      
         # LEFTMOUSEPRESSED + MOUSERELEASED        
         self.redrawSelectedItems()
-        self.redrawNodes()
+        self.redrawNodes(self.connectedPorts(self.scene.selectedItems()))
+        self.scene.undo.close()
         if self.scene.selectedItems():
             self.state = ITEMSELECTED
         else:
@@ -865,7 +918,7 @@ class Editor(QObject):
         # DRAWFROMOUTPORT + RIGHTMOUSEPRESSED, KEY_ESC
         try:
             self.conn.remove()
-            self.scene.undoDgm()
+            self.scene.clearLastUndo()
         except:
             pass
         self.conn = None
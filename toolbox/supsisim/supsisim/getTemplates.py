@@ -1,11 +1,12 @@
 fixed_step =  ['gsl_odeiv2_step_rk2', 'gsl_odeiv2_step_rk4' ]
 variable_step = ['gsl_odeiv2_step_rkf45', 'gsl_odeiv2_step_rkck', 'gsl_odeiv2_step_rk8pd', \
                    'gsl_odeiv2_step_msadams']
-embedded =  ['standard RK4']
+embedded =  ['standard RK4', 'implicit SDIRK2']
+simulation = ['variable step']
 
 dictTemplates = {
-                 'sim.tmf' : embedded + fixed_step + variable_step,
-                 'fmusim.tmf' : embedded + fixed_step + variable_step,
+                 'sim.tmf' : embedded + simulation + fixed_step + variable_step,
+                 'fmusim.tmf' : embedded + simulation + fixed_step + variable_step,
                  'rt_nrt_iopl.tmf': embedded + fixed_step,
                  'rt.tmf' : embedded + fixed_step,
                  'fmurt.tmf' : embedded + fixed_step,
@@ -19,15 +19,9 @@ class Port(QGraphicsPathItem):
     def setup(self):
         pass
 
-    def itemChange(self, change, value):
-#        if change == self.ItemScenePositionHasChanged:
-        if change == QGraphicsItem.GraphicsItemFlag.ItemSendsScenePositionChanges:
-            for conn in self.connections:
-                try:
-                    conn.update_pos_from_ports()
-                except AttributeError:
-                    self.connections.remove(conn)
-        return value
+    # Ports do not send scene position changes, Qt checks every such item
+    # of the scene on each move of a block. The editor updates the
+    # connections of the moved blocks.
 
     def is_connected(self, other_port):
         for conn in self.connections:
@@ -63,7 +57,6 @@ class InPort(Port):
         self.p.lineTo(0.0,0.0)
         self.p.lineTo(-PW, PW)
         self.setPath(self.p)
-        self.setFlag(QGraphicsItem.GraphicsItemFlag.ItemSendsScenePositionChanges)
 
 class OutPort(Port):
     def __init__(self, parent, scene):
@@ -83,4 +76,3 @@ class OutPort(Port):
         self.p.lineTo(PW,0.0)
         self.p.lineTo(0.0, PW)
         self.setPath(self.p)
-        self.setFlag(QGraphicsItem.GraphicsItemFlag.ItemSendsScenePositionChanges)
@@ -128,6 +128,12 @@ class NewEditorMainWindow(QMainWindow):
                                              statusTip = 'Undo',
                                              triggered = self.undoAct)
 
+        self.redoAction = QAction(QIcon(mypath+'redo.png'),
+                                             '&Redo', self,
+                                             shortcut = 'Ctrl+Y',
+                                             statusTip = 'Redo',
+                                             triggered = self.redoAct)
+
         self.updateAction = QAction(QIcon(mypath+'refresh.png'),
                                              '&Update Diagram', self,
                                              shortcut = 'Ctrl+U',
@@ -204,6 +210,7 @@ class NewEditorMainWindow(QMainWindow):
         toolbarE.addAction(self.copyAction)
         toolbarE.addAction(self.pasteAction)
         toolbarE.addAction(self.undoAction)
+        toolbarE.addAction(self.redoAction)
         #toolbarE.addAction(self.updateAction)
 
         toolbarS = self.addToolBar('Simulation')
@@ -244,6 +251,7 @@ class NewEditorMainWindow(QMainWindow):
         editMenu.addAction(self.copyAction)
         editMenu.addAction(self.pasteAction)
         editMenu.addAction(self.undoAction)
+        editMenu.addAction(self.redoAction)
         editMenu.addSeparator()
         editMenu.addAction(self.updateAction)
 
@@ -285,24 +293,7 @@ class NewEditorMainWindow(QMainWindow):
                     dgmConnections.append(item)
                 
         data = {}
-        
-        blk = []
-        for item in dgmBlocks:
-            b = item.save()
-            blk.append(b)
-        data['blocks'] = blk
-
-        conn = []
-        for item in dgmConnections:
-            c = item.save()
-            conn.append(c)
-        data['connections'] = conn
-
-        subs = []
-        for item in dgmSubsystems:
-            s = item.save()
-            subs.append(s)
-        data['subsystems'] = subs
+        self.scene.itemsToDict(data, dgmBlocks, dgmSubsystems, dgmConnections)
         
         msg = json.dumps(data)
         clipboard = QApplication.clipboard()
@@ -313,7 +304,7 @@ class NewEditorMainWindow(QMainWindow):
         self.editor.deleteSelected()
             
     def pasteAct(self):
-        self.scene.DgmToUndo()
+        self.scene.DgmToUndo([])
         try:
             msg = QApplication.clipboard().text()
             data = json.loads(msg)
@@ -323,6 +314,9 @@ class NewEditorMainWindow(QMainWindow):
         
     def undoAct(self):
          self.scene.undoDgm()
+
+    def redoAct(self):
+         self.scene.redoDgm()
     
     def updateAct(self):
         self.scene.updateDgm()
@@ -498,11 +492,6 @@ class NewEditorMainWindow(QMainWindow):
         return Scene(self)
 
     def closeEvent(self,event):          
-        try:
-            os.remove('tmp.py')
-        except:
-            pass
-            
         if self.modified and self.notSubsystem:
             ret = self.askSaving()
             if ret == QMessageBox.StandardButton.Save:
@@ -4,18 +4,23 @@ from supsisim.block import Block
 from supsisim.subsblock import subsBlock
 from supsisim.port import Port, InPort, OutPort
 from supsisim.connection import Connection
+from supsisim.spatial import SegmentIndex
+from supsisim.undo import UndoStack
 from supsisim.dialg import RTgenDlg, SHVDlg, UpdimgDlg
-from supsisim.const import VERSION, pyrun, TEMP, respath, BWmin
+from supsisim.const import VERSION, DGM_FORMAT, respath, BWmin
 from supsisim.getTemplates import dictTemplates
 from supsisim.RCPblk import RcpParam
+from supsisim.blkRegistry import registry
 from .shv import ShvClient, SHVInstance
 from lxml import etree
 import os
 import io
 import subprocess
+import traceback
 import time
 import json
 import re
+from collections import Counter
 
 
 IDLE = 0
@@ -47,6 +52,9 @@ class Scene(QGraphicsScene):
         self.selection = []
         self.currentItem = None
         self.blocks = set()
+        self.labels = Counter()
+        self.connIndex = SegmentIndex()
+        self.nodes = {}
 
         self.template = 'sim.tmf'
         self.intgMethod = 'standard RK4'
@@ -59,13 +67,16 @@ class Scene(QGraphicsScene):
         self.script = ''
         self.Tf = '10'
         self.prio = ''
+        self.optimize = False
+        self.numType = 'double'
+        self.loopIter = '10'
 
         self.SHV = SHVInstance(self.mainw.filename)
         self.updimgCtx = self.UpdimgContext("openocd", "")
 
         self.brokerConnection = ShvClient()
 
-        self.undoList = []
+        self.undo = UndoStack(self)
 
     def dragMoveEvent(self, event):
         if event.mimeData().hasText():
@@ -78,7 +89,7 @@ class Scene(QGraphicsScene):
 
     def dropEvent(self,event):
         if event.mimeData().hasText():
-            self.DgmToUndo()
+            self.DgmToUndo([])
             msg = event.mimeData().text()
             blk = json.loads(msg)
             blk['pos'] = (event.scenePos().x(), event.scenePos().y())
@@ -88,12 +99,13 @@ class Scene(QGraphicsScene):
         # Transform the block diagram into a python dict
         init = {'code': 'pysimCoder',
                 'ver' : VERSION,
+                'format' : DGM_FORMAT,
                 'date' : time.strftime("%d.%m.%Y - %H:%M:%S"),
             }
         dataDict['init'] = init
 
-        keys = ['template', 'Ts', 'AddObj', 'AddCDefs', 'AddMakeArgs', 'script', 'intgMethod', 'epsAbs', 'epsRel', 'Tf', 'prio']
-        vals = [self.template, self.Ts, self.addObjs, self.addCDefs, self.addMakeArgs, self.script, self.intgMethod, self.epsAbs, self.epsRel, self.Tf, self.prio]
+        keys = ['template', 'Ts', 'AddObj', 'AddCDefs', 'AddMakeArgs', 'script', 'intgMethod', 'epsAbs', 'epsRel', 'Tf', 'prio', 'optimize', 'numType', 'loopIter']
+        vals = [self.template, self.Ts, self.addObjs, self.addCDefs, self.addMakeArgs, self.script, self.intgMethod, self.epsAbs, self.epsRel, self.Tf, self.prio, self.optimize, self.numType, self.loopIter]
         dataDict['simulate'] = dict(zip(keys, vals))
 
         keys = ['used', 'ip', 'port', 'user', 'passwd', 'devid', 'mount', 'tree', 'updates']
@@ -123,21 +135,32 @@ class Scene(QGraphicsScene):
             else:
                 pass
 
+        self.itemsToDict(dataDict, dgmBlocks, dgmSubsystem, dgmConnections)
+
+    def itemsToDict(self, dataDict, dgmBlocks, dgmSubsystem, dgmConnections):
+        # Blocks and subsystems are numbered in the order they are saved,
+        # the connections refer to their ports by these IDs
+        ids = {}
+        for item in dgmBlocks + dgmSubsystem:
+            ids[item] = len(ids)
+
         blk = []
         for item in dgmBlocks:
             b = item.save()
+            b['id'] = ids[item]
             blk.append(b)
         dataDict['blocks'] = blk
 
         conn = []
         for item in dgmConnections:
-            c = item.save()
+            c = item.save(ids)
             conn.append(c)
         dataDict['connections'] = conn
 
         subs = []
         for item in dgmSubsystem:
             s = item.save()
+            s['block']['id'] = ids[item]
             subs.append(s)
         dataDict['subsystems'] = subs
 
@@ -150,6 +173,9 @@ class Scene(QGraphicsScene):
                         conn.remove()
             self.removeItem(item)
         self.blocks.clear()
+        self.labels.clear()
+        self.connIndex.clear()
+        self.nodes.clear()
 
     def getBlock(self, item):
         pos = (float(item.findtext('posX')), float(item.findtext('posY')))
@@ -196,6 +222,9 @@ class Scene(QGraphicsScene):
             self.prio = dataDict['simulate']['prio']
         except:
             pass
+        self.optimize = dataDict.get('simulate', {}).get('optimize', False)
+        self.numType = dataDict.get('simulate', {}).get('numType', 'double')
+        self.loopIter = dataDict.get('simulate', {}).get('loopIter', '10')
 
         """
         We need to access SHV field with try/except to keep support
@@ -220,21 +249,26 @@ class Scene(QGraphicsScene):
         except:
             pass
 
+        blocks = {}
         try:
             for item in dataDict['blocks']:
-                self.loadBlock(item, dx, dy)
+                b = self.loadBlock(item, dx, dy)
+                if 'id' in item:
+                    blocks[item['id']] = b
         except:
             pass
 
         try:
             for item in dataDict['subsystems']:
-                self.loadSubsystem(item, dx, dy)
+                b = self.loadSubsystem(item, dx, dy)
+                if 'id' in item['block']:
+                    blocks[item['block']['id']] = b
         except:
             pass
 
         try:
             for item in dataDict['connections']:
-                self.loadConn(item, dx, dy)
+                self.loadConn(item, dx, dy, blocks)
         except:
             pass
 
@@ -248,11 +282,13 @@ class Scene(QGraphicsScene):
                 item['inset'], item['outset'], item['icon'],
                 item['params'], item['help'], item['dims'], item['flip'] )
 
+        b.critical = item.get('critical', True)
         b.setPos(item['pos'][0]+dx, item['pos'][1]+dy)
+        return b
 
-    def loadConn(self, item, dx = 0.0, dy = 0.0):
+    def loadConn(self, item, dx = 0.0, dy = 0.0, blocks = None):
         c = Connection(None, self)
-        c.load(item, dx, dy)
+        c.load(item, dx, dy, blocks)
 
     def loadSubsystem(self, subs, dx = 0, dy = 0):
         item = subs['block']
@@ -262,30 +298,33 @@ class Scene(QGraphicsScene):
 
         b.setPos(item['pos'][0]+dx, item['pos'][1]+dy)
         b.load(subs)
+        return b
 
     def clearLastUndo(self):
-        if len(self.undoList) > 1:
-            msg = self.undoList.pop()
+        self.undo.discard()
 
-    def DgmToUndo(self):
-        fileDict = {}
+    def DgmToUndo(self, items = None):
+        # Start recording an edit of the given blocks, new blocks and the
+        # connections of all of them are found when the edit is closed.
+        # Without items the whole diagram is saved.
         self.mainw.modified = True
-        self.DgmToDict(fileDict)
-        self.undoList.append(fileDict)
+        self.undo.begin(items)
 
     def undoDgm(self):
-        if len(self.undoList) > 1:
-            dgm = self.undoList.pop()
-        else:
-            dgm = self.undoList[0]
+        self.undo.undo()
+        if self.undo.atStart():
             self.mainw.modified = False
+        self.mainw.editor.state = IDLE
 
-        self.clearDgm()
-        self.DictToDgm(dgm)
+    def redoDgm(self):
+        if self.undo.redo():
+            self.mainw.modified = True
         self.mainw.editor.state = IDLE
 
-    def updateDgm(self):
-        items = self.items()
+    def updateDgm(self, items = None):
+        # Snap the blocks to the grid, by default all of them
+        if items is None:
+            items = self.items()
 
         for item in items:
             if isinstance(item, Block):
@@ -312,8 +351,17 @@ class Scene(QGraphicsScene):
         fileDict = json.loads(msg)
         self.clearDgm()
 
+        fmt = fileDict.get('init', {}).get('format', 1)
+        if fmt > DGM_FORMAT:
+            print('Diagram format %d is newer than %d, connections may be lost' % (fmt, DGM_FORMAT))
+
         self.DictToDgm(fileDict)
-        self.undoList = [fileDict]
+
+        if fmt < DGM_FORMAT:
+            # One-time migration, the connections were matched by position
+            # and the next save writes the netlist
+            print('Diagram converted from format %d to %d' % (fmt, DGM_FORMAT))
+        self.undo.clear()
 
     def find_itemAt(self, pos):
         items = self.items(QRectF(pos-QPointF(1,1), QSizeF(3,3)))
@@ -343,6 +391,9 @@ class Scene(QGraphicsScene):
         dialog.parscript.setText(self.script)
         dialog.Tf.setText(self.Tf)
         dialog.prio.setText(self.prio)
+        dialog.optimize.setChecked(self.optimize)
+        dialog.numType.setCurrentText(self.numType)
+        dialog.loopIter.setText(self.loopIter)
         res = dialog.exec()
         if res != 1:
             return
@@ -358,6 +409,9 @@ class Scene(QGraphicsScene):
         self.script = str(dialog.parscript.text())
         self.prio =  str(dialog.prio.text())
         self.Tf = str(dialog.Tf.text())
+        self.optimize = dialog.optimize.isChecked()
+        self.numType = str(dialog.numType.currentText())
+        self.loopIter = str(dialog.loopIter.text())
 
     def SHVSetDlg(self):
         dialog = SHVDlg(self)
@@ -421,10 +475,7 @@ class Scene(QGraphicsScene):
         items = []
         for item in scene.items():
             if isinstance(item, subsBlock):
-                blk = item.getInternalBlocks()
-                for el in blk:
-                    el.setSysPath(f'/{item.name}')
-                    items.append(el)
+                items += item.getInternalBlocks(f'/{item.name}')
             elif isinstance(item, Block):
                 item.setSysPath('')
                 items.append(item)
@@ -561,7 +612,12 @@ class Scene(QGraphicsScene):
                                 raise ValueError('Problem in diagram: outputs connected together!')
                         thing.nodeID = c.port1.nodeID
 
-            self.generateCCode(dgmBlocks)
+            for item in dgmBlocks:
+                fcn = item.params.split('|')[0]
+                if registry.lookup(fcn) is None:
+                    raise ValueError('Block ' + item.name + ': unknown RCP function ' + fcn)
+
+            script, body = self.generateCCode(dgmBlocks)
 
             self.mainw.statusLabel.setText('Code generation OK!')
             try:
@@ -569,10 +625,10 @@ class Scene(QGraphicsScene):
             except:
                 pass
             if flag:
-                cmd = pyrun + ' tmp.py'
                 try:
-                    subprocess.run(cmd, shell=True, check=True)
-                except subprocess.CalledProcessError:
+                    self.runCode(script, body)
+                except Exception:
+                    traceback.print_exc()
                     self.mainw.statusLabel.setText("Failed to compile generated code!")
                     del(dgmBlocks)
                     return False
@@ -581,10 +637,24 @@ class Scene(QGraphicsScene):
             del(dgmBlocks)
             return True
 
-        except:
+        except Exception as e:
+            print(e)
             self.mainw.statusLabel.setText('Error by Code generation!')
             return False
 
+    def runCode(self, script, body):
+        # Run the model script in this process. The user script comes
+        # first, then the names of the block modules from the registry,
+        # as the star imports of the old temporary script did.
+        ns = {'__name__': '__pysim__'}
+        cwd = os.getcwd()
+        try:
+            exec(compile(script, self.script or '<script>', 'exec'), ns)
+            ns.update(registry.namespace())
+            exec(compile(body, self.mainw.filename + '.dgm', 'exec'), ns)
+        finally:
+            os.chdir(cwd)
+
     def blkInstance(self, item):
         def _recheck_param(tocheck) -> RcpParam.Type:
             """
@@ -687,35 +757,23 @@ class Scene(QGraphicsScene):
 
         txt += ')'
         txt = txt.replace('(, ', '(')
+        if not item.critical:
+            txt += '\n' + blk_name + '.critical = False'
         return txt, txt_param
 
     def generateCCode(self, items):
+        # Returns the user script and the model script, runCode executes
+        # them with the block functions of the registry
         try:
             f = open(self.script,'r')
-            txt = f.read()
+            script = f.read()
             f.close()
-            txt += '\n'
+            script += '\n'
         except:
-            txt = ''
-
-        dir1 = respath + 'blocks/rcpBlk'
-        txt += 'import os\n\n'
-
-        txt += 'from supsisim.RCPblk import RCPblk, RcpParam\n\n'
-        txt += 'dirs = os.listdir("' + dir1 + '")\n'
-        txt += 'for el in dirs:\n'
-        txt += '    files = os.listdir("' + dir1 + '" + "/" + el)\n'
-        txt += '    for f in files:\n'
-        txt += '        if not f.endswith(".py"):\n'
-        txt += '            continue\n'
-        txt += '        f = f.rstrip("*.py")\n'
-        txt += '        if True: #try:\n'
-        txt += '            cmd = "from " + el + "." + f + " import *"\n'
-        txt += '            exec(cmd)\n'
-        txt += '        #except:\n'
-        txt += '        #    print("import of block class failed " + cmd)\n'
-        txt += '        #    pass\n'
+            script = ''
 
+        txt = 'import os\n\n'
+        txt += 'from supsisim.RCPblk import RCPblk, RcpParam\n'
         txt += 'from supsisim.RCPgen import *\n'
         txt += 'from control import *\n'
 
@@ -724,13 +782,14 @@ class Scene(QGraphicsScene):
         for item in items:
             if isinstance(item, Block):
                 blkList.append(item.getCodeName().replace(' ','_'))
+                sysPathList.append(item.syspath)
                 blk_text, param_text = self.blkInstance(item)
                 if param_text is not None:
                     txt += param_text + '\n'
                 txt += blk_text + '\n\n'
 
         fname = self.mainw.filename
-        with open('tmp.py', 'w') as fn:
+        with io.StringIO() as fn:
             fn.write(txt + '\n')
 
             for item in blkList:
@@ -765,7 +824,8 @@ class Scene(QGraphicsScene):
             fn.write('fname = ' + "'" + fname + "'\n")
             fn.write('os.chdir("'+ fnm +'")\n')
             fn.write('genCode(fname, ' + self.Ts + ', blks, ' + "'" + self.intgMethod + "', " + \
-                    self.epsAbs + ', ' + self.epsRel +')\n')
+                    self.epsAbs + ', ' + self.epsRel + ', optimize = ' + str(self.optimize) + \
+                    ", numType = '" + self.numType + "', loopIter = " + self.loopIter + ")\n")
             fn.write("genMake(fname, '" + self.template + "', addObj = '" +
                   self.addObjs + "', addCDefs = '" + self.parsedAddCDefs + "')\n")
             fn.write('\nimport os\n')
@@ -773,29 +833,17 @@ class Scene(QGraphicsScene):
             fn.write('if (os.system("make")) != 0:\n')
             fn.write('  raise RuntimeError("C code compilation failed")\n')
             fn.write('os.chdir("..")\n')
+            return script, fn.getvalue()
 
     def simrun(self):
-        if self.codegen(False):
-            cmd  = '\n'
-            cmd += 'import matplotlib.pyplot as plt\n'
-            cmd += 'import numpy as np\n\n'
+        if self.codegen(True):
             prio = self.prio.replace(' ','')
             if prio != '':
                 prio = ' -p ' + prio
-            cmd += 'os.system("./' + self.mainw.filename + prio + ' -f ' + self.Tf + '")\n'
             fnm = self.mainw.filename
-            cmd += 'os.system("' + 'rm -r ' + fnm + ' ' + fnm + '_gen' + '" )'
-
-            try:
-                os.mkdir(TEMP + '/' + self.mainw.filename + '_gen')
-            except:
-                pass
-            f = open('tmp.py','a')
-            f.write(cmd)
-            f.close()
-            cmd = pyrun + ' tmp.py'
             try:
-                os.system(cmd)
+                os.system('./' + fnm + prio + ' -f ' + self.Tf)
+                os.system('rm -r ' + fnm + ' ' + fnm + '_gen')
                 self.mainw.statusLabel.setText('Simulation finished')
             except:
                 pass
@@ -89,6 +89,24 @@ async def _set_parameter_value(
         print(e)
 
 
+async def _begin_parameters(client: SHV_CLIENT, mount_point: str, device_id: str):
+    call_url = f"{mount_point}/{device_id}/manager"
+    try:
+        return await client.call(call_url, "begin")
+    except RpcError as e:
+        print("Can't begin parameters transaction")
+        print(e)
+
+
+async def _commit_parameters(client: SHV_CLIENT, mount_point: str, device_id: str):
+    call_url = f"{mount_point}/{device_id}/manager"
+    try:
+        return await client.call(call_url, "commit")
+    except RpcError as e:
+        print("Can't commit parameters")
+        print(e)
+
+
 async def _is_connected(client: SHV_CLIENT) -> bool:
     return client.client.connected
 
@@ -211,6 +229,22 @@ class ShvClient:
             self.asyncio_loop,
         ).result()
 
+    def begin_parameters(self):
+        """Hold the parameters set from now on until commit_parameters."""
+        client = self._get_connection()
+        asyncio.run_coroutine_threadsafe(
+            _begin_parameters(client, self.mount_point, self.device_id),
+            self.asyncio_loop,
+        ).result()
+
+    def commit_parameters(self):
+        """Apply all parameters set since begin_parameters at once."""
+        client = self._get_connection()
+        asyncio.run_coroutine_threadsafe(
+            _commit_parameters(client, self.mount_point, self.device_id),
+            self.asyncio_loop,
+        ).result()
+
     def disconnect(self):
         self._disconnect()
 
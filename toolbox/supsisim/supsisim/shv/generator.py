@@ -20,6 +20,9 @@ class ShvTreeGenerator:
             self.blocks_ordered.append(self.blocks[n].name)
         self.blocks_ordered.sort()
 
+        # Blocks with parameter sets and their sizes, see generate_parset
+        self.parsets = {}
+
     def generate_header(self) -> None:
         text = "#ifdef CONF_SHV_USED\n"
         text += '#include <string.h>\n'
@@ -33,6 +36,8 @@ class ShvTreeGenerator:
         text += '#include "shv_pysim.h"\n'
         text += '#include "shv_manager_node.h"\n'
         text += '#include "shv_fwstable_node.h"\n'
+        text += '#include "shv_parset.h"\n'
+        text += '#include "shv_stream.h"\n'
         self.f.write(text)
 
         if environ["SHV_TREE_TYPE"] == "GSA":
@@ -41,6 +46,10 @@ class ShvTreeGenerator:
         elif environ["SHV_TREE_TYPE"] == "GSA_STATIC":
             text = "#define CONF_SHV_TREE_TYPE 3\n"
             text += "#define CONF_SHV_TREE_STATIC 1\n\n"
+        elif environ["SHV_TREE_TYPE"] == "GAVL_LAZY":
+            text = "#define CONF_SHV_TREE_TYPE 0\n"
+            text += "#define CONF_SHV_TREE_LAZY 1\n"
+            text += "#undef CONF_SHV_TREE_STATIC\n"
         else:
             text = "#define CONF_SHV_TREE_TYPE 0\n"
             text += "#undef CONF_SHV_TREE_STATIC\n"
@@ -80,11 +89,48 @@ class ShvTreeGenerator:
                 + str(self.blocks_cnt)
                 + "];\n"
             )
+            text += (
+                "python_block_parset block_parset_"
+                + self.model
+                + "["
+                + str(self.blocks_cnt)
+                + "];\n"
+            )
             text += "static struct shv_con_ctx *" + self.model + "_shv_ctx;\n"
             text += "static struct shv_connection shv_conn;\n"
             text += "#endif /* CONF_SHV_USED */\n\n"
             self.f.write(text)
 
+    def generate_parset(self, n: int, values: str, count: int) -> str:
+        """Shadow, staged and backup copies of block's real parameters.
+
+        Only the first count values of realPar, the states following them
+        are not copied. Inside a transaction SHV writes to the shadow copy
+        only, the values are swapped into realPar by the RT thread after
+        a commit.
+        """
+        self.parsets[n] = count
+        text = "#ifdef CONF_SHV_USED\n"
+        for copy_name in ("Shadow", "Staged", "Backup"):
+            text += "static double realPar" + copy_name + "_" + str(n) + "[] = {" + values + "};\n"
+        text += "static unsigned char realParFlags_" + str(n) + "[" + str(count) + "];\n"
+        text += "#endif /* CONF_SHV_USED */\n"
+        return text
+
+    def generate_parset_apply(self) -> None:
+        """Take over committed parameters at the sample boundary."""
+        text = "#ifdef CONF_SHV_USED\n"
+        text += "  shv_parset_apply(&block_name_map_" + self.model + ");\n"
+        text += "#endif /* CONF_SHV_USED */\n\n"
+        self.f.write(text)
+
+    def generate_stream_sample(self) -> None:
+        """Snapshot subscribed signals for the publisher at the end of the sample."""
+        text = "#ifdef CONF_SHV_USED\n"
+        text += "  shv_stream_sample(block_name_map_" + self.model + ".stream, t);\n"
+        text += "#endif /* CONF_SHV_USED */\n"
+        self.f.write(text)
+
     def generate_tree(self) -> None:
         self.f.write("#ifdef CONF_SHV_TREE_STATIC\n")
 
@@ -131,7 +177,7 @@ class ShvTreeGenerator:
                             + '   .shv_node = {.name = "'
                             + str(real_par_names[indexPar])
                             + '",\n'
-                            + "            .dir  = UL_CAST_UNQ1(struct shv_dmap *, &shv_double_dmap),\n"
+                            + "            .dir  = UL_CAST_UNQ1(struct shv_dmap *, &shv_parset_dmap),\n"
                             + "           },\n"
                             + "   .val_ptr = &realPar_"
                             + str(index)
@@ -199,7 +245,7 @@ class ShvTreeGenerator:
                             + '",\n'
                             + "            .dir  = UL_CAST_UNQ1(struct shv_dmap *, &shv_double_read_only_dmap),\n"
                             + "           },\n"
-                            + "   .val_ptr = Node_"
+                            + "   .val_ptr = nodes_" + self.model + ".Node_"
                             + str(self.blocks[index].pin[i])
                             + ",\n"
                             + '   .type_name = "double",\n};\n\n'
@@ -262,7 +308,7 @@ class ShvTreeGenerator:
                             + '",\n'
                             + "            .dir  = UL_CAST_UNQ1(struct shv_dmap *, &shv_double_read_only_dmap),\n"
                             + "           },\n"
-                            + "   .val_ptr = Node_"
+                            + "   .val_ptr = nodes_" + self.model + ".Node_"
                             + str(self.blocks[index].pout[i])
                             + ",\n"
                             + '   .type_name = "double",\n};\n\n'
@@ -361,7 +407,7 @@ class ShvTreeGenerator:
                         + '",\n'
                         + "            .dir  = UL_CAST_UNQ1(struct shv_dmap *, &shv_double_dmap),\n"
                         + "           },\n"
-                        + "   .val_ptr = Node_"
+                        + "   .val_ptr = nodes_" + self.model + ".Node_"
                         + str(self.blocks[index].pout[i])
                         + ",\n"
                         + '   .type_name = "double",\n};\n\n'
@@ -419,7 +465,7 @@ class ShvTreeGenerator:
                         + '",\n'
                         + "            .dir  = UL_CAST_UNQ1(struct shv_dmap *, &shv_double_read_only_dmap),\n"
                         + "           },\n"
-                        + "   .val_ptr = Node_"
+                        + "   .val_ptr = nodes_" + self.model + ".Node_"
                         + str(self.blocks[index].pin[i])
                         + ",\n"
                         + '   .type_name = "double",\n};\n\n'
@@ -558,7 +604,8 @@ class ShvTreeGenerator:
             "        .dir = UL_CAST_UNQ1(struct shv_dmap *, &shv_manager_dmap),\n" +
             "        .children = { .mode = CONF_SHV_TREE_TYPE }\n" +
             "    },\n" +
-            "    .model_ctx = &" + self.model + "_ctx\n" +
+            "    .model_ctx = &" + self.model + "_ctx,\n" +
+            "    .block_map = &block_name_map_" + self.model + "\n" +
             "};\n\n"
         )
         self.f.write(text)
@@ -768,6 +815,17 @@ class ShvTreeGenerator:
         text += "\n"
         self.f.write(text)
 
+        text = ""
+        for n, count in sorted(self.parsets.items()):
+            parset = "  block_parset_" + self.model + "[" + str(n) + "]"
+            text += parset + ".shadow = realParShadow_" + str(n) + ";\n"
+            text += parset + ".staged = realParStaged_" + str(n) + ";\n"
+            text += parset + ".backup = realParBackup_" + str(n) + ";\n"
+            text += parset + ".flags = realParFlags_" + str(n) + ";\n"
+            text += parset + ".count = " + str(count) + ";\n"
+        text += "\n"
+        self.f.write(text)
+
         text = (
             "  block_name_map_"
             + self.model
@@ -790,6 +848,20 @@ class ShvTreeGenerator:
             + self.model
             + ";\n"
         )
+        text += (
+            "  block_name_map_"
+            + self.model
+            + ".parsets = block_parset_"
+            + self.model
+            + ";\n"
+        )
+        text += "#ifdef CONF_SHV_TREE_LAZY\n"
+        text += (
+            "  block_name_map_"
+            + self.model
+            + ".lazy_blocks = CONF_SHV_LAZY_BLOCKS;\n"
+        )
+        text += "#endif\n"
         text += (
             "  block_name_map_"
             + self.model
@@ -804,7 +876,13 @@ class ShvTreeGenerator:
         text = "#ifdef CONF_SHV_USED\n"
         text += "void " + self.model + "_com_end(void)\n"
         text += "{\n"
-        text += "  shv_tree_end(" + self.model + "_shv_ctx, CONF_SHV_TREE_TYPE);\n"
+        text += (
+            "  shv_tree_end(&block_name_map_"
+            + self.model
+            + ", "
+            + self.model
+            + "_shv_ctx, CONF_SHV_TREE_TYPE);\n"
+        )
         text += "}\n"
         text += "#endif /* CONF_SHV_USED */\n\n"
         self.f.write(text)
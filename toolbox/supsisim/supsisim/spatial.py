@@ -0,0 +1,54 @@
+from supsisim.qtvers import *
+
+from supsisim.const import GRID, DB
+
+# Side of a cell of the connection index, in scene units
+CELL = 8*GRID
+
+class SegmentIndex:
+    """Uniform grid over the segments of the connections of a scene.
+
+    The scene BSP tree knows only the bounding rectangles, a long
+    connection with a corner is then a candidate for every point of the
+    rectangle. Here a connection is stored only in the cells its segments
+    pass through, and it is moved between cells when its path changes.
+    """
+    def __init__(self):
+        self.cells = {}
+        self.conns = {}
+
+    def clear(self):
+        self.cells.clear()
+        self.conns.clear()
+
+    def cellRange(self, x1, y1, x2, y2):
+        i1 = int((min(x1, x2) - DB) // CELL)
+        i2 = int((max(x1, x2) + DB) // CELL)
+        j1 = int((min(y1, y2) - DB) // CELL)
+        j2 = int((max(y1, y2) + DB) // CELL)
+        return [(i, j) for i in range(i1, i2+1) for j in range(j1, j2+1)]
+
+    def update(self, conn):
+        self.remove(conn)
+        path = conn.path()
+        keys = set()
+        for n in range(1, path.elementCount()):
+            p1 = path.elementAt(n-1)
+            p2 = path.elementAt(n)
+            keys.update(self.cellRange(p1.x, p1.y, p2.x, p2.y))
+        for key in keys:
+            self.cells.setdefault(key, set()).add(conn)
+        self.conns[conn] = keys
+
+    def remove(self, conn):
+        for key in self.conns.pop(conn, ()):
+            cell = self.cells[key]
+            cell.discard(conn)
+            if not cell:
+                del self.cells[key]
+
+    def connectionsAt(self, pos):
+        conns = set()
+        for key in self.cellRange(pos.x(), pos.y(), pos.x(), pos.y()):
+            conns.update(self.cells.get(key, ()))
+        return conns
@@ -295,16 +295,15 @@ class subsBlock(Block):
     def load(self, subs):
         self.sceneSubs.DictToDgm(subs['subitems'])
 
-    def getInternalBlocks(self):
+    def getInternalBlocks(self, path):
+        # path is the one of this subsystem, the nested ones extend it
         items = []
         for item in self.sceneSubs.items():
             if isinstance(item, subsBlock):
-                blk = item.getInternalBlocks()
-                for el in blk:
-                    el.setSysPath(item.syspath)
-                    items.append(el)
+                items += item.getInternalBlocks(f'{path}/{item.name}')
             elif isinstance(item, Block):
                 item.subsParent = self
+                item.setSysPath(path)
                 items.append(item)
             else:
                 pass
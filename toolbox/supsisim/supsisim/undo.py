@@ -0,0 +1,209 @@
+from supsisim.qtvers import *
+
+from supsisim.block import Block
+from supsisim.port import Port, OutPort
+from supsisim.connection import Connection
+from supsisim.const import UNDO_LEVELS
+import copy
+import weakref
+
+class UndoStack:
+    """Undo and redo history of the edits of one scene.
+
+    An edit is recorded as the state of the items it touched, before and
+    after. begin() gets the blocks the edit may change and saves them with
+    their connections, the edit is closed when the next one begins or on
+    undo. New blocks are found by comparing the block set of the scene,
+    new connections hang on the saved or on the new blocks. Only the
+    items whose state differs are kept.
+
+    Blocks are identified by an uid kept across undo and redo, a
+    connection by the input port it drives, (uid, input index).
+    Undo and redo delete the current version of the recorded items and
+    load the other one, the rest of the diagram is not touched.
+    """
+    def __init__(self, scene):
+        self.scene = scene
+        self.undoList = []
+        self.redoList = []
+        self.pending = None
+        self.dropped = False
+        self.uids = weakref.WeakValueDictionary()
+        self.lastUid = 0
+
+    def clear(self):
+        self.undoList = []
+        self.redoList = []
+        self.pending = None
+        self.dropped = False
+
+    def atStart(self):
+        # Back to the loaded diagram
+        return len(self.undoList) == 0 and not self.dropped
+
+    # Identification of the items
+
+    def alive(self, blk):
+        return QGraphicsItem.scene(blk) is self.scene
+
+    def uid(self, blk):
+        if not hasattr(blk, 'uid'):
+            self.lastUid += 1
+            blk.uid = self.lastUid
+        self.uids[blk.uid] = blk
+        return blk.uid
+
+    def getBlock(self, uid):
+        blk = self.uids.get(uid)
+        if blk is not None and self.alive(blk):
+            return blk
+        return None
+
+    def getConn(self, key):
+        blk = self.getBlock(key[0])
+        if blk is None:
+            return None
+        inp = blk.getPorts()[0]
+        if key[1] >= len(inp) or len(inp[key[1]].connections) == 0:
+            return None
+        return inp[key[1]].connections[0]
+
+    # Saved states
+
+    def saveBlock(self, blk):
+        return copy.deepcopy(blk.save())
+
+    def saveConn(self, c):
+        ids = {c.port1.parent: self.uid(c.port1.parent),
+               c.port2.parent: self.uid(c.port2.parent)}
+        st = c.save(ids)
+        if st is None or 'dst' not in st:
+            return None, None
+        return tuple(st['dst']), st
+
+    def capture(self, blocks):
+        blks = {}
+        conns = {}
+        for b in blocks:
+            if not self.alive(b):
+                continue
+            blks[self.uid(b)] = self.saveBlock(b)
+            for p in b.childItems():
+                if isinstance(p, Port):
+                    for c in p.connections:
+                        if c.port1 is not None and c.port2 is not None:
+                            key, st = self.saveConn(c)
+                            if key is not None:
+                                conns[key] = st
+        return blks, conns
+
+    # Recording
+
+    def begin(self, blocks = None):
+        self.close()
+        if blocks is None:
+            blocks = self.scene.blocks
+        blocks = [b for b in blocks if isinstance(b, Block)]
+        self.pending = (blocks, set(self.scene.blocks), self.capture(blocks))
+
+    def discard(self):
+        self.pending = None
+
+    def close(self):
+        if self.pending is None:
+            return
+        blocks, oldBlocks, before = self.pending
+        self.pending = None
+
+        newBlocks = [b for b in self.scene.blocks if b not in oldBlocks]
+        after = self.capture(blocks + newBlocks)
+
+        # Keep the changed items, a block is loaded again with its
+        # connections
+        keysB = set()
+        for key in set(before[0]) | set(after[0]):
+            if before[0].get(key) != after[0].get(key):
+                keysB.add(key)
+        keysC = set()
+        for key in set(before[1]) | set(after[1]):
+            st1 = before[1].get(key)
+            st2 = after[1].get(key)
+            if st1 != st2:
+                keysC.add(key)
+            else:
+                if st1['src'][0] in keysB or st1['dst'][0] in keysB:
+                    keysC.add(key)
+
+        if not keysB and not keysC:
+            return
+
+        cmd = []
+        for st in (before, after):
+            blks = dict((k, st[0][k]) for k in keysB if k in st[0])
+            conns = dict((k, st[1][k]) for k in keysC if k in st[1])
+            cmd.append((blks, conns))
+        cmd.append((keysB, keysC))
+
+        self.undoList.append(cmd)
+        if len(self.undoList) > UNDO_LEVELS:
+            self.undoList.pop(0)
+            self.dropped = True
+        self.redoList = []
+        self.scene.mainw.modified = True
+
+    # Undo and redo
+
+    def undo(self):
+        self.close()
+        if len(self.undoList) == 0:
+            return False
+        cmd = self.undoList.pop()
+        self.apply(cmd[0], cmd[2])
+        self.redoList.append(cmd)
+        return True
+
+    def redo(self):
+        self.close()
+        if len(self.redoList) == 0:
+            return False
+        cmd = self.redoList.pop()
+        self.apply(cmd[1], cmd[2])
+        self.undoList.append(cmd)
+        return True
+
+    def apply(self, state, keys):
+        editor = self.scene.mainw.editor
+        blks, conns = state
+        keysB, keysC = keys
+        ports = set()
+
+        for key in keysC:
+            c = self.getConn(key)
+            if c is not None:
+                ports.add(c.port1)
+                c.remove()
+        for key in keysB:
+            b = self.getBlock(key)
+            if b is not None:
+                ports.update(editor.connectedPorts([b]))
+                b.remove()
+
+        for key, st in blks.items():
+            st = copy.deepcopy(st)
+            if isinstance(st.get('block'), dict):
+                b = self.scene.loadSubsystem(st)
+            else:
+                b = self.scene.loadBlock(st)
+            b.uid = key
+            self.uids[key] = b
+        for key, st in conns.items():
+            if self.getBlock(st['src'][0]) is None or self.getBlock(st['dst'][0]) is None:
+                continue
+            c = Connection(None, self.scene)
+            c.load(copy.deepcopy(st), 0.0, 0.0, self.uids)
+            if isinstance(c.port1, OutPort):
+                ports.add(c.port1)
+
+        for key in blks:
+            ports.update(editor.connectedPorts([self.uids[key]]))
+        editor.redrawNodes(ports)